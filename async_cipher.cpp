@@ -0,0 +1,361 @@
+/// @file async_cipher.cpp
+/// @brief Implementation of the asynchronous, batching front end to the text and hybrid ciphers.
+
+#include "async_cipher.hpp"
+#include "io.hpp"
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace
+{
+    /// @brief Splits a text ciphertext into its non-empty lines.
+    /// @param ciphertext The ciphertext, one encrypted line per line.
+    /// @return Views of the encrypted lines.
+    std::vector<std::string_view> ciphertext_lines(std::string_view ciphertext)
+    {
+        std::vector<std::string_view> lines;
+        for (const std::string_view line : split_lines(ciphertext))
+        {
+            if (!line.empty())
+                lines.push_back(line);
+        }
+        return lines;
+    }
+
+    /// @brief Joins lines into a text, ending every line with a newline.
+    /// @param lines The lines.
+    /// @return The text, as the command-line tool would print it.
+    std::string join_lines(const std::vector<std::string> &lines)
+    {
+        std::size_t length = 0;
+        for (const std::string &line : lines)
+            length += line.size() + 1;
+
+        std::string text;
+        text.reserve(length);
+        for (const std::string &line : lines)
+            text.append(line).push_back('\n');
+        return text;
+    }
+
+    /// @brief Calls a request's completion, discarding anything it throws.
+    ///
+    /// An exception escaping the executor thread would terminate the process, and there is
+    /// nobody left to report a failed completion to.
+    /// @param request The request.
+    /// @param result The result, or empty on failure.
+    /// @param error The failure, or null.
+    void complete(AsyncCipher::Request &request, std::string result, std::exception_ptr error) noexcept
+    {
+        try
+        {
+            request.done(std::move(result), error);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    /// @brief Completes a pooled text request with its result lines.
+    /// @param request The request.
+    /// @param lines The result, one line each.
+    void complete_lines(AsyncCipher::Request &request, const std::vector<std::string> &lines) noexcept
+    {
+        std::string text;
+        std::exception_ptr error;
+        try
+        {
+            text = join_lines(lines);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        complete(request, std::move(text), error);
+    }
+}
+
+/// @brief Prepares a request; nothing is queued until the caller suspends.
+AsyncCipher::Operation::Operation(AsyncCipher &owner, char request_op, std::string_view request_payload)
+    : cipher(owner), op(request_op), payload(request_payload) {}
+
+/// @brief Queues the request and suspends the caller until it is done.
+/// @param caller The awaiting coroutine.
+void AsyncCipher::Operation::await_suspend(std::coroutine_handle<> caller)
+{
+    cipher.submit(op, payload, [this, caller](std::string value, std::exception_ptr failure)
+                  {
+                      // The operation lives in the caller's frame, so it must not be touched once resumed.
+                      result = std::move(value);
+                      error = failure;
+                      if (cipher.resumer)
+                          cipher.resumer(caller);
+                      else
+                          caller.resume(); });
+}
+
+/// @brief Hands the result to the resumed caller.
+/// @return The result.
+/// @throws The exception that failed the request.
+std::string AsyncCipher::Operation::await_resume()
+{
+    if (error)
+        std::rethrow_exception(error);
+    return std::move(result);
+}
+
+/// @brief Starts the executor thread.
+/// @param key The key used for every request.
+/// @param resume Resumes awaiting coroutines; empty to resume them on the executor thread.
+AsyncCipher::AsyncCipher(KeyHandle key, Resumer resume)
+    : rsa_key(std::move(key)), resumer(std::move(resume)), executor(&AsyncCipher::batch_loop, this) {}
+
+/// @brief Finishes every queued request, then stops the executor.
+AsyncCipher::~AsyncCipher()
+{
+    stopping.store(true);
+    wake_executor();
+    executor.join();
+}
+
+/// @brief Queues a request without waiting for it.
+/// @param op Request tag: `e` or `d` for text, `E` or `D` for hybrid, as for the daemon.
+/// @param payload Request payload; must stay valid until done is called.
+/// @param done Called once on the executor thread with the result or the failure.
+void AsyncCipher::submit(char op, std::string_view payload, Completion done)
+{
+    Request request{op, payload, std::move(done)};
+    push(request);
+    wake_executor();
+}
+
+/// @brief Queues several requests at once, waking the executor only once.
+/// @param requests The requests; moved from. Each payload must stay valid until its done is called.
+void AsyncCipher::submit(std::vector<Request> &requests)
+{
+    for (Request &request : requests)
+        push(request);
+    wake_executor();
+}
+
+/// @brief Queues a request, waiting for room if the queue is full.
+/// @param request The request.
+void AsyncCipher::push(Request &request)
+{
+    // A full queue means the executor is busy with a batch of thousands of requests, so wait
+    // for it to catch up; wake it first in case it is asleep with the queue still full.
+    for (unsigned attempt = 0; !pending.try_push(request); attempt++)
+    {
+        wake_executor();
+        if (attempt < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+/// @brief Wakes the executor if it is waiting for requests.
+void AsyncCipher::wake_executor()
+{
+    // Pairs with the fence in batch_loop: either the executor sees the new request before it
+    // sleeps, or this sees that it is asleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (executor_asleep.load(std::memory_order_relaxed))
+    {
+        executor_asleep.store(false, std::memory_order_relaxed);
+        executor_asleep.notify_one();
+    }
+}
+
+/// @brief Encrypts text asynchronously.
+/// @param text The text; must stay valid until the operation completes.
+/// @return An awaitable yielding the ciphertext in the `e` command's text format.
+AsyncCipher::Operation AsyncCipher::async_encrypt(std::string_view text)
+{
+    return Operation(*this, 'e', text);
+}
+
+/// @brief Decrypts a text ciphertext asynchronously.
+/// @param ciphertext The ciphertext; must stay valid until the operation completes.
+/// @return An awaitable yielding the plaintext lines, each ending with a newline.
+AsyncCipher::Operation AsyncCipher::async_decrypt(std::string_view ciphertext)
+{
+    return Operation(*this, 'd', ciphertext);
+}
+
+/// @brief Encrypts arbitrary bytes into a hybrid container asynchronously.
+/// @param data The data; must stay valid until the operation completes.
+/// @return An awaitable yielding the container.
+AsyncCipher::Operation AsyncCipher::async_hybrid_encrypt(std::string_view data)
+{
+    return Operation(*this, 'E', data);
+}
+
+/// @brief Decrypts a hybrid container asynchronously.
+/// @param container The container; must stay valid until the operation completes.
+/// @return An awaitable yielding the data.
+AsyncCipher::Operation AsyncCipher::async_hybrid_decrypt(std::string_view container)
+{
+    return Operation(*this, 'D', container);
+}
+
+/// @brief Takes every queued request and processes them together, until shutdown.
+void AsyncCipher::batch_loop()
+{
+    // Requests that arrive while a batch is running wait for the next one, so the batch size
+    // grows with load without adding latency when the cipher is idle.
+    std::vector<Request> batch;
+    Request request;
+    while (true)
+    {
+        while (pending.try_pop(request))
+            batch.push_back(std::move(request));
+
+        if (!batch.empty())
+        {
+            process_batch(batch);
+            batch.clear();
+            continue;
+        }
+        if (stopping.load())
+            return;
+
+        executor_asleep.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pending.try_pop(request))
+        {
+            executor_asleep.store(false, std::memory_order_relaxed);
+            batch.push_back(std::move(request));
+            continue;
+        }
+        if (!stopping.load())
+            executor_asleep.wait(true);
+    }
+}
+
+/// @brief Processes a batch, pooling its text requests.
+/// @param batch The requests; each one's completion is called exactly once.
+void AsyncCipher::process_batch(std::vector<Request> &batch) const
+{
+    std::vector<size_t> encrypts, decrypts;
+    std::vector<std::string_view> texts;
+    std::vector<std::vector<std::string_view>> ciphertexts;
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        std::vector<std::string_view> lines;
+        if (batch[i].op == 'd')
+            lines = ciphertext_lines(batch[i].payload);
+
+        if (batch[i].op == 'e' && !batch[i].payload.empty())
+        {
+            encrypts.push_back(i);
+            texts.push_back(batch[i].payload);
+        }
+        else if (!lines.empty())
+        {
+            decrypts.push_back(i);
+            ciphertexts.push_back(std::move(lines));
+        }
+        else
+            run_alone(batch[i]);
+    }
+
+    // One bad request would fail a pooled call, so on error every request is retried alone.
+    // Completions are called outside the try blocks so that a throwing one cannot cause a retry,
+    // and through complete(), so that it cannot end the executor either.
+    if (!encrypts.empty())
+    {
+        std::vector<std::vector<std::string>> results;
+        try
+        {
+            results = bignum.large_encrypt_batch(texts, rsa_key);
+        }
+        catch (const std::exception &)
+        {
+            results.clear();
+        }
+
+        for (size_t i = 0; i < encrypts.size(); i++)
+        {
+            if (results.empty())
+                run_alone(batch[encrypts[i]]);
+            else
+                complete_lines(batch[encrypts[i]], results[i]);
+        }
+    }
+
+    if (!decrypts.empty())
+    {
+        std::vector<std::vector<std::string>> results;
+        try
+        {
+            results = bignum.large_decrypt_batch(ciphertexts, rsa_key);
+        }
+        catch (const std::exception &)
+        {
+            results.clear();
+        }
+
+        for (size_t i = 0; i < decrypts.size(); i++)
+        {
+            if (results.empty())
+                run_alone(batch[decrypts[i]]);
+            else
+                complete_lines(batch[decrypts[i]], results[i]);
+        }
+    }
+}
+
+/// @brief Processes a request on its own and completes it.
+/// @param request The request.
+void AsyncCipher::run_alone(Request &request) const
+{
+    std::string result;
+    std::exception_ptr error;
+    try
+    {
+        result = process_one(request.op, request.payload);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    complete(request, std::move(result), error);
+}
+
+/// @brief Processes a single request on its own.
+/// @param op Request tag.
+/// @param payload Request payload.
+/// @return The result.
+/// @throws std::exception if the request fails.
+std::string AsyncCipher::process_one(char op, std::string_view payload) const
+{
+    switch (op)
+    {
+    case 'e':
+        if (payload.empty())
+            throw std::invalid_argument("No text to encrypt");
+        return join_lines(bignum.large_encrypt(payload, rsa_key));
+
+    case 'd':
+    {
+        const std::vector<std::string_view> lines = ciphertext_lines(payload);
+        if (lines.empty())
+            throw std::invalid_argument("No values to decrypt");
+        return join_lines(bignum.large_decrypt(lines, rsa_key));
+    }
+
+    case 'E':
+        return bignum.hybrid_encrypt(payload, rsa_key);
+
+    case 'D':
+        if (payload.empty())
+            throw std::invalid_argument("No data to decrypt");
+        return bignum.hybrid_decrypt(payload, rsa_key);
+
+    default:
+        throw std::invalid_argument("Unsupported request");
+    }
+}
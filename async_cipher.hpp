@@ -0,0 +1,160 @@
+/// @file async_cipher.hpp
+/// @brief Declaration of the asynchronous, batching front end to the text and hybrid ciphers.
+///
+/// An AsyncCipher owns one executor thread. Requests are queued without blocking and picked up
+/// together: every text request pending when the executor wakes is encrypted or decrypted as
+/// one batch, so the blocks of many small requests share lane-interleaved exponentiations.
+/// The queue is a lock-free MPMC ring, so many submitting threads never serialise on a lock,
+/// and submitters only make a system call to wake the executor when it is actually asleep.
+///
+/// From a C++20 coroutine, `co_await cipher.async_encrypt(text)` suspends the caller and
+/// resumes it with the ciphertext once its batch is done. By default the caller is resumed on
+/// the executor thread; event-loop services pass a resumer that posts the handle to their
+/// loop instead.
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "bignum.hpp"
+#include "mpmc_queue.hpp"
+
+/// @brief Number of requests an AsyncCipher can hold before submitters have to wait.
+constexpr std::size_t ASYNC_QUEUE_CAPACITY = 4096;
+
+/// @class AsyncCipher
+/// @brief Processes encryption and decryption requests on a batching executor thread.
+class AsyncCipher
+{
+public:
+    /// @brief Receives a request's result, or the exception that failed it, on the executor thread.
+    ///
+    /// Should not throw; an exception it throws is discarded so that it cannot stop the executor.
+    using Completion = std::function<void(std::string result, std::exception_ptr error)>;
+
+    /// @brief Resumes a suspended caller; called on the executor thread.
+    using Resumer = std::function<void(std::coroutine_handle<> caller)>;
+
+    /// @brief A request and what to do with its result.
+    struct Request
+    {
+        char op = 0;              ///< Request tag: `e` or `d` for text, `E` or `D` for hybrid.
+        std::string_view payload; ///< Request payload, kept alive by the submitter.
+        Completion done;          ///< Called once on the executor thread when the request is processed.
+    };
+
+    /// @class Operation
+    /// @brief Awaitable for one request; returned by async_encrypt() and async_decrypt().
+    class Operation
+    {
+    private:
+        friend class AsyncCipher;
+
+        AsyncCipher &cipher;      ///< The cipher the request is queued on.
+        char op;                  ///< Request tag.
+        std::string_view payload; ///< Request payload, kept alive by the caller.
+        std::string result;       ///< The result, once complete.
+        std::exception_ptr error; ///< The failure, once complete.
+
+        /// @brief Prepares a request; nothing is queued until the caller suspends.
+        Operation(AsyncCipher &owner, char request_op, std::string_view request_payload);
+
+    public:
+        /// @brief Never complete before queueing.
+        /// @return False.
+        bool await_ready() const noexcept { return false; }
+
+        /// @brief Queues the request and suspends the caller until it is done.
+        /// @param caller The awaiting coroutine.
+        void await_suspend(std::coroutine_handle<> caller);
+
+        /// @brief Hands the result to the resumed caller.
+        /// @return The result.
+        /// @throws The exception that failed the request.
+        std::string await_resume();
+    };
+
+private:
+    KeyHandle rsa_key;  ///< Key used for every request.
+    Bignum bignum;      ///< Bignum instance performing the cryptography.
+    Resumer resumer;    ///< Resumes awaiting coroutines; empty to resume them directly.
+
+    MpmcQueue<Request> pending{ASYNC_QUEUE_CAPACITY}; ///< Requests not yet picked up by the executor.
+    std::atomic<bool> executor_asleep{false};         ///< Set while the executor waits for requests.
+    std::atomic<bool> stopping{false};                ///< Set by the destructor.
+
+    std::thread executor; ///< Runs batch_loop(); started last.
+
+    /// @brief Takes every queued request and processes them together, until shutdown.
+    void batch_loop();
+
+    /// @brief Queues a request, waiting for room if the queue is full.
+    /// @param request The request.
+    void push(Request &request);
+
+    /// @brief Wakes the executor if it is waiting for requests.
+    void wake_executor();
+
+    /// @brief Processes a batch, pooling its text requests.
+    /// @param batch The requests; each one's completion is called exactly once.
+    void process_batch(std::vector<Request> &batch) const;
+
+    /// @brief Processes a request on its own and completes it.
+    /// @param request The request.
+    void run_alone(Request &request) const;
+
+    /// @brief Processes a single request on its own.
+    /// @param op Request tag.
+    /// @param payload Request payload.
+    /// @return The result.
+    /// @throws std::exception if the request fails.
+    std::string process_one(char op, std::string_view payload) const;
+
+public:
+    /// @brief Starts the executor thread.
+    /// @param key The key used for every request.
+    /// @param resume Resumes awaiting coroutines; empty to resume them on the executor thread.
+    explicit AsyncCipher(KeyHandle key, Resumer resume = {});
+
+    /// @brief Finishes every queued request, then stops the executor.
+    ~AsyncCipher();
+
+    AsyncCipher(const AsyncCipher &) = delete;
+    AsyncCipher &operator=(const AsyncCipher &) = delete;
+
+    /// @brief Queues a request without waiting for it.
+    /// @param op Request tag: `e` or `d` for text, `E` or `D` for hybrid, as for the daemon.
+    /// @param payload Request payload; must stay valid until done is called.
+    /// @param done Called once on the executor thread with the result or the failure.
+    void submit(char op, std::string_view payload, Completion done);
+
+    /// @brief Queues several requests at once, waking the executor only once.
+    /// @param requests The requests; moved from. Each payload must stay valid until its done is called.
+    void submit(std::vector<Request> &requests);
+
+    /// @brief Encrypts text asynchronously.
+    /// @param text The text; must stay valid until the operation completes.
+    /// @return An awaitable yielding the ciphertext in the `e` command's text format.
+    Operation async_encrypt(std::string_view text);
+
+    /// @brief Decrypts a text ciphertext asynchronously.
+    /// @param ciphertext The ciphertext; must stay valid until the operation completes.
+    /// @return An awaitable yielding the plaintext lines, each ending with a newline.
+    Operation async_decrypt(std::string_view ciphertext);
+
+    /// @brief Encrypts arbitrary bytes into a hybrid container asynchronously.
+    /// @param data The data; must stay valid until the operation completes.
+    /// @return An awaitable yielding the container.
+    Operation async_hybrid_encrypt(std::string_view data);
+
+    /// @brief Decrypts a hybrid container asynchronously.
+    /// @param container The container; must stay valid until the operation completes.
+    /// @return An awaitable yielding the data.
+    Operation async_hybrid_decrypt(std::string_view container);
+};
@@ -0,0 +1,144 @@
+/// @file bench_queue.cpp
+/// @brief Benchmark of the lock-free request queue against a mutex-protected queue.
+///
+/// Many producers, as in the daemon with one thread per connection, hand small items to a
+/// few consumers. Build with -DBIGNUM_BENCHMARKS=ON and run `./bench_queue [producers]`.
+
+#include "mpmc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /// @brief Items pushed by every producer.
+    constexpr std::uint64_t ITEMS_PER_PRODUCER = 50000;
+
+    /// @brief A bounded FIFO queue protected by one mutex, for comparison.
+    class MutexQueue
+    {
+    private:
+        std::mutex mutex;              ///< Guards items.
+        std::deque<std::uint64_t> items; ///< The queued items.
+        std::size_t limit;             ///< Maximum number of items.
+
+    public:
+        /// @brief Creates an empty queue.
+        /// @param capacity Maximum number of items.
+        explicit MutexQueue(std::size_t capacity) : limit(capacity) {}
+
+        /// @brief Appends an item unless the queue is full.
+        /// @param value The item.
+        /// @return False if the queue was full.
+        bool try_push(std::uint64_t &value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (items.size() >= limit)
+                return false;
+            items.push_back(value);
+            return true;
+        }
+
+        /// @brief Removes the oldest item unless the queue is empty.
+        /// @param value Receives the item.
+        /// @return False if the queue was empty.
+        bool try_pop(std::uint64_t &value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (items.empty())
+                return false;
+            value = items.front();
+            items.pop_front();
+            return true;
+        }
+    };
+
+    /// @brief Moves every producer's items through a queue and times it.
+    /// @param queue The queue.
+    /// @param producers Number of producer threads.
+    /// @param consumers Number of consumer threads.
+    /// @return Millions of items per second.
+    template <typename Queue>
+    double run(Queue &queue, unsigned producers, unsigned consumers)
+    {
+        const std::uint64_t total = ITEMS_PER_PRODUCER * producers;
+        std::atomic<std::uint64_t> consumed{0}, checksum{0};
+        std::atomic<bool> start{false};
+
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&, p]()
+                                 {
+                while (!start.load())
+                    std::this_thread::yield();
+                for (std::uint64_t i = 0; i < ITEMS_PER_PRODUCER; i++)
+                {
+                    std::uint64_t value = p * ITEMS_PER_PRODUCER + i;
+                    while (!queue.try_push(value))
+                        std::this_thread::yield();
+                } });
+        }
+        for (unsigned c = 0; c < consumers; c++)
+        {
+            threads.emplace_back([&]()
+                                 {
+                std::uint64_t value, sum = 0;
+                while (consumed.load(std::memory_order_relaxed) < total)
+                {
+                    if (queue.try_pop(value))
+                    {
+                        sum += value;
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else
+                        std::this_thread::yield();
+                }
+                checksum.fetch_add(sum); });
+        }
+
+        const auto began = std::chrono::steady_clock::now();
+        start.store(true);
+        for (std::thread &thread : threads)
+            thread.join();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+
+        if (checksum.load() != total * (total - 1) / 2)
+        {
+            std::cerr << "Error: items were lost or duplicated\n";
+            std::exit(1);
+        }
+        return total / seconds / 1e6;
+    }
+}
+
+/// @brief Runs the benchmark.
+/// @param argc Argument count.
+/// @param argv Optional number of producers (default 64).
+/// @return 0 on success.
+int main(int argc, char *argv[])
+{
+    const unsigned producers = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : 64;
+    const std::size_t capacity = 4096;
+
+    std::cout << producers << " producers, " << ITEMS_PER_PRODUCER << " items each, capacity " << capacity << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const unsigned consumers : {1u, 4u})
+    {
+        MpmcQueue<std::uint64_t> lock_free(capacity);
+        MutexQueue locked(capacity);
+        const double lock_free_rate = run(lock_free, producers, consumers);
+        const double locked_rate = run(locked, producers, consumers);
+        std::cout << consumers << " consumer(s): lock-free " << lock_free_rate << " M items/s, mutex "
+                  << locked_rate << " M items/s\n";
+    }
+    return 0;
+}
@@ -7,42 +7,269 @@
 /// applications and supports multithreading for certain operations.
 
 #include "bignum.hpp"
+#include "chacha20poly1305.hpp"
+#include "ciphertext_file.hpp"
+#include "io.hpp"
+#include "keyring.hpp"
+#include "secure_random.hpp"
+#include "work_stealing.hpp"
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <vector>
-#include <future>
-#include <thread>
 #include <mutex>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Static constants for RSA parameters (placeholders to be replaced with actual values).
 const std::string Bignum::rsa_n = "TO_FILL"; ///< RSA modulus
 const std::string Bignum::rsa_e = "TO_FILL"; ///< RSA public exponent
 const std::string Bignum::rsa_d = "TO_FILL"; ///< RSA private exponent
 
-// Maximum number of characters allowed per chunk in large encryption.
-const size_t Bignum::MAX_CHARS_PER_CHUNK = 96;
+// Key used for encryption and decryption; set by load_key or built lazily from the constants above.
+KeyHandle Bignum::active_key;
+
+namespace
+{
+    /// @brief Leading byte of a block that is followed by more blocks of the same line.
+    constexpr char BLOCK_CONTINUES = 0x01;
+
+    /// @brief Leading byte of the last block of a line.
+    constexpr char BLOCK_FINAL = 0x02;
+
+    /// @brief Magic bytes at the start of every hybrid container.
+    constexpr char HYBRID_MAGIC[8] = {'B', 'N', 'H', 'Y', 'B', 'R', 'D', '2'};
+
+    /// @brief Fewest random padding bytes in front of a session key, as in PKCS#1 v1.5.
+    constexpr size_t SESSION_KEY_MIN_PADDING = 8;
+
+    /// @brief Pads a session key to the full modulus width (PKCS#1 v1.5 encryption block).
+    ///
+    /// The block is 0x00 0x02, random non-zero bytes, 0x00 and the key. Filling the whole
+    /// width keeps the value far above the e-th power threshold, so a small public exponent
+    /// cannot be undone with an integer root.
+    /// @param session_key The key.
+    /// @param modulus_bytes Length of the modulus in bytes.
+    /// @return The block, modulus_bytes long.
+    std::string pad_session_key(const std::vector<std::uint8_t> &session_key, size_t modulus_bytes)
+    {
+        const size_t padding_bytes = modulus_bytes - session_key.size() - 3;
+        std::string block(modulus_bytes, '\0');
+        block[1] = 0x02;
+
+        std::vector<std::uint8_t> padding = random_bytes(padding_bytes);
+        for (size_t i = 0; i < padding_bytes; i++)
+        {
+            while (padding[i] == 0)
+                fill_random(&padding[i], 1);
+            block[2 + i] = static_cast<char>(padding[i]);
+        }
+
+        std::copy(session_key.begin(), session_key.end(), block.begin() + 3 + padding_bytes);
+        return block;
+    }
+
+    /// @brief Recovers the session key from a decrypted encryption block, with implicit rejection.
+    ///
+    /// A well-formed block is 0x00 0x02, non-zero padding, 0x00 and the key. A malformed one
+    /// is not reported: a random key is returned in its place, so the payload then fails
+    /// authentication exactly as a corrupted one does. Every byte is examined and the outcome
+    /// only selects between the two keys through a mask, so neither the result nor the time
+    /// taken tells a caller whether the padding was valid (no Bleichenbacher oracle).
+    /// @param block The block, exactly as wide as the modulus and at least
+    ///              AEAD_KEY_BYTES + SESSION_KEY_MIN_PADDING + 3 bytes long.
+    /// @return The session key, AEAD_KEY_BYTES long.
+    std::vector<std::uint8_t> unpad_session_key(std::string_view block)
+    {
+        const auto byte_at = [&block](size_t i) { return static_cast<unsigned>(static_cast<unsigned char>(block[i])); };
+        const size_t separator = block.length() - AEAD_KEY_BYTES - 1;
+
+        unsigned malformed = byte_at(0) | (byte_at(1) ^ 0x02) | byte_at(separator);
+        for (size_t i = 2; i < separator; i++)
+            malformed |= ((byte_at(i) - 1) >> 8) & 1; // 1 exactly when the padding byte is zero
+
+        // 0xff for a well-formed block, 0x00 otherwise; malformed is below 0x100.
+        const std::uint8_t keep = static_cast<std::uint8_t>((malformed - 1) >> 8);
+        std::vector<std::uint8_t> session_key = random_bytes(AEAD_KEY_BYTES);
+        for (size_t i = 0; i < AEAD_KEY_BYTES; i++)
+            session_key[i] = static_cast<std::uint8_t>((byte_at(separator + 1 + i) & keep) | (session_key[i] & ~keep));
+        return session_key;
+    }
+
+    /// @brief Lane groups per pool worker in one window of a streamed job.
+    ///
+    /// Enough that the last groups of a window leave few workers idle, few enough that a
+    /// window of 2048-bit blocks stays in the low megabytes per worker.
+    constexpr size_t WINDOW_GROUPS_PER_WORKER = 16;
+
+    /// @brief Number of blocks a streamed job encrypts or decrypts at once.
+    /// @return The window size in blocks.
+    size_t window_blocks()
+    {
+        return WINDOW_GROUPS_PER_WORKER * MAX_LANES * WorkStealingPool::shared().size();
+    }
+
+    /// @brief Cuts a framed line into blocks, each led by a flag telling whether more follow.
+    /// @param padded_line The framed line.
+    /// @param payload_bytes Bytes of the line per block.
+    /// @param emit Called with each block, in order.
+    template <typename Emit>
+    void cut_blocks(std::string_view padded_line, size_t payload_bytes, Emit emit)
+    {
+        for (size_t offset = 0; offset < padded_line.length(); offset += payload_bytes)
+        {
+            const char flag = offset + payload_bytes < padded_line.length() ? BLOCK_CONTINUES : BLOCK_FINAL;
+            std::string block(1, flag);
+            block.append(padded_line.substr(offset, payload_bytes));
+            emit(std::move(block));
+        }
+    }
+
+    /// @brief Reads the flag byte of a decrypted block.
+    /// @param block The decrypted block.
+    /// @return BLOCK_CONTINUES, BLOCK_FINAL, or something else for a malformed block.
+    char block_flag(const Bignum &block)
+    {
+        const std::vector<Limb> limbs = block.to_limbs();
+        const std::vector<std::uint8_t> bytes = limbs_to_bytes(limbs, byte_length(limbs));
+        return bytes.empty() ? 0 : static_cast<char>(bytes[0]);
+    }
+
+    /// @brief Counts the blocks of an encrypted line.
+    /// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+    /// @return The number of blocks.
+    size_t count_blocks(std::string_view encrypted_line)
+    {
+        size_t count = 0;
+        bool in_block = false;
+        for (const char ch : encrypted_line)
+        {
+            const bool is_digit = ch != ' ';
+            count += is_digit && !in_block;
+            in_block = is_digit;
+        }
+        return count;
+    }
+
+    /// @brief Joins the encrypted blocks of one line into a line of ciphertext.
+    /// @param blocks Encrypted blocks of many lines.
+    /// @param next Index of the line's first block; advanced past its last block.
+    /// @param count Number of blocks in the line.
+    /// @return The blocks in decimal, separated by spaces.
+    std::string join_blocks(const std::vector<Bignum> &blocks, size_t &next, size_t count)
+    {
+        std::string encrypted_line = blocks[next++].to_string();
+
+        // Blocks are all below the modulus, so the first one's width is a close estimate for the rest.
+        encrypted_line.reserve(count * (encrypted_line.size() + 1));
+        for (size_t j = 1; j < count; j++)
+        {
+            encrypted_line.push_back(' ');
+            encrypted_line += blocks[next++].to_string();
+        }
+        return encrypted_line;
+    }
+
+    /// @brief Splits an encrypted line into its blocks.
+    /// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+    /// @return The blocks, in order.
+    std::vector<Bignum> split_encrypted_line(std::string_view encrypted_line)
+    {
+        std::vector<Bignum> blocks;
+        size_t start = encrypted_line.find_first_not_of(' ');
+        while (start != std::string_view::npos)
+        {
+            const size_t end = std::min(encrypted_line.find(' ', start), encrypted_line.size());
+            blocks.emplace_back(encrypted_line.substr(start, end - start));
+            start = encrypted_line.find_first_not_of(' ', end);
+        }
 
-// Static constants for modular arithmetic using RSA parameters.
-const Bignum Bignum::public_mod(Bignum::rsa_n);
-const Bignum Bignum::public_exp(Bignum::rsa_e);
-const Bignum Bignum::priv_exp(Bignum::rsa_d);
+        if (blocks.empty())
+            throw std::runtime_error("Encrypted line holds no blocks");
+        return blocks;
+    }
+}
 
 /// @brief Default constructor that initializes an empty Bignum.
 Bignum::Bignum() : bignum_vector{} {}
 
 /// @brief Constructor that initializes a Bignum from a string representation.
+///
+/// The digit vector is sized once up front. With SSE2 the characters are validated and
+/// converted 16 at a time: one unsigned compare flags any byte outside '0'..'9', and the
+/// digit bytes are widened to int in registers before being stored.
 /// @param string_num A string representing a large integer.
-Bignum::Bignum(const std::string &string_num)
+/// @throws std::invalid_argument if the string contains a character other than a decimal digit.
+Bignum::Bignum(std::string_view string_num) : bignum_vector(string_num.size())
 {
-    for (char ch : string_num)
+    const unsigned char *chars = reinterpret_cast<const unsigned char *>(string_num.data());
+    int *digits = bignum_vector.data();
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= string_num.size(); i += 16)
+    {
+        const __m128i block = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(chars + i)), zero_char);
+
+        // Bytes below '0' wrap around to large values, so a single unsigned max test catches both ends.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(block, nine), nine)) != 0xFFFF)
+            throw std::invalid_argument("Invalid digit in decimal number");
+
+        const __m128i low = _mm_unpacklo_epi8(block, zero);
+        const __m128i high = _mm_unpackhi_epi8(block, zero);
+        __m128i *out = reinterpret_cast<__m128i *>(digits + i);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+    }
+#endif
+
+    for (; i < string_num.size(); i++)
     {
-        bignum_vector.push_back(ch - '0');
+        const unsigned digit = static_cast<unsigned>(chars[i]) - '0';
+        if (digit > 9)
+            throw std::invalid_argument("Invalid digit in decimal number");
+        digits[i] = static_cast<int>(digit);
     }
 }
 
+/// @brief Loads the RSA key used for encryption and decryption from a key file.
+/// @param path Path of the binary key file.
+void Bignum::load_key(const std::string &path)
+{
+    active_key = Keyring::shared().get(path);
+}
+
+/// @brief Returns the RSA key used when no key handle is passed.
+/// @return A handle to the active key context.
+KeyHandle Bignum::key()
+{
+    static std::once_flag compiled_key_once;
+
+    std::call_once(compiled_key_once, []()
+                   {
+        if (active_key)
+            return;
+
+        for (const std::string *value : {&rsa_n, &rsa_e, &rsa_d})
+        {
+            if (value->empty() || value->find_first_not_of("0123456789") != std::string::npos)
+                throw std::runtime_error("No RSA key loaded; pass --key or fill in rsa_n, rsa_e and rsa_d");
+        }
+
+        active_key = std::make_shared<const KeyContext>(Bignum(rsa_n).to_limbs(), Bignum(rsa_e).to_limbs(), Bignum(rsa_d).to_limbs()); });
+
+    return active_key;
+}
+
 /// @brief Removes leading zeros from the Bignum.
 void Bignum::remove_excess()
 {
@@ -52,6 +279,62 @@ void Bignum::remove_excess()
     }
 }
 
+/// @brief Converts the Bignum to little-endian limbs.
+/// @return The limbs, least significant first.
+std::vector<Limb> Bignum::to_limbs() const
+{
+    std::vector<Limb> limbs((bignum_vector.size() + LIMB_DIGITS - 1) / LIMB_DIGITS, 0);
+
+    for (size_t i = 0; i < bignum_vector.size(); i++)
+    {
+        const size_t pos = bignum_vector.size() - 1 - i;
+        Limb scale = 1;
+        for (size_t d = 0; d < i % LIMB_DIGITS; d++)
+            scale *= 10;
+        limbs[i / LIMB_DIGITS] += bignum_vector[pos] * scale;
+    }
+
+    while (!limbs.empty() && limbs.back() == 0)
+        limbs.pop_back();
+    return limbs;
+}
+
+/// @brief Builds a Bignum from little-endian limbs.
+/// @param limbs The limbs, least significant first.
+/// @return The Bignum holding the same value.
+Bignum Bignum::from_limbs(const std::vector<Limb> &limbs)
+{
+    size_t top = limbs.size();
+    while (top > 0 && limbs[top - 1] == 0)
+        top--;
+
+    Bignum result;
+    if (top == 0)
+    {
+        result.bignum_vector.push_back(0);
+        return result;
+    }
+
+    result.bignum_vector.reserve(top * LIMB_DIGITS);
+    for (size_t i = top; i-- > 0;)
+    {
+        Limb limb = limbs[i];
+        int digits[LIMB_DIGITS];
+        for (size_t d = LIMB_DIGITS; d-- > 0;)
+        {
+            digits[d] = limb % 10;
+            limb /= 10;
+        }
+
+        size_t first = 0;
+        if (i == top - 1)
+            while (first + 1 < LIMB_DIGITS && digits[first] == 0)
+                first++;
+        result.bignum_vector.insert(result.bignum_vector.end(), digits + first, digits + LIMB_DIGITS);
+    }
+    return result;
+}
+
 /// @brief Equality operator for Bignum.
 /// @param other The Bignum to compare with.
 /// @return True if both Bignums are equal, false otherwise.
@@ -82,8 +365,9 @@ bool Bignum::operator>(const Bignum &other) const
 }
 
 /// @brief Subtraction operator for Bignum.
-/// @param other The Bignum to subtract from this Bignum.
+/// @param other The Bignum to subtract from this Bignum; must not be greater than it.
 /// @return A new Bignum representing the result of the subtraction.
+/// @throws std::underflow_error if the result would be negative.
 Bignum Bignum::operator-(const Bignum &other) const
 {
     Bignum difference;
@@ -112,6 +396,10 @@ Bignum Bignum::operator-(const Bignum &other) const
         difference.bignum_vector[k] = curr_diff;
     }
 
+    // A borrow out of the top digit means other > *this; Bignum has no sign to represent that.
+    if (borrow != 0)
+        throw std::underflow_error("Bignum subtraction would be negative");
+
     difference.remove_excess();
     return difference;
 }
@@ -189,41 +477,71 @@ Bignum Bignum::operator%(const Bignum &other) const
 /// @return A new Bignum representing the modular exponentiation result.
 Bignum Bignum::mod_exponent(const Bignum &base, const Bignum &exponent, const Bignum &modulus) const
 {
-    Bignum mod_exp("1");
-    Bignum curr_base = base % modulus;
-    Bignum curr_exponent = exponent;
+    return mod_exponent_batch({base}, exponent, modulus).front();
+}
 
-    const Bignum zero("0");
-    const Bignum two("2");
+/// @brief Modular exponentiation of several independent bases with a shared exponent and modulus.
+/// @param bases The base Bignums.
+/// @param exponent The exponent Bignum.
+/// @param modulus The modulus Bignum.
+/// @return The modular exponentiation results, in the same order as the bases.
+std::vector<Bignum> Bignum::mod_exponent_batch(const std::vector<Bignum> &bases, const Bignum &exponent, const Bignum &modulus) const
+{
+    const LaneModulus lane_modulus(modulus.to_limbs());
+    const ExponentRecoding recoding(exponent.to_limbs());
+    return mod_exponent_batch(bases, recoding, lane_modulus);
+}
 
-    std::vector<std::future<Bignum>> futures;
-    std::mutex mod_exp_mutex;
+/// @brief Modular exponentiation of several independent bases with a precomputed exponent and modulus.
+/// @param bases The base Bignums.
+/// @param exponent The recoded exponent.
+/// @param modulus The modulus with its Barrett constant.
+/// @return The modular exponentiation results, in the same order as the bases.
+std::vector<Bignum> Bignum::mod_exponent_batch(const std::vector<Bignum> &bases, const ExponentRecoding &exponent, const LaneModulus &modulus) const
+{
+    std::vector<Bignum> results;
+    results.reserve(bases.size());
 
-    while (!(curr_exponent == zero))
+    for (size_t i = 0; i < bases.size(); i += MAX_LANES)
     {
-        std::vector<std::future<void>> mod_parallel;
+        const size_t lane_count = std::min(MAX_LANES, bases.size() - i);
+        std::vector<std::vector<Limb>> lanes;
+        lanes.reserve(lane_count);
 
-        if (curr_exponent.bignum_vector.back() % 2 != 0)
+        for (size_t l = 0; l < lane_count; l++)
         {
-            mod_parallel.push_back(std::async(std::launch::async, [&]()
-                                              {
-                                                  Bignum curr_mod_exp = (mod_exp * curr_base) % modulus;
-                                                  std::lock_guard<std::mutex> lock(mod_exp_mutex);
-                                                  mod_exp = curr_mod_exp; }));
+            std::vector<Limb> limbs = bases[i + l].to_limbs();
+            if (limbs.size() >= modulus.width())
+                limbs = modulus.reduce(limbs);
+            limbs.resize(modulus.width(), 0);
+            lanes.push_back(std::move(limbs));
         }
 
-        auto square_mod_future = std::async(std::launch::async, [&]()
-                                            { return (curr_base * curr_base) % modulus; });
+        mod_exponent_lanes(lanes, exponent, modulus);
 
-        for (auto &mod : mod_parallel)
-            mod.wait();
-
-        curr_base = square_mod_future.get();
-        curr_exponent = curr_exponent / two;
+        for (const auto &lane : lanes)
+            results.push_back(from_limbs(lane));
     }
 
-    mod_exp.remove_excess();
-    return mod_exp;
+    return results;
+}
+
+/// @brief Greatest common divisor using Lehmer's algorithm with a binary GCD tail.
+/// @param first The first Bignum.
+/// @param second The second Bignum.
+/// @return A new Bignum representing gcd(first, second).
+Bignum Bignum::gcd(const Bignum &first, const Bignum &second) const
+{
+    return from_limbs(gcd_limbs(first.to_limbs(), second.to_limbs()));
+}
+
+/// @brief Modular inverse using Lehmer's extended GCD with signed cofactors.
+/// @param value The Bignum to invert.
+/// @param modulus The modulus Bignum; must be greater than one.
+/// @return A new Bignum x with value * x = 1 (mod modulus).
+Bignum Bignum::mod_inverse(const Bignum &value, const Bignum &modulus) const
+{
+    return from_limbs(inverse_limbs(value.to_limbs(), modulus.to_limbs()));
 }
 
 /// @brief Converts the Bignum to a string representation.
@@ -238,127 +556,695 @@ std::string Bignum::to_string() const
     return result;
 }
 
-/// @brief Converts a string to a Bignum.
+/// @brief Converts a string to a Bignum by reading its bytes as a big-endian integer (OS2IP).
 /// @param str The string to convert.
 /// @return A Bignum representing the input string.
-Bignum Bignum::string_to_bignum(const std::string &str) const
+Bignum Bignum::string_to_bignum(std::string_view str) const
 {
-    std::string to_convert;
-
-    for (const char ch : str)
-    {
-        std::ostringstream oss;
-        oss << std::setw(3) << std::setfill('0') << static_cast<int>(static_cast<unsigned char>(ch));
-        to_convert += oss.str();
-    }
-
-    return Bignum(to_convert);
+    return from_limbs(bytes_to_limbs(std::vector<std::uint8_t>(str.begin(), str.end())));
 }
 
-/// @brief Converts a Bignum to a string.
+/// @brief Converts a Bignum to a string of a fixed number of big-endian bytes (I2OSP).
 /// @param bignum The Bignum to convert.
+/// @param length Number of bytes in the result; leading zero bytes are kept.
 /// @return A string representation of the Bignum.
-std::string Bignum::bignum_to_string(const Bignum &bignum) const
+std::string Bignum::bignum_to_string(const Bignum &bignum, size_t length) const
+{
+    const std::vector<std::uint8_t> bytes = limbs_to_bytes(bignum.to_limbs(), length);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+/// @brief Frames a line with its line number on both sides.
+/// @param input The input string to frame.
+/// @param line_num The line number to include in the framing.
+/// @return The framed string.
+std::string Bignum::padding(std::string_view input, int line_num) const
+{
+    std::ostringstream oss;
+    oss << std::setw(3) << std::setfill(' ') << line_num;
+    const std::string frame = oss.str();
+
+    std::string padded;
+    padded.reserve(2 * frame.length() + input.length());
+    padded.append(frame).append(input).append(frame);
+    return padded;
+}
+
+/// @brief Largest block, flag byte included, that is always below the modulus of a key.
+/// @param rsa_key The key the blocks are encrypted with.
+/// @return The block size in bytes; one less than the modulus length.
+/// @throws std::invalid_argument if the modulus is shorter than 3 bytes.
+size_t Bignum::block_bytes(const KeyContext &rsa_key)
+{
+    const size_t modulus_bytes = byte_length(rsa_key.modulus().limbs());
+    if (modulus_bytes < 3)
+        throw std::invalid_argument("RSA modulus is too small to hold a block");
+    return modulus_bytes - 1;
+}
+
+/// @brief Encrypts a large text using RSA in chunks.
+/// @param text The text to encrypt.
+/// @return One encrypted line per input line, its blocks separated by spaces.
+std::vector<std::string> Bignum::large_encrypt(std::string_view text) const
+{
+    return large_encrypt(text, key());
+}
+
+/// @brief Encrypts a large text using RSA in chunks with the given key.
+/// @param text The text to encrypt.
+/// @param rsa_key The key to encrypt with.
+/// @return One encrypted line per input line, its blocks separated by spaces.
+std::vector<std::string> Bignum::large_encrypt(std::string_view text, const KeyHandle &rsa_key) const
 {
-    std::string to_convert = bignum.to_string();
+    std::vector<std::string> encrypted_lines;
+    large_encrypt(text, rsa_key, [&encrypted_lines](std::string_view encrypted_line)
+                  { encrypted_lines.emplace_back(encrypted_line); });
+    return encrypted_lines;
+}
 
-    std::string new_str;
+/// @brief Encrypts a large text with the given key, handing over each encrypted line as it is done.
+/// @param text The text to encrypt.
+/// @param rsa_key The key to encrypt with.
+/// @param consume Receives each encrypted line, its blocks separated by spaces, in order.
+void Bignum::large_encrypt(std::string_view text, const KeyHandle &rsa_key, const Sink &consume) const
+{
+    const std::vector<std::string_view> lines = split_lines(text);
+    const std::vector<size_t> line_blocks = count_line_blocks(lines, *rsa_key);
+
+    // A line may straddle two windows, so its text is kept until its last block arrives.
+    std::string encrypted_line;
+    size_t line = 0, done = 0;
+    encrypt_windows(lines, *rsa_key, [&](const std::vector<Bignum> &blocks)
+                    {
+        for (const Bignum &block : blocks)
+        {
+            if (done > 0)
+                encrypted_line += ' ';
+            encrypted_line += block.to_string();
+            if (++done == line_blocks[line])
+            {
+                consume(encrypted_line);
+                encrypted_line.clear();
+                done = 0;
+                line++;
+            }
+        } });
+}
+
+/// @brief Encrypts several independent texts together, sharing lane batches between them.
+/// @param texts The texts to encrypt.
+/// @param rsa_key The key to encrypt with.
+/// @return For each text, one encrypted line per input line.
+std::vector<std::vector<std::string>> Bignum::large_encrypt_batch(const std::vector<std::string_view> &texts, const KeyHandle &rsa_key) const
+{
+    std::vector<std::string> blocks;
+    std::vector<size_t> line_blocks;
+    std::vector<size_t> text_lines;
+    for (const std::string_view text : texts)
+    {
+        const size_t lines_before = line_blocks.size();
+        frame_lines(text, *rsa_key, blocks, line_blocks);
+        text_lines.push_back(line_blocks.size() - lines_before);
+    }
 
-    if (to_convert.length() % 3 != 0)
-        to_convert.insert(0, 3 - (to_convert.length() % 3), '0');
+    const std::vector<Bignum> encrypted_blocks = encrypt_blocks(blocks, *rsa_key);
 
-    for (size_t i = 0; i < to_convert.length(); i += 3)
+    std::vector<std::vector<std::string>> encrypted_texts;
+    encrypted_texts.reserve(texts.size());
+    size_t line = 0, next = 0;
+    for (const size_t count : text_lines)
     {
-        const std::string ascii = to_convert.substr(i, 3);
-        new_str += static_cast<char>(std::stoi(ascii));
+        std::vector<std::string> encrypted_lines;
+        encrypted_lines.reserve(count);
+        for (size_t j = 0; j < count; j++)
+            encrypted_lines.push_back(join_blocks(encrypted_blocks, next, line_blocks[line++]));
+        encrypted_texts.push_back(std::move(encrypted_lines));
     }
 
-    return new_str;
+    return encrypted_texts;
 }
 
-/// @brief Pads a string with spaces and a line number.
-/// @param input The input string to pad.
-/// @param line_num The line number to include in the padding.
-/// @return A padded string.
-std::string Bignum::padding(const std::string &input, int line_num) const
+/// @brief Encrypts a large text into a binary ciphertext container.
+/// @param text The text to encrypt.
+/// @return The container bytes.
+std::string Bignum::large_encrypt_binary(std::string_view text) const
 {
-    std::ostringstream oss;
-    oss << std::setw(3) << std::setfill(' ') << line_num;
-    std::string result = oss.str() + input;
+    return large_encrypt_binary(text, key());
+}
 
-    const size_t padding_check = 102 - result.length();
+/// @brief Encrypts a large text into a binary ciphertext container with the given key.
+/// @param text The text to encrypt.
+/// @param rsa_key The key to encrypt with.
+/// @return The container bytes.
+std::string Bignum::large_encrypt_binary(std::string_view text, const KeyHandle &rsa_key) const
+{
+    std::vector<size_t> line_blocks;
+    std::string container;
+    large_encrypt_binary(text, rsa_key, line_blocks, [&](std::string_view piece)
+                         {
+        // The header arrives after the block counts, so the container is sized exactly once.
+        if (container.empty())
+        {
+            size_t total_blocks = 0;
+            for (const size_t count : line_blocks)
+                total_blocks += count;
+            container.reserve(piece.size() + total_blocks * byte_length(rsa_key->modulus().limbs()));
+        }
+        container.append(piece); });
+    return container;
+}
 
-    result.append(padding_check - 3, ' ');
-    result.append(oss.str());
+/// @brief Encrypts a large text into a binary ciphertext container, handing it over as it is written.
+/// @param text The text to encrypt.
+/// @param rsa_key The key to encrypt with.
+/// @param line_blocks Receives the number of blocks of each line, before the first call to consume.
+/// @param consume Receives the header, then the blocks of each window, in order.
+void Bignum::large_encrypt_binary(std::string_view text, const KeyHandle &rsa_key, std::vector<size_t> &line_blocks,
+                                  const Sink &consume) const
+{
+    const std::vector<std::string_view> lines = split_lines(text);
+    line_blocks = count_line_blocks(lines, *rsa_key);
+    consume(ciphertext_header(*rsa_key));
+
+    const size_t width = byte_length(rsa_key->modulus().limbs());
+    std::string window;
+    encrypt_windows(lines, *rsa_key, [&](const std::vector<Bignum> &blocks)
+                    {
+        window.resize(blocks.size() * width);
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            const std::vector<std::uint8_t> bytes = limbs_to_bytes(blocks[i].to_limbs(), width);
+            std::copy(bytes.begin(), bytes.end(), window.begin() + i * width);
+        }
+        consume(window); });
+}
 
-    return result;
+/// @brief Counts the blocks each line is cut into, without framing it.
+/// @param lines The lines; numbered from 1.
+/// @param rsa_key The key the blocks will be encrypted with.
+/// @return The number of blocks of each line.
+std::vector<size_t> Bignum::count_line_blocks(const std::vector<std::string_view> &lines, const KeyContext &rsa_key) const
+{
+    const size_t payload_bytes = block_bytes(rsa_key) - 1;
+    std::vector<size_t> line_blocks;
+    line_blocks.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        const size_t padded_length = lines[i].length() + padding("", static_cast<int>(i + 1)).length();
+        line_blocks.push_back((padded_length + payload_bytes - 1) / payload_bytes);
+    }
+    return line_blocks;
 }
 
-/// @brief Encrypts a large text using RSA in chunks.
-/// @param text The text to encrypt.
-/// @return A vector of encrypted pairs of strings.
-std::vector<std::pair<std::string, std::string>> Bignum::large_encrypt(const std::string &text) const
+/// @brief Frames and encrypts lines one window of blocks at a time.
+/// @param lines The lines; numbered from 1.
+/// @param rsa_key The key to encrypt with.
+/// @param consume Called with each window's encrypted blocks, in order.
+void Bignum::encrypt_windows(const std::vector<std::string_view> &lines, const KeyContext &rsa_key,
+                             const std::function<void(const std::vector<Bignum> &)> &consume) const
 {
-    std::vector<std::pair<std::string, std::string>> encrypted_lines;
-    std::istringstream stream(text);
-    std::string line;
+    const size_t payload_bytes = block_bytes(rsa_key) - 1;
+    const size_t window = window_blocks();
+
+    std::vector<std::string> blocks;
+    blocks.reserve(window);
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        cut_blocks(padding(lines[i], static_cast<int>(i + 1)), payload_bytes, [&](std::string block)
+                   {
+            blocks.push_back(std::move(block));
+            if (blocks.size() == window)
+            {
+                consume(encrypt_blocks(blocks, rsa_key));
+                blocks.clear();
+            } });
+    }
+
+    if (!blocks.empty())
+        consume(encrypt_blocks(blocks, rsa_key));
+}
+
+/// @brief Frames every line of a text with its line number and cuts it into flagged blocks.
+/// @param text The text to frame; its lines are numbered from 1.
+/// @param rsa_key The key the blocks will be encrypted with.
+/// @param blocks Receives the blocks, appended after any already there.
+/// @param line_blocks Receives the number of blocks of each line, appended likewise.
+void Bignum::frame_lines(std::string_view text, const KeyContext &rsa_key, std::vector<std::string> &blocks,
+                         std::vector<size_t> &line_blocks) const
+{
+    const size_t payload_bytes = block_bytes(rsa_key) - 1;
     int line_num = 1;
 
-    std::vector<std::future<std::pair<std::string, std::string>>> encrypt_parallel;
+    for (const std::string_view line : split_lines(text))
+    {
+        size_t count = 0;
+        cut_blocks(padding(line, line_num), payload_bytes, [&](std::string block)
+                   {
+            blocks.push_back(std::move(block));
+            count++; });
+        line_blocks.push_back(count);
+
+        line_num++;
+    }
+}
 
-    while (std::getline(stream, line))
+/// @brief Encrypts framed blocks, interleaving MAX_LANES of them per task.
+/// @param blocks The framed blocks, whichever lines they belong to.
+/// @param rsa_key The key to encrypt with.
+/// @return The encrypted blocks, in order.
+std::vector<Bignum> Bignum::encrypt_blocks(const std::vector<std::string> &blocks, const KeyContext &rsa_key) const
+{
+    // Each task interleaves MAX_LANES blocks, whichever lines they belong to. Tasks convert
+    // their own blocks and use their node's copy of the key, so all of their memory is local.
+    std::vector<std::vector<Bignum>> encrypted_groups((blocks.size() + MAX_LANES - 1) / MAX_LANES);
+    TaskGroup tasks;
+    for (size_t group = 0; group < encrypted_groups.size(); group++)
     {
-        if (line.length() > MAX_CHARS_PER_CHUNK)
-            line = line.substr(0, MAX_CHARS_PER_CHUNK);
+        tasks.run([this, group, &blocks, &encrypted_groups, &rsa_key]()
+                  {
+            const KeyContext &local_key = rsa_key.local();
+            std::vector<Bignum> messages;
+            for (size_t i = group * MAX_LANES; i < std::min((group + 1) * MAX_LANES, blocks.size()); i++)
+                messages.push_back(string_to_bignum(blocks[i]));
+            encrypted_groups[group] = mod_exponent_batch(messages, local_key.public_recoding(), local_key.modulus()); });
+    }
+    tasks.wait();
 
-        const std::string padded_line = padding(line, line_num);
+    std::vector<Bignum> encrypted_blocks;
+    encrypted_blocks.reserve(blocks.size());
+    for (std::vector<Bignum> &encrypted_group : encrypted_groups)
+        for (Bignum &block : encrypted_group)
+            encrypted_blocks.push_back(std::move(block));
 
-        encrypt_parallel.push_back(std::async(std::launch::async, [this, padded_line]() -> std::pair<std::string, std::string>
-                                              {
-            const Bignum first_encrypted = mod_exponent(string_to_bignum(padded_line.substr(0, 51)), public_exp, public_mod);
-            const Bignum second_encrypted = mod_exponent(string_to_bignum(padded_line.substr(51)), public_exp, public_mod);
-            return {first_encrypted.to_string(), second_encrypted.to_string()}; }));
+    return encrypted_blocks;
+}
 
-        line_num++;
+/// @brief Reassembles a line from its decrypted blocks and strips the line-number framing.
+/// @param blocks The decrypted blocks of the line, in order.
+/// @param line_num The line number the line was framed with.
+/// @return The original line of text.
+std::string Bignum::unpad_decrypted(const std::vector<Bignum> &blocks, int line_num) const
+{
+    std::string decrypted_str;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        // The flag byte is never zero, so the block's length is the length of its value.
+        const std::vector<Limb> limbs = blocks[i].to_limbs();
+        const std::string block = bignum_to_string(blocks[i], byte_length(limbs));
+
+        const char flag = i + 1 < blocks.size() ? BLOCK_CONTINUES : BLOCK_FINAL;
+        if (block.empty() || block[0] != flag)
+            throw std::runtime_error("Decrypted block is malformed; wrong key?");
+        decrypted_str.append(block, 1);
     }
 
-    for (auto &encryption : encrypt_parallel)
-        encrypted_lines.push_back(encryption.get());
+    const std::string frame = padding("", line_num);
+    const size_t frame_length = frame.length() / 2;
+    if (decrypted_str.length() < frame.length() ||
+        decrypted_str.compare(0, frame_length, frame, 0, frame_length) != 0 ||
+        decrypted_str.compare(decrypted_str.length() - frame_length, frame_length, frame, 0, frame_length) != 0)
+        throw std::runtime_error("Decrypted line does not carry line number " + std::to_string(line_num));
 
-    return encrypted_lines;
+    return decrypted_str.substr(frame_length, decrypted_str.length() - frame.length());
 }
 
-/// @brief Decrypts a large text using RSA.
-/// @param first The first part of the encrypted string.
-/// @param second The second part of the encrypted string.
+/// @brief Decrypts blocks with the private key, using CRT when the primes are known.
+/// @param blocks The encrypted blocks.
+/// @param rsa_key The key to decrypt with.
+/// @return The decrypted blocks, in the same order.
+std::vector<Bignum> Bignum::decrypt_blocks(const std::vector<Bignum> &blocks, const KeyContext &rsa_key) const
+{
+    const CrtParameters *crt = rsa_key.crt();
+    if (crt == nullptr)
+        return mod_exponent_batch(blocks, rsa_key.private_recoding(), rsa_key.modulus());
+
+    const std::vector<Bignum> mod_p = mod_exponent_batch(blocks, crt->exponent_p, crt->prime_p);
+    const std::vector<Bignum> mod_q = mod_exponent_batch(blocks, crt->exponent_q, crt->prime_q);
+
+    // Garner: m = m_q + q * (q^-1 * (m_p - m_q) mod p).
+    std::vector<Bignum> decrypted;
+    decrypted.reserve(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        const std::vector<Limb> m_p = mod_p[i].to_limbs();
+        const std::vector<Limb> m_q = mod_q[i].to_limbs();
+        const std::vector<Limb> m_q_reduced = crt->prime_p.reduce(m_q);
+
+        const std::vector<Limb> difference = compare_limbs(m_p, m_q_reduced) >= 0
+                                                 ? subtract_limbs(m_p, m_q_reduced)
+                                                 : subtract_limbs(add_limbs(m_p, crt->prime_p.limbs()), m_q_reduced);
+        const std::vector<Limb> h = crt->prime_p.reduce(multiply_limbs(crt->q_inverse, difference));
+
+        decrypted.push_back(from_limbs(add_limbs(m_q, multiply_limbs(h, crt->prime_q.limbs()))));
+    }
+
+    return decrypted;
+}
+
+/// @brief Decrypts one encrypted line using RSA.
+/// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+/// @param line_num The line number the line was encrypted as.
 /// @return The decrypted string.
-std::string Bignum::large_decrypt(const std::string &first, const std::string &second) const
+std::string Bignum::large_decrypt(std::string_view encrypted_line, int line_num) const
 {
-    Bignum first_decrypted, second_decrypted;
-    std::mutex result_mutex;
+    return large_decrypt(encrypted_line, line_num, key());
+}
 
-    std::thread first_thread([&]()
-                             { first_decrypted = mod_exponent(Bignum(first), priv_exp, public_mod); });
+/// @brief Decrypts one encrypted line using RSA with the given key.
+/// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+/// @param line_num The line number the line was encrypted as.
+/// @param rsa_key The key to decrypt with.
+/// @return The decrypted string.
+std::string Bignum::large_decrypt(std::string_view encrypted_line, int line_num, const KeyHandle &rsa_key) const
+{
+    return unpad_decrypted(decrypt_blocks(split_encrypted_line(encrypted_line), *rsa_key), line_num);
+}
 
-    std::thread second_thread([&]()
-                              { second_decrypted = mod_exponent(Bignum(second), priv_exp, public_mod); });
+/// @brief Decrypts many lines using RSA, interleaving the blocks of several lines.
+/// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+/// @param first_line Line number of the first given line.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::large_decrypt(const std::vector<std::string_view> &encrypted_lines, int first_line) const
+{
+    return large_decrypt(encrypted_lines, key(), first_line);
+}
 
-    first_thread.join();
-    second_thread.join();
+/// @brief Decrypts many lines using RSA with the given key, interleaving the blocks of several lines.
+/// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+/// @param rsa_key The key to decrypt with.
+/// @param first_line Line number of the first given line.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::large_decrypt(const std::vector<std::string_view> &encrypted_lines, const KeyHandle &rsa_key,
+                                               int first_line) const
+{
+    std::vector<int> line_nums(encrypted_lines.size());
+    for (size_t i = 0; i < line_nums.size(); i++)
+        line_nums[i] = first_line + static_cast<int>(i);
 
-    std::string decrypted_str;
+    return decrypt_lines(encrypted_lines, line_nums, *rsa_key);
+}
 
-    std::thread decryption_thread([&]()
-                                  {
-        decrypted_str = bignum_to_string(first_decrypted) + bignum_to_string(second_decrypted);
-        decrypted_str = decrypted_str.substr(3, decrypted_str.length() - 6);
+/// @brief Decrypts many lines with the given key, handing over each decrypted line as it is done.
+/// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+/// @param rsa_key The key to decrypt with.
+/// @param first_line Line number of the first given line.
+/// @param consume Receives each decrypted line, in order.
+void Bignum::large_decrypt(const std::vector<std::string_view> &encrypted_lines, const KeyHandle &rsa_key, int first_line,
+                           const Sink &consume) const
+{
+    const size_t window = window_blocks();
+    for (size_t begin = 0; begin < encrypted_lines.size();)
+    {
+        // Whole lines until the window is full; a line is never split between windows.
+        size_t end = begin, block_count = 0;
+        while (end < encrypted_lines.size() && block_count < window)
+            block_count += count_blocks(encrypted_lines[end++]);
+
+        const std::vector<std::string_view> run(encrypted_lines.begin() + begin, encrypted_lines.begin() + end);
+        std::vector<int> line_nums(run.size());
+        for (size_t i = 0; i < line_nums.size(); i++)
+            line_nums[i] = first_line + static_cast<int>(begin + i);
+
+        for (const std::string &decrypted_line : decrypt_lines(run, line_nums, *rsa_key))
+            consume(decrypted_line);
+        begin = end;
+    }
+}
+
+/// @brief Decrypts several independent ciphertexts together, sharing lane batches between them.
+/// @param ciphertexts For each ciphertext, its encrypted lines as produced by large_encrypt.
+/// @param rsa_key The key to decrypt with.
+/// @return For each ciphertext, its decrypted lines.
+std::vector<std::vector<std::string>> Bignum::large_decrypt_batch(const std::vector<std::vector<std::string_view>> &ciphertexts,
+                                                                  const KeyHandle &rsa_key) const
+{
+    std::vector<std::string_view> encrypted_lines;
+    std::vector<int> line_nums;
+    for (const std::vector<std::string_view> &ciphertext : ciphertexts)
+    {
+        encrypted_lines.insert(encrypted_lines.end(), ciphertext.begin(), ciphertext.end());
+        for (size_t i = 0; i < ciphertext.size(); i++)
+            line_nums.push_back(static_cast<int>(i + 1));
+    }
+
+    std::vector<std::string> decrypted_lines = decrypt_lines(encrypted_lines, line_nums, *rsa_key);
+
+    std::vector<std::vector<std::string>> decrypted_texts;
+    decrypted_texts.reserve(ciphertexts.size());
+    size_t next = 0;
+    for (const std::vector<std::string_view> &ciphertext : ciphertexts)
+    {
+        decrypted_texts.emplace_back(std::make_move_iterator(decrypted_lines.begin() + next),
+                                     std::make_move_iterator(decrypted_lines.begin() + next + ciphertext.size()));
+        next += ciphertext.size();
+    }
+
+    return decrypted_texts;
+}
+
+/// @brief Decrypts encrypted lines, interleaving the blocks of several lines per task.
+/// @param encrypted_lines The encrypted lines.
+/// @param line_nums The line number each line was encrypted as.
+/// @param rsa_key The key to decrypt with.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::decrypt_lines(const std::vector<std::string_view> &encrypted_lines, const std::vector<int> &line_nums,
+                                               const KeyContext &rsa_key) const
+{
+    // Each task takes whole lines until it holds at least MAX_LANES blocks.
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t i = 0; i < encrypted_lines.size();)
+    {
+        size_t end = i, block_count = 0;
+        while (end < encrypted_lines.size() && block_count < MAX_LANES)
+            block_count += count_blocks(encrypted_lines[end++]);
+        ranges.emplace_back(i, end);
+        i = end;
+    }
+
+    std::vector<std::vector<std::string>> decrypted_ranges(ranges.size());
+    TaskGroup tasks;
+    for (size_t range = 0; range < ranges.size(); range++)
+    {
+        tasks.run([this, range, &ranges, &decrypted_ranges, &encrypted_lines, &line_nums, &rsa_key]()
+                  {
+            const auto [i, end] = ranges[range];
+            std::vector<Bignum> blocks;
+            std::vector<size_t> line_blocks;
+            for (size_t j = i; j < end; j++)
+            {
+                std::vector<Bignum> line = split_encrypted_line(encrypted_lines[j]);
+                line_blocks.push_back(line.size());
+                blocks.insert(blocks.end(), line.begin(), line.end());
+            }
+
+            const std::vector<Bignum> decrypted = decrypt_blocks(blocks, rsa_key.local());
+
+            size_t next = 0;
+            for (size_t j = 0; j < line_blocks.size(); j++)
+            {
+                decrypted_ranges[range].push_back(unpad_decrypted(std::vector<Bignum>(decrypted.begin() + next, decrypted.begin() + next + line_blocks[j]),
+                                                                  line_nums[i + j]));
+                next += line_blocks[j];
+            }
+        });
+    }
+    tasks.wait();
+
+    std::vector<std::string> decrypted_lines;
+    decrypted_lines.reserve(encrypted_lines.size());
+    for (std::vector<std::string> &decrypted_range : decrypted_ranges)
+        for (std::string &line : decrypted_range)
+            decrypted_lines.push_back(std::move(line));
+
+    return decrypted_lines;
+}
+
+/// @brief Decrypts a binary ciphertext container.
+/// @param container The container bytes, as produced by large_encrypt_binary.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::large_decrypt_binary(std::string_view container) const
+{
+    return large_decrypt_binary(container, key());
+}
+
+/// @brief Decrypts a binary ciphertext container with the given key.
+/// @param container The container bytes, as produced by large_encrypt_binary.
+/// @param rsa_key The key to decrypt with.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::large_decrypt_binary(std::string_view container, const KeyHandle &rsa_key) const
+{
+    const CiphertextReader reader(reinterpret_cast<const std::uint8_t *>(container.data()), container.size(), *rsa_key);
+    std::vector<std::string> decrypted_lines;
+    decrypt_binary_range(reader, 0, reader.block_count(), 1, *rsa_key, [&decrypted_lines](std::string_view line)
+                         { decrypted_lines.emplace_back(line); });
+    return decrypted_lines;
+}
+
+/// @brief Decrypts a run of lines from a binary ciphertext container, leaving the other blocks untouched.
+/// @param container The container bytes, as produced by large_encrypt_binary.
+/// @param begin Byte offset of the first block of the first line, as recorded in a line index.
+/// @param end Byte offset one past the last block of the last line.
+/// @param first_line Line number of the first line in the run.
+/// @param rsa_key The key to decrypt with.
+/// @return The decrypted lines, in order.
+std::vector<std::string> Bignum::large_decrypt_binary(std::string_view container, std::uint64_t begin, std::uint64_t end,
+                                                      int first_line, const KeyHandle &rsa_key) const
+{
+    std::vector<std::string> decrypted_lines;
+    large_decrypt_binary(container, begin, end, first_line, rsa_key, [&decrypted_lines](std::string_view line)
+                         { decrypted_lines.emplace_back(line); });
+    return decrypted_lines;
+}
 
-        while (!decrypted_str.empty() && decrypted_str.back() == ' ')
+/// @brief Decrypts a run of lines from a binary ciphertext container, handing over each line as it is done.
+/// @param container The container bytes, as produced by large_encrypt_binary.
+/// @param begin Byte offset of the first block of the first line.
+/// @param end Byte offset one past the last block of the last line.
+/// @param first_line Line number of the first line in the run.
+/// @param rsa_key The key to decrypt with.
+/// @param consume Receives each decrypted line, in order.
+void Bignum::large_decrypt_binary(std::string_view container, std::uint64_t begin, std::uint64_t end, int first_line,
+                                  const KeyHandle &rsa_key, const Sink &consume) const
+{
+    const CiphertextReader reader(reinterpret_cast<const std::uint8_t *>(container.data()), container.size(), *rsa_key);
+
+    const std::uint64_t header_bytes = sizeof(CiphertextHeader);
+    const std::uint64_t width = reader.block_bytes();
+    if (begin < header_bytes || end < begin || end > container.size() ||
+        (begin - header_bytes) % width != 0 || (end - header_bytes) % width != 0)
+        throw std::runtime_error("Line offsets do not match the ciphertext container");
+
+    decrypt_binary_range(reader, static_cast<size_t>((begin - header_bytes) / width),
+                         static_cast<size_t>((end - header_bytes) / width), first_line, *rsa_key, consume);
+}
+
+/// @brief Decrypts a run of whole lines from a binary ciphertext container.
+/// @param reader The validated container.
+/// @param first_block Index of the first block of the first line.
+/// @param end_block Index one past the last block of the last line.
+/// @param first_line Line number of the first line.
+/// @param rsa_key The key to decrypt with.
+/// @param consume Receives each decrypted line, in order, as soon as its window is done.
+void Bignum::decrypt_binary_range(const CiphertextReader &reader, size_t first_block, size_t end_block, int first_line,
+                                  const KeyContext &rsa_key, const Sink &consume) const
+{
+    const size_t window = window_blocks();
+    std::vector<Bignum> line;
+    int line_num = first_line;
+
+    for (size_t window_begin = first_block; window_begin < end_block; window_begin += window)
+    {
+        // Line boundaries are only visible after decryption, so tasks take fixed runs of blocks.
+        const size_t window_end = std::min(window_begin + window, end_block);
+        std::vector<std::vector<Bignum>> decrypted_groups((window_end - window_begin + MAX_LANES - 1) / MAX_LANES);
+        TaskGroup tasks;
+        for (size_t group = 0; group < decrypted_groups.size(); group++)
         {
-            decrypted_str.pop_back();
-        } });
+            tasks.run([this, group, window_begin, window_end, &decrypted_groups, &reader, &rsa_key]()
+                      {
+                const size_t begin = window_begin + group * MAX_LANES;
+                std::vector<Bignum> blocks;
+                for (size_t j = begin; j < std::min(begin + MAX_LANES, window_end); j++)
+                    blocks.push_back(from_limbs(reader.block(j)));
+                decrypted_groups[group] = decrypt_blocks(blocks, rsa_key.local()); });
+        }
+        tasks.wait();
+
+        // A line may straddle two windows, so its blocks are kept until its last one arrives.
+        for (std::vector<Bignum> &decrypted_group : decrypted_groups)
+        {
+            for (Bignum &block : decrypted_group)
+            {
+                const bool last = block_flag(block) == BLOCK_FINAL;
+                line.push_back(std::move(block));
+                if (last)
+                {
+                    consume(unpad_decrypted(line, line_num++));
+                    line.clear();
+                }
+            }
+        }
+    }
+
+    if (!line.empty())
+        throw std::runtime_error("Ciphertext container ends inside a line");
+}
+
+/// @brief Encrypts arbitrary data with a fresh session key protected by RSA.
+/// @param data The bytes to encrypt.
+/// @return The hybrid container.
+std::string Bignum::hybrid_encrypt(std::string_view data) const
+{
+    return hybrid_encrypt(data, key());
+}
+
+/// @brief Encrypts arbitrary data with a fresh session key protected by RSA with the given key.
+/// @param data The bytes to encrypt.
+/// @param rsa_key The key to protect the session key with.
+/// @return The hybrid container.
+std::string Bignum::hybrid_encrypt(std::string_view data, const KeyHandle &rsa_key) const
+{
+    const size_t key_length = byte_length(rsa_key->modulus().limbs());
+    if (key_length < AEAD_KEY_BYTES + SESSION_KEY_MIN_PADDING + 3)
+        throw std::invalid_argument("RSA modulus is too small to carry a session key");
+
+    const std::vector<std::uint8_t> session_key = random_bytes(AEAD_KEY_BYTES);
+    const std::string key_block = pad_session_key(session_key, key_length);
+    const Bignum encrypted_key = mod_exponent_batch({string_to_bignum(key_block)}, rsa_key->public_recoding(), rsa_key->modulus())[0];
+
+    const std::vector<std::uint8_t> nonce = random_bytes(AEAD_NONCE_BYTES);
 
-    decryption_thread.join();
+    std::string container(HYBRID_MAGIC, sizeof(HYBRID_MAGIC));
+    container += bignum_to_string(encrypted_key, key_length);
+    container.append(nonce.begin(), nonce.end());
 
-    return decrypted_str;
+    // Everything before the payload is authenticated as additional data.
+    const size_t header_length = container.length();
+    container.resize(header_length + data.length() + AEAD_TAG_BYTES);
+    std::uint8_t *bytes = reinterpret_cast<std::uint8_t *>(container.data());
+    aead_seal(session_key.data(), nonce.data(), bytes, header_length, reinterpret_cast<const std::uint8_t *>(data.data()),
+              data.length(), bytes + header_length, bytes + header_length + data.length());
+
+    return container;
+}
+
+/// @brief Decrypts a container produced by hybrid_encrypt.
+/// @param container The hybrid container.
+/// @return The original bytes.
+std::string Bignum::hybrid_decrypt(std::string_view container) const
+{
+    return hybrid_decrypt(container, key());
+}
+
+/// @brief Decrypts a container produced by hybrid_encrypt with the given key.
+/// @param container The hybrid container.
+/// @param rsa_key The key the session key was protected with.
+/// @return The original bytes.
+std::string Bignum::hybrid_decrypt(std::string_view container, const KeyHandle &rsa_key) const
+{
+    const size_t key_length = byte_length(rsa_key->modulus().limbs());
+    if (key_length < AEAD_KEY_BYTES + SESSION_KEY_MIN_PADDING + 3)
+        throw std::invalid_argument("RSA modulus is too small to carry a session key");
+    const size_t header_length = sizeof(HYBRID_MAGIC) + key_length + AEAD_NONCE_BYTES;
+    if (container.length() < header_length + AEAD_TAG_BYTES ||
+        container.compare(0, sizeof(HYBRID_MAGIC), HYBRID_MAGIC, sizeof(HYBRID_MAGIC)) != 0)
+        throw std::runtime_error("Not a hybrid container for this key");
+
+    const Bignum encrypted_key = string_to_bignum(container.substr(sizeof(HYBRID_MAGIC), key_length));
+    if (compare_limbs(encrypted_key.to_limbs(), rsa_key->modulus().limbs()) >= 0)
+        throw std::runtime_error("Not a hybrid container for this key");
+
+    const Bignum key_value = decrypt_blocks({encrypted_key}, *rsa_key)[0];
+    const std::vector<std::uint8_t> session_key = unpad_session_key(bignum_to_string(key_value, key_length));
+
+    // A malformed session key block gets a random key and ends here too, with the same error.
+    const std::uint8_t *bytes = reinterpret_cast<const std::uint8_t *>(container.data());
+    const size_t payload_length = container.length() - header_length - AEAD_TAG_BYTES;
+    std::string data(payload_length, '\0');
+    if (!aead_open(session_key.data(), bytes + sizeof(HYBRID_MAGIC) + key_length,
+                   bytes, header_length, bytes + header_length, payload_length, bytes + header_length + payload_length,
+                   reinterpret_cast<std::uint8_t *>(data.data())))
+        throw std::runtime_error("Hybrid payload failed authentication; wrong key or corrupted data");
+
+    return data;
 }
@@ -6,36 +6,139 @@
 /// exponentiation. The class is optimized for cryptographic applications and supports
 /// operations such as encryption and decryption using RSA.
 
+#pragma once
+
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
+#include "modexp_lanes.hpp"
+#include "keycontext.hpp"
+
+class CiphertextReader;
 
 /// @class Bignum
 /// @brief A class for representing and manipulating large integers.
 class Bignum
 {
+public:
+    /// @brief Receives output piece by piece, in order; a piece is only valid during the call.
+    using Sink = std::function<void(std::string_view)>;
+
 private:
     std::vector<int> bignum_vector; ///< Internal representation of the large integer as a vector of digits.
 
     static const std::string rsa_n; ///< RSA modulus (placeholder).
     static const std::string rsa_e; ///< RSA public exponent (placeholder).
     static const std::string rsa_d; ///< RSA private exponent (placeholder).
-    static const size_t MAX_CHARS_PER_CHUNK; ///< Maximum characters allowed per chunk in encryption.
 
-    static const Bignum public_mod; ///< Bignum representation of RSA modulus.
-    static const Bignum public_exp; ///< Bignum representation of RSA public exponent.
-    static const Bignum priv_exp; ///< Bignum representation of RSA private exponent.
+    static KeyHandle active_key; ///< Key used when no key handle is passed.
 
     /// @brief Removes leading zeros from the Bignum.
     void remove_excess();
 
+    /// @brief Decrypts blocks with the private key, using CRT when the primes are known.
+    /// @param blocks The encrypted blocks.
+    /// @param rsa_key The key to decrypt with.
+    /// @return The decrypted blocks, in the same order.
+    std::vector<Bignum> decrypt_blocks(const std::vector<Bignum> &blocks, const KeyContext &rsa_key) const;
+
+    /// @brief Frames every line of a text with its line number and cuts it into flagged blocks.
+    /// @param text The text to frame; its lines are numbered from 1.
+    /// @param rsa_key The key the blocks will be encrypted with.
+    /// @param blocks Receives the blocks, appended after any already there.
+    /// @param line_blocks Receives the number of blocks of each line, appended likewise.
+    void frame_lines(std::string_view text, const KeyContext &rsa_key, std::vector<std::string> &blocks,
+                     std::vector<size_t> &line_blocks) const;
+
+    /// @brief Encrypts framed blocks, interleaving MAX_LANES of them per task.
+    /// @param blocks The framed blocks, whichever lines they belong to.
+    /// @param rsa_key The key to encrypt with.
+    /// @return The encrypted blocks, in order.
+    std::vector<Bignum> encrypt_blocks(const std::vector<std::string> &blocks, const KeyContext &rsa_key) const;
+
+    /// @brief Counts the blocks each line is cut into, without framing it.
+    /// @param lines The lines; numbered from 1.
+    /// @param rsa_key The key the blocks will be encrypted with.
+    /// @return The number of blocks of each line.
+    std::vector<size_t> count_line_blocks(const std::vector<std::string_view> &lines, const KeyContext &rsa_key) const;
+
+    /// @brief Frames and encrypts lines one window of blocks at a time.
+    ///
+    /// Only one window of framed and encrypted blocks exists at once, so memory does not
+    /// grow with the text. A window holds a fixed number of lane groups per pool worker.
+    /// @param lines The lines; numbered from 1.
+    /// @param rsa_key The key to encrypt with.
+    /// @param consume Called with each window's encrypted blocks, in order.
+    void encrypt_windows(const std::vector<std::string_view> &lines, const KeyContext &rsa_key,
+                         const std::function<void(const std::vector<Bignum> &)> &consume) const;
+
+    /// @brief Decrypts encrypted lines, interleaving the blocks of several lines per task.
+    /// @param encrypted_lines The encrypted lines.
+    /// @param line_nums The line number each line was encrypted as.
+    /// @param rsa_key The key to decrypt with.
+    /// @return The decrypted lines, in order.
+    std::vector<std::string> decrypt_lines(const std::vector<std::string_view> &encrypted_lines, const std::vector<int> &line_nums,
+                                           const KeyContext &rsa_key) const;
+
+    /// @brief Reassembles a line from its decrypted blocks and strips the line-number framing.
+    /// @param blocks The decrypted blocks of the line, in order.
+    /// @param line_num The line number the line was framed with.
+    /// @return The original line of text.
+    std::string unpad_decrypted(const std::vector<Bignum> &blocks, int line_num) const;
+
+    /// @brief Decrypts a run of whole lines from a binary ciphertext container.
+    /// @param reader The validated container.
+    /// @param first_block Index of the first block of the first line.
+    /// @param end_block Index one past the last block of the last line.
+    /// @param first_line Line number of the first line.
+    /// @param rsa_key The key to decrypt with.
+    /// @param consume Receives each decrypted line, in order, as soon as its window is done.
+    /// @throws std::runtime_error if a block is malformed or the run ends inside a line.
+    void decrypt_binary_range(const CiphertextReader &reader, size_t first_block, size_t end_block, int first_line,
+                              const KeyContext &rsa_key, const Sink &consume) const;
+
 public:
     /// @brief Default constructor that initializes an empty Bignum.
     Bignum();
 
     /// @brief Constructor that initializes a Bignum from a string representation.
     /// @param string_num A string representing a large integer.
-    Bignum(const std::string &string_num);
+    /// @throws std::invalid_argument if the string contains a character other than a decimal digit.
+    Bignum(std::string_view string_num);
+
+    /// @brief Loads the RSA key used for encryption and decryption from a key file.
+    ///
+    /// The file is loaded through Keyring::shared(), so a file loaded before is not read again
+    /// unless it has changed on disk since.
+    /// @param path Path of the binary key file.
+    static void load_key(const std::string &path);
+
+    /// @brief Returns the RSA key used when no key handle is passed.
+    ///
+    /// Falls back to the compiled-in rsa_n, rsa_e and rsa_d values, parsed on first use,
+    /// when no key file has been loaded.
+    /// @return A handle to the active key context.
+    static KeyHandle key();
+
+    /// @brief Largest block, flag byte included, that is always below the modulus of a key.
+    ///
+    /// Each block is one flag byte (more blocks follow, or last block of the line)
+    /// followed by as many bytes of the framed line as fit.
+    /// @param rsa_key The key the blocks are encrypted with.
+    /// @return The block size in bytes; one less than the modulus length.
+    /// @throws std::invalid_argument if the modulus is shorter than 3 bytes.
+    static size_t block_bytes(const KeyContext &rsa_key);
+
+    /// @brief Converts the Bignum to little-endian limbs.
+    /// @return The limbs, least significant first.
+    std::vector<Limb> to_limbs() const;
+
+    /// @brief Builds a Bignum from little-endian limbs.
+    /// @param limbs The limbs, least significant first.
+    /// @return The Bignum holding the same value.
+    static Bignum from_limbs(const std::vector<Limb> &limbs);
 
     /// @brief Equality operator for Bignum.
     /// @param other The Bignum to compare with.
@@ -53,8 +156,9 @@ public:
     bool operator>(const Bignum &other) const;
 
     /// @brief Subtraction operator for Bignum.
-    /// @param other The Bignum to subtract from this Bignum.
+    /// @param other The Bignum to subtract from this Bignum; must not be greater than it.
     /// @return A new Bignum representing the result of the subtraction.
+    /// @throws std::underflow_error if the result would be negative.
     Bignum operator-(const Bignum &other) const;
 
     /// @brief Multiplication operator for Bignum.
@@ -79,34 +183,221 @@ public:
     /// @return A new Bignum representing the modular exponentiation result.
     Bignum mod_exponent(const Bignum &base, const Bignum &exponent, const Bignum &modulus) const;
 
+    /// @brief Modular exponentiation of several independent bases with a shared exponent and modulus.
+    ///
+    /// Bases are processed MAX_LANES at a time with their limb loops interleaved.
+    /// @param bases The base Bignums.
+    /// @param exponent The exponent Bignum.
+    /// @param modulus The modulus Bignum.
+    /// @return The modular exponentiation results, in the same order as the bases.
+    std::vector<Bignum> mod_exponent_batch(const std::vector<Bignum> &bases, const Bignum &exponent, const Bignum &modulus) const;
+
+    /// @brief Modular exponentiation of several independent bases with a precomputed exponent and modulus.
+    /// @param bases The base Bignums.
+    /// @param exponent The recoded exponent.
+    /// @param modulus The modulus with its Barrett constant.
+    /// @return The modular exponentiation results, in the same order as the bases.
+    std::vector<Bignum> mod_exponent_batch(const std::vector<Bignum> &bases, const ExponentRecoding &exponent, const LaneModulus &modulus) const;
+
+    /// @brief Greatest common divisor using Lehmer's algorithm with a binary GCD tail.
+    /// @param first The first Bignum.
+    /// @param second The second Bignum.
+    /// @return A new Bignum representing gcd(first, second).
+    Bignum gcd(const Bignum &first, const Bignum &second) const;
+
+    /// @brief Modular inverse using Lehmer's extended GCD with signed cofactors.
+    /// @param value The Bignum to invert.
+    /// @param modulus The modulus Bignum; must be greater than one.
+    /// @return A new Bignum x with value * x = 1 (mod modulus).
+    /// @throws std::invalid_argument if value and modulus are not coprime.
+    Bignum mod_inverse(const Bignum &value, const Bignum &modulus) const;
+
     /// @brief Converts the Bignum to a string representation.
     /// @return A string representation of the Bignum.
     std::string to_string() const;
 
-    /// @brief Converts a string to a Bignum.
+    /// @brief Converts a string to a Bignum by reading its bytes as a big-endian integer (OS2IP).
     /// @param str The string to convert.
     /// @return A Bignum representing the input string.
-    Bignum string_to_bignum(const std::string &str) const;
+    Bignum string_to_bignum(std::string_view str) const;
 
-    /// @brief Converts a Bignum to a string.
+    /// @brief Converts a Bignum to a string of a fixed number of big-endian bytes (I2OSP).
     /// @param bignum The Bignum to convert.
+    /// @param length Number of bytes in the result; leading zero bytes are kept.
     /// @return A string representation of the Bignum.
-    std::string bignum_to_string(const Bignum &bignum) const;
+    /// @throws std::overflow_error if the Bignum does not fit in the given length.
+    std::string bignum_to_string(const Bignum &bignum, size_t length) const;
 
-    /// @brief Pads a string with spaces and a line number.
-    /// @param input The input string to pad.
-    /// @param line_num The line number to include in the padding.
-    /// @return A padded string.
-    std::string padding(const std::string &input, int line_num) const;
+    /// @brief Frames a line with its line number on both sides.
+    /// @param input The input string to frame.
+    /// @param line_num The line number to include in the framing.
+    /// @return The framed string.
+    std::string padding(std::string_view input, int line_num) const;
 
     /// @brief Encrypts a large text using RSA in chunks.
     /// @param text The text to encrypt.
-    /// @return A vector of encrypted pairs of strings.
-    std::vector<std::pair<std::string, std::string>> large_encrypt(const std::string &text) const;
+    /// @return One encrypted line per input line, its blocks separated by spaces.
+    std::vector<std::string> large_encrypt(std::string_view text) const;
+
+    /// @brief Encrypts a large text using RSA in chunks with the given key.
+    /// @param text The text to encrypt.
+    /// @param rsa_key The key to encrypt with.
+    /// @return One encrypted line per input line, its blocks separated by spaces.
+    std::vector<std::string> large_encrypt(std::string_view text, const KeyHandle &rsa_key) const;
+
+    /// @brief Encrypts a large text with the given key, handing over each encrypted line as it is done.
+    ///
+    /// Lines are encrypted one window at a time, so memory stays bounded however long the text is.
+    /// @param text The text to encrypt.
+    /// @param rsa_key The key to encrypt with.
+    /// @param consume Receives each encrypted line, its blocks separated by spaces, in order.
+    void large_encrypt(std::string_view text, const KeyHandle &rsa_key, const Sink &consume) const;
+
+    /// @brief Encrypts several independent texts together, sharing lane batches between them.
+    ///
+    /// Each text is framed as if it were encrypted on its own, so the result for a text is
+    /// the same as large_encrypt(text) would give; only the modular exponentiations are pooled.
+    /// @param texts The texts to encrypt.
+    /// @param rsa_key The key to encrypt with.
+    /// @return For each text, one encrypted line per input line.
+    std::vector<std::vector<std::string>> large_encrypt_batch(const std::vector<std::string_view> &texts, const KeyHandle &rsa_key) const;
+
+    /// @brief Decrypts one encrypted line using RSA.
+    /// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+    /// @param line_num The line number the line was encrypted as.
+    /// @return The decrypted string.
+    std::string large_decrypt(std::string_view encrypted_line, int line_num) const;
 
-    /// @brief Decrypts a large text using RSA.
-    /// @param first The first part of the encrypted string.
-    /// @param second The second part of the encrypted string.
+    /// @brief Decrypts one encrypted line using RSA with the given key.
+    /// @param encrypted_line The encrypted blocks of the line, separated by spaces.
+    /// @param line_num The line number the line was encrypted as.
+    /// @param rsa_key The key to decrypt with.
     /// @return The decrypted string.
-    std::string large_decrypt(const std::string &first, const std::string &second) const;
+    std::string large_decrypt(std::string_view encrypted_line, int line_num, const KeyHandle &rsa_key) const;
+
+    /// @brief Decrypts many lines using RSA, interleaving the blocks of several lines.
+    /// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+    /// @param first_line Line number of the first given line, for a run taken from the middle of a file.
+    /// @return The decrypted lines, in order.
+    std::vector<std::string> large_decrypt(const std::vector<std::string_view> &encrypted_lines, int first_line = 1) const;
+
+    /// @brief Decrypts many lines using RSA with the given key, interleaving the blocks of several lines.
+    /// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+    /// @param rsa_key The key to decrypt with.
+    /// @param first_line Line number of the first given line, for a run taken from the middle of a file.
+    /// @return The decrypted lines, in order.
+    std::vector<std::string> large_decrypt(const std::vector<std::string_view> &encrypted_lines, const KeyHandle &rsa_key,
+                                           int first_line = 1) const;
+
+    /// @brief Decrypts many lines with the given key, handing over each decrypted line as it is done.
+    ///
+    /// Lines are decrypted one window at a time, so memory stays bounded however many there are.
+    /// @param encrypted_lines The encrypted lines, as produced by large_encrypt.
+    /// @param rsa_key The key to decrypt with.
+    /// @param first_line Line number of the first given line.
+    /// @param consume Receives each decrypted line, in order.
+    void large_decrypt(const std::vector<std::string_view> &encrypted_lines, const KeyHandle &rsa_key, int first_line,
+                       const Sink &consume) const;
+
+    /// @brief Decrypts several independent ciphertexts together, sharing lane batches between them.
+    /// @param ciphertexts For each ciphertext, its encrypted lines as produced by large_encrypt.
+    /// @param rsa_key The key to decrypt with.
+    /// @return For each ciphertext, its decrypted lines.
+    /// @throws std::runtime_error if any line is malformed; the whole batch fails.
+    std::vector<std::vector<std::string>> large_decrypt_batch(const std::vector<std::vector<std::string_view>> &ciphertexts,
+                                                              const KeyHandle &rsa_key) const;
+
+    /// @brief Encrypts a large text into a binary ciphertext container.
+    /// @param text The text to encrypt.
+    /// @return The container bytes: a header, then one modulus-width block after another.
+    std::string large_encrypt_binary(std::string_view text) const;
+
+    /// @brief Encrypts a large text into a binary ciphertext container with the given key.
+    /// @param text The text to encrypt.
+    /// @param rsa_key The key to encrypt with.
+    /// @return The container bytes: a header, then one modulus-width block after another.
+    std::string large_encrypt_binary(std::string_view text, const KeyHandle &rsa_key) const;
+
+    /// @brief Encrypts a large text into a binary ciphertext container, handing it over as it is written.
+    ///
+    /// The block count of every line is known from the framing alone, so line_blocks (and with
+    /// it the container size) is filled before anything is encrypted. The blocks are then
+    /// encrypted and handed over one window at a time, so memory stays bounded however long
+    /// the text is.
+    /// @param text The text to encrypt.
+    /// @param rsa_key The key to encrypt with.
+    /// @param line_blocks Receives the number of blocks of each line, before the first call to consume.
+    /// @param consume Receives the header, then the blocks of each window, in order.
+    void large_encrypt_binary(std::string_view text, const KeyHandle &rsa_key, std::vector<size_t> &line_blocks,
+                              const Sink &consume) const;
+
+    /// @brief Decrypts a binary ciphertext container.
+    /// @param container The container bytes, as produced by large_encrypt_binary.
+    /// @return The decrypted lines, in order.
+    std::vector<std::string> large_decrypt_binary(std::string_view container) const;
+
+    /// @brief Decrypts a binary ciphertext container with the given key.
+    /// @param container The container bytes, as produced by large_encrypt_binary.
+    /// @param rsa_key The key to decrypt with.
+    /// @return The decrypted lines, in order.
+    std::vector<std::string> large_decrypt_binary(std::string_view container, const KeyHandle &rsa_key) const;
+
+    /// @brief Decrypts a run of lines from a binary ciphertext container, leaving the other blocks untouched.
+    /// @param container The container bytes, as produced by large_encrypt_binary.
+    /// @param begin Byte offset of the first block of the first line, as recorded in a line index.
+    /// @param end Byte offset one past the last block of the last line.
+    /// @param first_line Line number of the first line in the run.
+    /// @param rsa_key The key to decrypt with.
+    /// @return The decrypted lines, in order.
+    /// @throws std::runtime_error if the offsets do not fall on block boundaries inside the container.
+    std::vector<std::string> large_decrypt_binary(std::string_view container, std::uint64_t begin, std::uint64_t end,
+                                                  int first_line, const KeyHandle &rsa_key) const;
+
+    /// @brief Decrypts a run of lines from a binary ciphertext container, handing over each line as it is done.
+    ///
+    /// Blocks are decrypted one window at a time, so memory stays bounded however long the run is.
+    /// @param container The container bytes, as produced by large_encrypt_binary.
+    /// @param begin Byte offset of the first block of the first line; sizeof(CiphertextHeader) for the whole container.
+    /// @param end Byte offset one past the last block of the last line; the container size for the whole container.
+    /// @param first_line Line number of the first line in the run.
+    /// @param rsa_key The key to decrypt with.
+    /// @param consume Receives each decrypted line, in order.
+    /// @throws std::runtime_error if the offsets do not fall on block boundaries inside the container.
+    void large_decrypt_binary(std::string_view container, std::uint64_t begin, std::uint64_t end, int first_line,
+                              const KeyHandle &rsa_key, const Sink &consume) const;
+
+    /// @brief Encrypts arbitrary data with a fresh session key protected by RSA.
+    ///
+    /// The result holds a magic tag, the RSA-encrypted ChaCha20-Poly1305 session key, a
+    /// nonce, the encrypted data and the authentication tag. The session key is padded to the
+    /// full modulus width with random non-zero bytes (PKCS#1 v1.5) before encryption.
+    /// @param data The bytes to encrypt.
+    /// @return The hybrid container.
+    /// @throws std::invalid_argument if the modulus is shorter than 43 bytes.
+    std::string hybrid_encrypt(std::string_view data) const;
+
+    /// @brief Encrypts arbitrary data with a fresh session key protected by RSA with the given key.
+    /// @param data The bytes to encrypt.
+    /// @param rsa_key The key to protect the session key with.
+    /// @return The hybrid container.
+    /// @throws std::invalid_argument if the modulus is shorter than 43 bytes.
+    std::string hybrid_encrypt(std::string_view data, const KeyHandle &rsa_key) const;
+
+    /// @brief Decrypts a container produced by hybrid_encrypt.
+    /// @param container The hybrid container.
+    /// @return The original bytes.
+    /// @throws std::runtime_error if the container is malformed or fails authentication.
+    std::string hybrid_decrypt(std::string_view container) const;
+
+    /// @brief Decrypts a container produced by hybrid_encrypt with the given key.
+    ///
+    /// Once the session key has been decrypted, every failure, a malformed padding block
+    /// included, is the same authentication error, so the result reveals nothing about the
+    /// padding (implicit rejection).
+    /// @param container The hybrid container.
+    /// @param rsa_key The key the session key was protected with.
+    /// @return The original bytes.
+    /// @throws std::invalid_argument if the modulus is shorter than 43 bytes.
+    /// @throws std::runtime_error if the container is malformed or fails authentication.
+    std::string hybrid_decrypt(std::string_view container, const KeyHandle &rsa_key) const;
 };
@@ -0,0 +1,317 @@
+/// @file bignum_c.cpp
+/// @brief Implementation of the C interface to the bignum_core library.
+
+#include "bignum_c.h"
+#include "bignum.hpp"
+#include "huge_pages.hpp"
+#include "io.hpp"
+#include "keyring.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+/// @brief A loaded key and the Bignum instance used with it.
+struct bn_ctx
+{
+    KeyHandle rsa_key; ///< The key.
+    Bignum bignum;     ///< Performs the cryptography.
+};
+
+namespace
+{
+    /// @brief Message of the last failure on this thread.
+    thread_local std::string last_error;
+
+    /// @brief Records a failure.
+    /// @param status The status to return.
+    /// @param message What went wrong.
+    /// @return status.
+    int fail(int status, const char *message)
+    {
+        last_error = message;
+        return status;
+    }
+
+    /// @brief Views a caller's input buffer.
+    /// @param input The buffer.
+    /// @return The bytes as a string view.
+    std::string_view view(const bn_input &input)
+    {
+        return input.length == 0 ? std::string_view() : std::string_view(reinterpret_cast<const char *>(input.data), input.length);
+    }
+
+    /// @brief Checks a batch call's arguments.
+    /// @return Whether they are usable.
+    bool valid_batch(const bn_ctx *ctx, const bn_input *inputs, const bn_output *outputs, size_t count)
+    {
+        if (ctx == nullptr || (count > 0 && (inputs == nullptr || outputs == nullptr)))
+            return false;
+        for (size_t i = 0; i < count; i++)
+        {
+            if ((inputs[i].data == nullptr && inputs[i].length > 0) || (outputs[i].data == nullptr && outputs[i].capacity > 0))
+                return false;
+        }
+        return true;
+    }
+
+    /// @brief Copies results into the caller's buffers, or reports the sizes they need.
+    /// @param results One list of lines per output.
+    /// @param outputs The caller's buffers.
+    /// @return BN_OK or BN_ERR_BUFFER_TOO_SMALL.
+    int deliver(const std::vector<std::vector<std::string>> &results, bn_output *outputs)
+    {
+        bool fits = true;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            size_t length = 0;
+            for (const std::string &line : results[i])
+                length += line.size() + 1;
+            outputs[i].length = length;
+            fits = fits && length <= outputs[i].capacity;
+        }
+        if (!fits)
+            return fail(BN_ERR_BUFFER_TOO_SMALL, "Output buffer is too small");
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            uint8_t *next = outputs[i].data;
+            for (const std::string &line : results[i])
+            {
+                std::memcpy(next, line.data(), line.size());
+                next += line.size();
+                *next++ = '\n';
+            }
+        }
+        return BN_OK;
+    }
+}
+
+/// @brief Creates a context.
+/// @param key_path Path of a binary key file, or NULL for the compiled-in key.
+/// @return The context, or NULL on failure.
+bn_ctx *bn_ctx_new(const char *key_path)
+{
+    last_error.clear();
+    try
+    {
+        // Contexts for the same key file share one precomputed key through the process-wide keyring.
+        KeyHandle rsa_key = key_path == nullptr ? Bignum::key() : Keyring::shared().get(key_path);
+        return new bn_ctx{std::move(rsa_key), Bignum()};
+    }
+    catch (const std::exception &error)
+    {
+        fail(BN_ERR_KEY, error.what());
+        return nullptr;
+    }
+}
+
+/// @brief Destroys a context.
+/// @param ctx The context; NULL is ignored.
+void bn_ctx_free(bn_ctx *ctx)
+{
+    delete ctx;
+}
+
+/// @brief Makes the next bn_ctx_new for a key file read it again.
+/// @param key_path Path of the key file.
+/// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+int bn_key_invalidate(const char *key_path)
+{
+    last_error.clear();
+    if (key_path == nullptr)
+        return fail(BN_ERR_INVALID_ARGUMENT, "Null key path");
+
+    Keyring::shared().invalidate(key_path);
+    return BN_OK;
+}
+
+/// @brief Describes the last failure on the calling thread.
+/// @return A message valid until the next call on this thread.
+const char *bn_last_error(void)
+{
+    return last_error.c_str();
+}
+
+/// @brief Length of the context's modulus.
+/// @param ctx The context.
+/// @return The modulus length in bytes.
+size_t bn_modulus_bytes(const bn_ctx *ctx)
+{
+    return ctx == nullptr ? 0 : byte_length(ctx->rsa_key->modulus().limbs());
+}
+
+/// @brief Chooses which pages scratch memory mapped from now on asks for.
+/// @param mode "off", "madvise" or "hugetlb".
+/// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+int bn_set_huge_pages(const char *mode)
+{
+    last_error.clear();
+    if (mode == nullptr)
+        return fail(BN_ERR_INVALID_ARGUMENT, "Null mode");
+    try
+    {
+        set_huge_page_mode(parse_huge_page_mode(mode));
+        return BN_OK;
+    }
+    catch (const std::invalid_argument &error)
+    {
+        return fail(BN_ERR_INVALID_ARGUMENT, error.what());
+    }
+}
+
+/// @brief Reports which pages scratch memory has obtained so far.
+/// @param report Receives the totals.
+/// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+int bn_huge_page_report(bn_page_report *report)
+{
+    last_error.clear();
+    if (report == nullptr)
+        return fail(BN_ERR_INVALID_ARGUMENT, "Null report");
+
+    const HugePageReport totals = huge_page_report();
+    *report = bn_page_report{totals.hugetlb_bytes, totals.advised_bytes, totals.normal_bytes, totals.transparent_bytes};
+    return BN_OK;
+}
+
+/// @brief Computes base^exponent mod modulus on big-endian byte strings.
+/// @return BN_OK or a negative bn_status.
+int bn_modexp(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+              const uint8_t *modulus, size_t modulus_length, uint8_t *out)
+{
+    last_error.clear();
+    if ((base == nullptr && base_length > 0) || (exponent == nullptr && exponent_length > 0) ||
+        modulus == nullptr || out == nullptr)
+        return fail(BN_ERR_INVALID_ARGUMENT, "Null buffer");
+
+    try
+    {
+        const std::vector<Limb> modulus_limbs = bytes_to_limbs(std::vector<std::uint8_t>(modulus, modulus + modulus_length));
+        if (modulus_limbs.empty())
+            return fail(BN_ERR_INVALID_ARGUMENT, "Modulus must be non-zero");
+
+        std::vector<Limb> quotient, reduced;
+        divide_limbs(bytes_to_limbs(std::vector<std::uint8_t>(base, base + base_length)), modulus_limbs, quotient, reduced);
+
+        std::vector<Limb> result;
+        if (modulus_limbs.size() > 1 || modulus_limbs[0] != 1)
+        {
+            const Bignum bignum;
+            result = bignum.mod_exponent(Bignum::from_limbs(reduced),
+                                         Bignum::from_limbs(bytes_to_limbs(std::vector<std::uint8_t>(exponent, exponent + exponent_length))),
+                                         Bignum::from_limbs(modulus_limbs))
+                         .to_limbs();
+        }
+
+        const std::vector<std::uint8_t> bytes = limbs_to_bytes(result, modulus_length);
+        std::copy(bytes.begin(), bytes.end(), out);
+        return BN_OK;
+    }
+    catch (const std::bad_alloc &)
+    {
+        return fail(BN_ERR_INTERNAL, "Out of memory");
+    }
+    catch (const std::exception &error)
+    {
+        return fail(BN_ERR_INTERNAL, error.what());
+    }
+}
+
+/// @brief Upper bound on the ciphertext length of a text.
+/// @param ctx The context.
+/// @param text The text.
+/// @param length Number of text bytes.
+/// @return A capacity that always suffices for bn_encrypt_batch, or 0 on failure.
+size_t bn_encrypt_bound(const bn_ctx *ctx, const uint8_t *text, size_t length)
+{
+    last_error.clear();
+    if (ctx == nullptr || (text == nullptr && length > 0))
+    {
+        fail(BN_ERR_INVALID_ARGUMENT, "Invalid context or buffer");
+        return 0;
+    }
+
+    size_t payload_bytes = 0;
+    try
+    {
+        // Every block but the flag byte carries the framed line, as large_encrypt cuts it.
+        payload_bytes = Bignum::block_bytes(*ctx->rsa_key) - 1;
+    }
+    catch (const std::exception &error)
+    {
+        fail(BN_ERR_KEY, error.what());
+        return 0;
+    }
+
+    const size_t lines = static_cast<size_t>(std::count(text, text + length, '\n')) + 1;
+    size_t frame = 3;
+    for (size_t n = lines; n >= 1000; n /= 10)
+        frame++;
+
+    // Each block is at most 2.41 decimal digits per modulus byte, plus a separator.
+    const size_t modulus_bytes = bn_modulus_bytes(ctx);
+    const size_t blocks = (length + lines * 2 * frame) / payload_bytes + lines;
+    return blocks * (modulus_bytes * 241 / 100 + 2);
+}
+
+/// @brief Encrypts several texts.
+/// @return BN_OK or a negative bn_status.
+int bn_encrypt_batch(bn_ctx *ctx, const bn_input *inputs, bn_output *outputs, size_t count)
+{
+    last_error.clear();
+    if (!valid_batch(ctx, inputs, outputs, count))
+        return fail(BN_ERR_INVALID_ARGUMENT, "Invalid context or buffer");
+
+    try
+    {
+        std::vector<std::string_view> texts;
+        texts.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            texts.push_back(view(inputs[i]));
+
+        return deliver(ctx->bignum.large_encrypt_batch(texts, ctx->rsa_key), outputs);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return fail(BN_ERR_INTERNAL, "Out of memory");
+    }
+    catch (const std::exception &error)
+    {
+        return fail(BN_ERR_INTERNAL, error.what());
+    }
+}
+
+/// @brief Decrypts several ciphertexts produced by bn_encrypt_batch or the `e` command.
+/// @return BN_OK or a negative bn_status.
+int bn_decrypt_batch(bn_ctx *ctx, const bn_input *inputs, bn_output *outputs, size_t count)
+{
+    last_error.clear();
+    if (!valid_batch(ctx, inputs, outputs, count))
+        return fail(BN_ERR_INVALID_ARGUMENT, "Invalid context or buffer");
+
+    try
+    {
+        std::vector<std::vector<std::string_view>> ciphertexts(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            for (const std::string_view line : split_lines(view(inputs[i])))
+            {
+                if (!line.empty())
+                    ciphertexts[i].push_back(line);
+            }
+        }
+
+        return deliver(ctx->bignum.large_decrypt_batch(ciphertexts, ctx->rsa_key), outputs);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return fail(BN_ERR_INTERNAL, "Out of memory");
+    }
+    catch (const std::exception &error)
+    {
+        return fail(BN_ERR_DECRYPT, error.what());
+    }
+}
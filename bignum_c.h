@@ -0,0 +1,153 @@
+/// @file bignum_c.h
+/// @brief C interface to the bignum_core library.
+///
+/// Lets services encrypt and decrypt in-process instead of running the command-line tool
+/// per job. All buffers belong to the caller: inputs are read, outputs are written up to
+/// their capacity, and nothing returned needs to be freed except the context itself.
+///
+/// Text batches use the same ciphertext format as the `e` and `d` commands: each input line
+/// becomes one line of space-separated decimal blocks, and every output line ends with '\n'.
+/// Batch items are encrypted or decrypted together, so their blocks share lane-interleaved
+/// exponentiations.
+///
+/// Every function returns BN_OK or a negative bn_status; bn_last_error() then describes the
+/// failure. A context may be used from several threads at once.
+
+#ifndef BIGNUM_C_H
+#define BIGNUM_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Result codes.
+    typedef enum bn_status
+    {
+        BN_OK = 0,                     ///< Success.
+        BN_ERR_INVALID_ARGUMENT = -1,  ///< A pointer, length or value is not acceptable.
+        BN_ERR_BUFFER_TOO_SMALL = -2,  ///< An output buffer is too small; see its length field.
+        BN_ERR_KEY = -3,               ///< The key file cannot be loaded.
+        BN_ERR_DECRYPT = -4,           ///< A ciphertext is malformed or belongs to another key.
+        BN_ERR_INTERNAL = -5           ///< Anything else, e.g. out of memory.
+    } bn_status;
+
+    /// @brief An opaque context holding a loaded key.
+    typedef struct bn_ctx bn_ctx;
+
+    /// @brief A caller-owned input buffer.
+    typedef struct bn_input
+    {
+        const uint8_t *data; ///< The bytes; may be NULL when length is zero.
+        size_t length;       ///< Number of bytes.
+    } bn_input;
+
+    /// @brief A caller-owned output buffer.
+    typedef struct bn_output
+    {
+        uint8_t *data;   ///< Destination; may be NULL when capacity is zero.
+        size_t capacity; ///< Size of data in bytes.
+        size_t length;   ///< Set to the number of bytes produced, or needed if the buffer is too small.
+    } bn_output;
+
+    /// @brief Creates a context.
+    ///
+    /// Key files are cached in the process-wide keyring, so contexts for the same file share
+    /// one loaded key. The file is read again once its inode, modification time or size
+    /// changes, e.g. when a new key is renamed over it; existing contexts keep the old key.
+    /// @param key_path Path of a binary key file, or NULL for the compiled-in key.
+    /// @return The context, or NULL on failure.
+    bn_ctx *bn_ctx_new(const char *key_path);
+
+    /// @brief Destroys a context.
+    /// @param ctx The context; NULL is ignored.
+    void bn_ctx_free(bn_ctx *ctx);
+
+    /// @brief Makes the next bn_ctx_new for a key file read it again.
+    ///
+    /// Only needed when a file is rewritten in place so quickly that its modification time
+    /// and size do not change; existing contexts keep the key they were created with.
+    /// @param key_path Path of the key file.
+    /// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+    int bn_key_invalidate(const char *key_path);
+
+    /// @brief Describes the last failure on the calling thread.
+    /// @return A message valid until the next call on this thread; empty after success.
+    const char *bn_last_error(void);
+
+    /// @brief Length of the context's modulus.
+    /// @param ctx The context.
+    /// @return The modulus length in bytes.
+    size_t bn_modulus_bytes(const bn_ctx *ctx);
+
+    /// @brief What the library has obtained for its scratch memory.
+    typedef struct bn_page_report
+    {
+        size_t hugetlb_bytes;     ///< Bytes mapped from reserved huge pages.
+        size_t advised_bytes;     ///< Bytes advised for transparent huge pages.
+        size_t normal_bytes;      ///< Bytes mapped with normal pages.
+        size_t transparent_bytes; ///< Process memory currently in transparent huge pages.
+    } bn_page_report;
+
+    /// @brief Chooses which pages scratch memory mapped from now on asks for.
+    ///
+    /// Best called once before the first operation; requests the system refuses fall back
+    /// to normal pages.
+    /// @param mode "off" (the default), "madvise" or "hugetlb".
+    /// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+    int bn_set_huge_pages(const char *mode);
+
+    /// @brief Reports which pages scratch memory has obtained so far.
+    /// @param report Receives the totals.
+    /// @return BN_OK or BN_ERR_INVALID_ARGUMENT.
+    int bn_huge_page_report(bn_page_report *report);
+
+    /// @brief Computes base^exponent mod modulus on big-endian byte strings.
+    /// @param base Base bytes, most significant first.
+    /// @param base_length Number of base bytes.
+    /// @param exponent Exponent bytes, most significant first.
+    /// @param exponent_length Number of exponent bytes.
+    /// @param modulus Modulus bytes, most significant first; must be non-zero.
+    /// @param modulus_length Number of modulus bytes.
+    /// @param out Receives the result, left-padded with zeros to exactly modulus_length bytes.
+    /// @return BN_OK or a negative bn_status.
+    int bn_modexp(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+                  const uint8_t *modulus, size_t modulus_length, uint8_t *out);
+
+    /// @brief Upper bound on the ciphertext length of a text.
+    /// @param ctx The context.
+    /// @param text The text.
+    /// @param length Number of text bytes.
+    /// @return A capacity that always suffices for bn_encrypt_batch, or 0 if the arguments are
+    ///         invalid or the modulus is too small to hold a block (see bn_last_error()).
+    size_t bn_encrypt_bound(const bn_ctx *ctx, const uint8_t *text, size_t length);
+
+    /// @brief Encrypts several texts.
+    ///
+    /// If any output is too small, nothing is written, every output's length is set to what
+    /// it needs and BN_ERR_BUFFER_TOO_SMALL is returned.
+    /// @param ctx The context.
+    /// @param inputs The texts.
+    /// @param outputs One output per text.
+    /// @param count Number of texts.
+    /// @return BN_OK or a negative bn_status.
+    int bn_encrypt_batch(bn_ctx *ctx, const bn_input *inputs, bn_output *outputs, size_t count);
+
+    /// @brief Decrypts several ciphertexts produced by bn_encrypt_batch or the `e` command.
+    ///
+    /// A capacity equal to the ciphertext length always suffices.
+    /// @param ctx The context.
+    /// @param inputs The ciphertexts.
+    /// @param outputs One output per ciphertext.
+    /// @param count Number of ciphertexts.
+    /// @return BN_OK or a negative bn_status.
+    int bn_decrypt_batch(bn_ctx *ctx, const bn_input *inputs, bn_output *outputs, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
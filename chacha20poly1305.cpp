@@ -0,0 +1,527 @@
+/// @file chacha20poly1305.cpp
+/// @brief Implementation of the ChaCha20-Poly1305 authenticated cipher (RFC 8439).
+///
+/// ChaCha20 runs four blocks at a time with the state stored lane-interleaved
+/// ([word][lane]): with SSE2 each state word is one vector holding that word of four
+/// independent blocks, and a portable loop over the lanes is used otherwise. Processors
+/// with AVX2 run eight blocks at a time through a kernel selected at runtime, so the
+/// default build needs no extra flags. Poly1305 uses 44/44/42-bit limbs with 128-bit
+/// products.
+
+#include "chacha20poly1305.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CHACHA_HAVE_AVX2 1
+#endif
+
+namespace
+{
+    /// @brief Number of ChaCha20 blocks computed together.
+    constexpr std::size_t CHACHA_LANES = 4;
+
+    /// @brief Size of one ChaCha20 block in bytes.
+    constexpr std::size_t CHACHA_BLOCK_BYTES = 64;
+
+    /// @brief Loads a little-endian 32-bit word.
+    std::uint32_t load32(const std::uint8_t *bytes)
+    {
+        return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+               static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+    }
+
+    /// @brief Loads a little-endian 64-bit word.
+    std::uint64_t load64(const std::uint8_t *bytes)
+    {
+        return static_cast<std::uint64_t>(load32(bytes)) | static_cast<std::uint64_t>(load32(bytes + 4)) << 32;
+    }
+
+    /// @brief Stores a little-endian 32-bit word.
+    void store32(std::uint8_t *bytes, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+
+    /// @brief Stores a little-endian 64-bit word.
+    void store64(std::uint8_t *bytes, std::uint64_t value)
+    {
+        store32(bytes, static_cast<std::uint32_t>(value));
+        store32(bytes + 4, static_cast<std::uint32_t>(value >> 32));
+    }
+
+#if defined(__SSE2__)
+    /// @brief Rotates every 32-bit lane left by a constant.
+    template <int N>
+    __m128i rotate_left(__m128i value)
+    {
+        return _mm_or_si128(_mm_slli_epi32(value, N), _mm_srli_epi32(value, 32 - N));
+    }
+
+    /// @brief One ChaCha quarter round on four blocks held one word per vector lane.
+    void quarter_round(__m128i &a, __m128i &b, __m128i &c, __m128i &d)
+    {
+        a = _mm_add_epi32(a, b);
+        d = rotate_left<16>(_mm_xor_si128(d, a));
+        c = _mm_add_epi32(c, d);
+        b = rotate_left<12>(_mm_xor_si128(b, c));
+        a = _mm_add_epi32(a, b);
+        d = rotate_left<8>(_mm_xor_si128(d, a));
+        c = _mm_add_epi32(c, d);
+        b = rotate_left<7>(_mm_xor_si128(b, c));
+    }
+
+    /// @brief Computes CHACHA_LANES consecutive keystream blocks.
+    /// @param input Initial state; word 12 is the counter of the first block.
+    /// @param keystream Receives CHACHA_LANES * CHACHA_BLOCK_BYTES bytes.
+    void chacha_blocks(const std::uint32_t (&input)[16], std::uint8_t *keystream)
+    {
+        __m128i start[16];
+        for (int w = 0; w < 16; w++)
+            start[w] = _mm_set1_epi32(static_cast<int>(input[w]));
+        start[12] = _mm_add_epi32(start[12], _mm_set_epi32(3, 2, 1, 0));
+
+        __m128i x[16];
+        for (int w = 0; w < 16; w++)
+            x[w] = start[w];
+
+        for (int round = 0; round < 10; round++)
+        {
+            quarter_round(x[0], x[4], x[8], x[12]);
+            quarter_round(x[1], x[5], x[9], x[13]);
+            quarter_round(x[2], x[6], x[10], x[14]);
+            quarter_round(x[3], x[7], x[11], x[15]);
+            quarter_round(x[0], x[5], x[10], x[15]);
+            quarter_round(x[1], x[6], x[11], x[12]);
+            quarter_round(x[2], x[7], x[8], x[13]);
+            quarter_round(x[3], x[4], x[9], x[14]);
+        }
+
+        // Transpose each group of four words so every block's words become contiguous.
+        for (int w = 0; w < 16; w += 4)
+        {
+            const __m128i a = _mm_add_epi32(x[w], start[w]);
+            const __m128i b = _mm_add_epi32(x[w + 1], start[w + 1]);
+            const __m128i c = _mm_add_epi32(x[w + 2], start[w + 2]);
+            const __m128i d = _mm_add_epi32(x[w + 3], start[w + 3]);
+
+            const __m128i ab_low = _mm_unpacklo_epi32(a, b), ab_high = _mm_unpackhi_epi32(a, b);
+            const __m128i cd_low = _mm_unpacklo_epi32(c, d), cd_high = _mm_unpackhi_epi32(c, d);
+
+            __m128i *out = reinterpret_cast<__m128i *>(keystream + 4 * w);
+            _mm_storeu_si128(out, _mm_unpacklo_epi64(ab_low, cd_low));
+            _mm_storeu_si128(out + CHACHA_BLOCK_BYTES / 16, _mm_unpackhi_epi64(ab_low, cd_low));
+            _mm_storeu_si128(out + 2 * CHACHA_BLOCK_BYTES / 16, _mm_unpacklo_epi64(ab_high, cd_high));
+            _mm_storeu_si128(out + 3 * CHACHA_BLOCK_BYTES / 16, _mm_unpackhi_epi64(ab_high, cd_high));
+        }
+    }
+#else
+    /// @brief One ChaCha quarter round applied to every lane.
+    void quarter_round(std::uint32_t (&x)[16][CHACHA_LANES], int a, int b, int c, int d)
+    {
+        for (std::size_t l = 0; l < CHACHA_LANES; l++)
+        {
+            x[a][l] += x[b][l];
+            x[d][l] ^= x[a][l];
+            x[d][l] = x[d][l] << 16 | x[d][l] >> 16;
+            x[c][l] += x[d][l];
+            x[b][l] ^= x[c][l];
+            x[b][l] = x[b][l] << 12 | x[b][l] >> 20;
+            x[a][l] += x[b][l];
+            x[d][l] ^= x[a][l];
+            x[d][l] = x[d][l] << 8 | x[d][l] >> 24;
+            x[c][l] += x[d][l];
+            x[b][l] ^= x[c][l];
+            x[b][l] = x[b][l] << 7 | x[b][l] >> 25;
+        }
+    }
+
+    /// @brief Computes CHACHA_LANES consecutive keystream blocks.
+    /// @param input Initial state; word 12 is the counter of the first block.
+    /// @param keystream Receives CHACHA_LANES * CHACHA_BLOCK_BYTES bytes.
+    void chacha_blocks(const std::uint32_t (&input)[16], std::uint8_t *keystream)
+    {
+        std::uint32_t x[16][CHACHA_LANES];
+        std::uint32_t start[16][CHACHA_LANES];
+        for (int w = 0; w < 16; w++)
+            for (std::size_t l = 0; l < CHACHA_LANES; l++)
+                start[w][l] = input[w] + (w == 12 ? static_cast<std::uint32_t>(l) : 0);
+        std::memcpy(x, start, sizeof(x));
+
+        for (int round = 0; round < 10; round++)
+        {
+            quarter_round(x, 0, 4, 8, 12);
+            quarter_round(x, 1, 5, 9, 13);
+            quarter_round(x, 2, 6, 10, 14);
+            quarter_round(x, 3, 7, 11, 15);
+            quarter_round(x, 0, 5, 10, 15);
+            quarter_round(x, 1, 6, 11, 12);
+            quarter_round(x, 2, 7, 8, 13);
+            quarter_round(x, 3, 4, 9, 14);
+        }
+
+        for (std::size_t l = 0; l < CHACHA_LANES; l++)
+            for (int w = 0; w < 16; w++)
+                store32(keystream + l * CHACHA_BLOCK_BYTES + 4 * w, x[w][l] + start[w][l]);
+    }
+#endif
+
+#if defined(CHACHA_HAVE_AVX2)
+    /// @brief Number of ChaCha20 blocks computed together by the AVX2 kernel.
+    constexpr std::size_t CHACHA_WIDE_LANES = 8;
+
+    /// @brief Rotates every 32-bit lane left by a constant.
+    template <int N>
+    __attribute__((target("avx2"))) __m256i rotate_left_wide(__m256i value)
+    {
+        return _mm256_or_si256(_mm256_slli_epi32(value, N), _mm256_srli_epi32(value, 32 - N));
+    }
+
+    /// @brief One ChaCha quarter round on eight blocks held one word per vector lane.
+    __attribute__((target("avx2"))) void quarter_round_wide(__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+    {
+        a = _mm256_add_epi32(a, b);
+        d = rotate_left_wide<16>(_mm256_xor_si256(d, a));
+        c = _mm256_add_epi32(c, d);
+        b = rotate_left_wide<12>(_mm256_xor_si256(b, c));
+        a = _mm256_add_epi32(a, b);
+        d = rotate_left_wide<8>(_mm256_xor_si256(d, a));
+        c = _mm256_add_epi32(c, d);
+        b = rotate_left_wide<7>(_mm256_xor_si256(b, c));
+    }
+
+    /// @brief Computes CHACHA_WIDE_LANES consecutive keystream blocks with AVX2.
+    /// @param input Initial state; word 12 is the counter of the first block.
+    /// @param keystream Receives CHACHA_WIDE_LANES * CHACHA_BLOCK_BYTES bytes.
+    __attribute__((target("avx2"))) void chacha_blocks_wide(const std::uint32_t (&input)[16], std::uint8_t *keystream)
+    {
+        __m256i start[16];
+        for (int w = 0; w < 16; w++)
+            start[w] = _mm256_set1_epi32(static_cast<int>(input[w]));
+        start[12] = _mm256_add_epi32(start[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+        __m256i x[16];
+        for (int w = 0; w < 16; w++)
+            x[w] = start[w];
+
+        for (int round = 0; round < 10; round++)
+        {
+            quarter_round_wide(x[0], x[4], x[8], x[12]);
+            quarter_round_wide(x[1], x[5], x[9], x[13]);
+            quarter_round_wide(x[2], x[6], x[10], x[14]);
+            quarter_round_wide(x[3], x[7], x[11], x[15]);
+            quarter_round_wide(x[0], x[5], x[10], x[15]);
+            quarter_round_wide(x[1], x[6], x[11], x[12]);
+            quarter_round_wide(x[2], x[7], x[8], x[13]);
+            quarter_round_wide(x[3], x[4], x[9], x[14]);
+        }
+
+        // Transpose each group of four words within each 128-bit half, as the SSE2 kernel
+        // does; the low halves hold blocks 0-3 and the high halves blocks 4-7.
+        for (int w = 0; w < 16; w += 4)
+        {
+            const __m256i a = _mm256_add_epi32(x[w], start[w]);
+            const __m256i b = _mm256_add_epi32(x[w + 1], start[w + 1]);
+            const __m256i c = _mm256_add_epi32(x[w + 2], start[w + 2]);
+            const __m256i d = _mm256_add_epi32(x[w + 3], start[w + 3]);
+
+            const __m256i ab_low = _mm256_unpacklo_epi32(a, b), ab_high = _mm256_unpackhi_epi32(a, b);
+            const __m256i cd_low = _mm256_unpacklo_epi32(c, d), cd_high = _mm256_unpackhi_epi32(c, d);
+            const __m256i rows[4] = {_mm256_unpacklo_epi64(ab_low, cd_low), _mm256_unpackhi_epi64(ab_low, cd_low),
+                                     _mm256_unpacklo_epi64(ab_high, cd_high), _mm256_unpackhi_epi64(ab_high, cd_high)};
+
+            for (int l = 0; l < 4; l++)
+            {
+                std::uint8_t *out = keystream + l * CHACHA_BLOCK_BYTES + 4 * w;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(rows[l]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * CHACHA_BLOCK_BYTES), _mm256_extracti128_si256(rows[l], 1));
+            }
+        }
+    }
+
+    /// @brief Whether the running processor supports the AVX2 kernel.
+    bool have_avx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+#endif
+
+    /// @brief Feeds the AEAD construction's zero padding for a field of the given length.
+    void pad16(Poly1305 &mac, std::size_t length)
+    {
+        static const std::uint8_t zeros[16] = {};
+        if (length % 16 != 0)
+            mac.update(zeros, 16 - length % 16);
+    }
+
+    /// @brief Computes the AEAD tag over the additional data and ciphertext.
+    void aead_tag(const std::uint8_t *key, const std::uint8_t *nonce, const std::uint8_t *aad, std::size_t aad_length,
+                  const std::uint8_t *ciphertext, std::size_t length, std::uint8_t *tag)
+    {
+        // The one-time Poly1305 key is the first 32 bytes of keystream block 0.
+        std::uint8_t mac_key[CHACHA_BLOCK_BYTES] = {};
+        chacha20_xor(key, nonce, 0, mac_key, mac_key, sizeof(mac_key));
+
+        Poly1305 mac(mac_key);
+        mac.update(aad, aad_length);
+        pad16(mac, aad_length);
+        mac.update(ciphertext, length);
+        pad16(mac, length);
+
+        std::uint8_t lengths[16];
+        store64(lengths, aad_length);
+        store64(lengths + 8, length);
+        mac.update(lengths, sizeof(lengths));
+        mac.finish(tag);
+    }
+}
+
+/// @brief Starts an authenticator with a one-time key.
+/// @param key AEAD_KEY_BYTES bytes; never reuse a key for two messages.
+Poly1305::Poly1305(const std::uint8_t *key) : h{0, 0, 0}, buffer{}, buffered(0)
+{
+    const std::uint64_t t0 = load64(key);
+    const std::uint64_t t1 = load64(key + 8);
+
+    // Clamp r as the specification requires while splitting it into limbs.
+    r[0] = t0 & 0xffc0fffffffULL;
+    r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+    r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+    pad[0] = load64(key + 16);
+    pad[1] = load64(key + 24);
+}
+
+/// @brief Absorbs full 16-byte blocks.
+/// @param data Block data.
+/// @param length Number of bytes; a multiple of 16.
+/// @param final_bit The 2^128 bit, or zero for the padded last block.
+void Poly1305::blocks(const std::uint8_t *data, std::size_t length, std::uint64_t final_bit)
+{
+    using u128 = unsigned __int128;
+    constexpr std::uint64_t mask44 = 0xfffffffffffULL, mask42 = 0x3ffffffffffULL;
+
+    const std::uint64_t r0 = r[0], r1 = r[1], r2 = r[2];
+    const std::uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+    std::uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+
+    for (; length >= 16; data += 16, length -= 16)
+    {
+        const std::uint64_t t0 = load64(data), t1 = load64(data + 8);
+        h0 += t0 & mask44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & mask44;
+        h2 += ((t1 >> 24) & mask42) | final_bit;
+
+        // Products above 2^130 fold back multiplied by 5 (hence s1, s2 = 20 * r).
+        const u128 d0 = static_cast<u128>(h0) * r0 + static_cast<u128>(h1) * s2 + static_cast<u128>(h2) * s1;
+        u128 d1 = static_cast<u128>(h0) * r1 + static_cast<u128>(h1) * r0 + static_cast<u128>(h2) * s2;
+        u128 d2 = static_cast<u128>(h0) * r2 + static_cast<u128>(h1) * r1 + static_cast<u128>(h2) * r0;
+
+        std::uint64_t carry = static_cast<std::uint64_t>(d0 >> 44);
+        h0 = static_cast<std::uint64_t>(d0) & mask44;
+        d1 += carry;
+        carry = static_cast<std::uint64_t>(d1 >> 44);
+        h1 = static_cast<std::uint64_t>(d1) & mask44;
+        d2 += carry;
+        carry = static_cast<std::uint64_t>(d2 >> 42);
+        h2 = static_cast<std::uint64_t>(d2) & mask42;
+        h0 += carry * 5;
+        carry = h0 >> 44;
+        h0 &= mask44;
+        h1 += carry;
+    }
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+}
+
+/// @brief Absorbs message bytes.
+/// @param data Message bytes.
+/// @param length Number of bytes.
+void Poly1305::update(const std::uint8_t *data, std::size_t length)
+{
+    if (length == 0)
+        return;
+
+    if (buffered > 0)
+    {
+        const std::size_t take = std::min(length, 16 - buffered);
+        std::memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        length -= take;
+        if (buffered < 16)
+            return;
+        blocks(buffer, 16, 1ULL << 40);
+        buffered = 0;
+    }
+
+    const std::size_t whole = length & ~static_cast<std::size_t>(15);
+    blocks(data, whole, 1ULL << 40);
+
+    std::memcpy(buffer, data + whole, length - whole);
+    buffered = length - whole;
+}
+
+/// @brief Completes the tag.
+/// @param tag Receives AEAD_TAG_BYTES bytes.
+void Poly1305::finish(std::uint8_t *tag)
+{
+    constexpr std::uint64_t mask44 = 0xfffffffffffULL, mask42 = 0x3ffffffffffULL;
+
+    if (buffered > 0)
+    {
+        // A short final block gets a 1 byte appended instead of the 2^128 bit.
+        buffer[buffered] = 1;
+        std::fill(buffer + buffered + 1, buffer + 16, 0);
+        blocks(buffer, 16, 0);
+    }
+
+    std::uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+    std::uint64_t carry = h1 >> 44;
+    h1 &= mask44;
+    h2 += carry;
+    carry = h2 >> 42;
+    h2 &= mask42;
+    h0 += carry * 5;
+    carry = h0 >> 44;
+    h0 &= mask44;
+    h1 += carry;
+    carry = h1 >> 44;
+    h1 &= mask44;
+    h2 += carry;
+    carry = h2 >> 42;
+    h2 &= mask42;
+    h0 += carry * 5;
+    carry = h0 >> 44;
+    h0 &= mask44;
+    h1 += carry;
+
+    // Compute h - p and keep it if it did not borrow, without branching on the value.
+    std::uint64_t g0 = h0 + 5;
+    carry = g0 >> 44;
+    g0 &= mask44;
+    std::uint64_t g1 = h1 + carry;
+    carry = g1 >> 44;
+    g1 &= mask44;
+    std::uint64_t g2 = h2 + carry - (1ULL << 42);
+
+    std::uint64_t select = (g2 >> 63) - 1;
+    g0 &= select;
+    g1 &= select;
+    g2 &= select;
+    select = ~select;
+    h0 = (h0 & select) | g0;
+    h1 = (h1 & select) | g1;
+    h2 = (h2 & select) | g2;
+
+    h0 += pad[0] & mask44;
+    carry = h0 >> 44;
+    h0 &= mask44;
+    h1 += (((pad[0] >> 44) | (pad[1] << 20)) & mask44) + carry;
+    carry = h1 >> 44;
+    h1 &= mask44;
+    h2 += ((pad[1] >> 24) & mask42) + carry;
+    h2 &= mask42;
+
+    store64(tag, h0 | (h1 << 44));
+    store64(tag + 8, (h1 >> 20) | (h2 << 24));
+}
+
+/// @brief Encrypts or decrypts with the ChaCha20 stream cipher.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes.
+/// @param counter Block counter of the first 64-byte block.
+/// @param input Bytes to transform.
+/// @param output Receives the transformed bytes; may equal input.
+/// @param length Number of bytes.
+void chacha20_xor(const std::uint8_t *key, const std::uint8_t *nonce, std::uint32_t counter,
+                  const std::uint8_t *input, std::uint8_t *output, std::size_t length)
+{
+    std::uint32_t state[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    for (int i = 0; i < 8; i++)
+        state[4 + i] = load32(key + 4 * i);
+    state[12] = counter;
+    for (int i = 0; i < 3; i++)
+        state[13 + i] = load32(nonce + 4 * i);
+
+#if defined(CHACHA_HAVE_AVX2)
+    std::uint8_t keystream[CHACHA_WIDE_LANES * CHACHA_BLOCK_BYTES];
+    const bool wide = have_avx2();
+#else
+    std::uint8_t keystream[CHACHA_LANES * CHACHA_BLOCK_BYTES];
+#endif
+    while (length > 0)
+    {
+        std::size_t produced = CHACHA_LANES * CHACHA_BLOCK_BYTES;
+#if defined(CHACHA_HAVE_AVX2)
+        if (wide && length > produced)
+        {
+            chacha_blocks_wide(state, keystream);
+            produced = CHACHA_WIDE_LANES * CHACHA_BLOCK_BYTES;
+        }
+        else
+#endif
+            chacha_blocks(state, keystream);
+        state[12] += static_cast<std::uint32_t>(produced / CHACHA_BLOCK_BYTES);
+
+        const std::size_t chunk = std::min(length, produced);
+        for (std::size_t i = 0; i < chunk; i++)
+            output[i] = input[i] ^ keystream[i];
+
+        input += chunk;
+        output += chunk;
+        length -= chunk;
+    }
+}
+
+/// @brief Encrypts and authenticates a message with ChaCha20-Poly1305.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes; never reuse a nonce with the same key.
+/// @param aad Additional data that is authenticated but not encrypted.
+/// @param aad_length Number of additional data bytes.
+/// @param plaintext Message bytes.
+/// @param length Number of message bytes.
+/// @param ciphertext Receives length encrypted bytes; may equal plaintext.
+/// @param tag Receives AEAD_TAG_BYTES bytes.
+void aead_seal(const std::uint8_t *key, const std::uint8_t *nonce, const std::uint8_t *aad, std::size_t aad_length,
+               const std::uint8_t *plaintext, std::size_t length, std::uint8_t *ciphertext, std::uint8_t *tag)
+{
+    chacha20_xor(key, nonce, 1, plaintext, ciphertext, length);
+    aead_tag(key, nonce, aad, aad_length, ciphertext, length, tag);
+}
+
+/// @brief Verifies and decrypts a message sealed by aead_seal.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes.
+/// @param aad Additional data that was authenticated with the message.
+/// @param aad_length Number of additional data bytes.
+/// @param ciphertext Encrypted bytes.
+/// @param length Number of encrypted bytes.
+/// @param tag AEAD_TAG_BYTES bytes.
+/// @param plaintext Receives length decrypted bytes; untouched if verification fails.
+/// @return True if the tag matched.
+bool aead_open(const std::uint8_t *key, const std::uint8_t *nonce, const std::uint8_t *aad, std::size_t aad_length,
+               const std::uint8_t *ciphertext, std::size_t length, const std::uint8_t *tag, std::uint8_t *plaintext)
+{
+    std::uint8_t expected[AEAD_TAG_BYTES];
+    aead_tag(key, nonce, aad, aad_length, ciphertext, length, expected);
+
+    // Compare in constant time so the position of a mismatch does not leak.
+    std::uint8_t difference = 0;
+    for (std::size_t i = 0; i < AEAD_TAG_BYTES; i++)
+        difference |= expected[i] ^ tag[i];
+    if (difference != 0)
+        return false;
+
+    chacha20_xor(key, nonce, 1, ciphertext, plaintext, length);
+    return true;
+}
@@ -0,0 +1,87 @@
+/// @file chacha20poly1305.hpp
+/// @brief Declaration of the ChaCha20-Poly1305 authenticated cipher (RFC 8439).
+///
+/// The hybrid mode protects a random session key with RSA and encrypts the bulk data
+/// with this cipher, so large payloads cost one modular exponentiation instead of one
+/// per block.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Size of a ChaCha20-Poly1305 key in bytes.
+constexpr std::size_t AEAD_KEY_BYTES = 32;
+
+/// @brief Size of a ChaCha20-Poly1305 nonce in bytes.
+constexpr std::size_t AEAD_NONCE_BYTES = 12;
+
+/// @brief Size of a Poly1305 tag in bytes.
+constexpr std::size_t AEAD_TAG_BYTES = 16;
+
+/// @class Poly1305
+/// @brief Incremental Poly1305 one-time authenticator.
+class Poly1305
+{
+private:
+    std::uint64_t r[3];         ///< Clamped key r in 44/44/42-bit limbs.
+    std::uint64_t h[3];         ///< Accumulator in 44/44/42-bit limbs.
+    std::uint64_t pad[2];       ///< Key half s added at the end.
+    std::uint8_t buffer[16];    ///< Bytes of an incomplete block.
+    std::size_t buffered;       ///< Number of bytes in buffer.
+
+    /// @brief Absorbs full 16-byte blocks.
+    /// @param data Block data.
+    /// @param length Number of bytes; a multiple of 16.
+    /// @param final_bit The 2^128 bit, or zero for the padded last block.
+    void blocks(const std::uint8_t *data, std::size_t length, std::uint64_t final_bit);
+
+public:
+    /// @brief Starts an authenticator with a one-time key.
+    /// @param key AEAD_KEY_BYTES bytes; never reuse a key for two messages.
+    explicit Poly1305(const std::uint8_t *key);
+
+    /// @brief Absorbs message bytes.
+    /// @param data Message bytes.
+    /// @param length Number of bytes.
+    void update(const std::uint8_t *data, std::size_t length);
+
+    /// @brief Completes the tag.
+    /// @param tag Receives AEAD_TAG_BYTES bytes.
+    void finish(std::uint8_t *tag);
+};
+
+/// @brief Encrypts or decrypts with the ChaCha20 stream cipher.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes.
+/// @param counter Block counter of the first 64-byte block.
+/// @param input Bytes to transform.
+/// @param output Receives the transformed bytes; may equal input.
+/// @param length Number of bytes.
+void chacha20_xor(const std::uint8_t *key, const std::uint8_t *nonce, std::uint32_t counter,
+                  const std::uint8_t *input, std::uint8_t *output, std::size_t length);
+
+/// @brief Encrypts and authenticates a message with ChaCha20-Poly1305.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes; never reuse a nonce with the same key.
+/// @param aad Additional data that is authenticated but not encrypted.
+/// @param aad_length Number of additional data bytes.
+/// @param plaintext Message bytes.
+/// @param length Number of message bytes.
+/// @param ciphertext Receives length encrypted bytes; may equal plaintext.
+/// @param tag Receives AEAD_TAG_BYTES bytes.
+void aead_seal(const std::uint8_t *key, const std::uint8_t *nonce, const std::uint8_t *aad, std::size_t aad_length,
+               const std::uint8_t *plaintext, std::size_t length, std::uint8_t *ciphertext, std::uint8_t *tag);
+
+/// @brief Verifies and decrypts a message sealed by aead_seal.
+/// @param key AEAD_KEY_BYTES bytes.
+/// @param nonce AEAD_NONCE_BYTES bytes.
+/// @param aad Additional data that was authenticated with the message.
+/// @param aad_length Number of additional data bytes.
+/// @param ciphertext Encrypted bytes.
+/// @param length Number of encrypted bytes.
+/// @param tag AEAD_TAG_BYTES bytes.
+/// @param plaintext Receives length decrypted bytes; untouched if verification fails.
+/// @return True if the tag matched.
+bool aead_open(const std::uint8_t *key, const std::uint8_t *nonce, const std::uint8_t *aad, std::size_t aad_length,
+               const std::uint8_t *ciphertext, std::size_t length, const std::uint8_t *tag, std::uint8_t *plaintext);
@@ -0,0 +1,171 @@
+/// @file ciphertext_file.cpp
+/// @brief Implementation of the binary ciphertext container reader and writer.
+
+#include "ciphertext_file.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    /// @brief Magic bytes at the start of every ciphertext container.
+    constexpr char CIPHERTEXT_MAGIC[8] = {'B', 'N', 'C', 'I', 'P', 'H', 'E', 'R'};
+
+    /// @brief Current ciphertext container format version.
+    constexpr std::uint32_t CIPHERTEXT_VERSION = 1;
+
+    /// @brief Magic bytes at the start of every line index.
+    constexpr char LINE_INDEX_MAGIC[8] = {'B', 'N', 'L', 'I', 'N', 'D', 'E', 'X'};
+
+    /// @brief Current line index format version.
+    constexpr std::uint32_t LINE_INDEX_VERSION = 1;
+
+    /// @brief Folds bytes into a running FNV-1a hash.
+    /// @param hash The running hash.
+    /// @param bytes The bytes to fold in.
+    /// @return The updated hash.
+    std::uint64_t fnv1a(std::uint64_t hash, const std::vector<std::uint8_t> &bytes)
+    {
+        for (const std::uint8_t byte : bytes)
+        {
+            hash ^= byte;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+}
+
+/// @brief Computes a 64-bit FNV-1a fingerprint of a key's public part.
+/// @param rsa_key The key.
+/// @return A fingerprint of the modulus and public exponent bytes.
+std::uint64_t key_fingerprint(const KeyContext &rsa_key)
+{
+    const std::vector<Limb> &modulus = rsa_key.modulus().limbs();
+    const std::vector<Limb> &exponent = rsa_key.public_exponent();
+
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a(hash, limbs_to_bytes(modulus, byte_length(modulus)));
+    hash = fnv1a(hash, limbs_to_bytes(exponent, byte_length(exponent)));
+    return hash;
+}
+
+/// @brief Writes a line index file.
+/// @param path Path of the index file.
+/// @param offsets Byte offset in the ciphertext at which each line starts, followed by the ciphertext size.
+void save_line_index(const std::string &path, const std::vector<std::uint64_t> &offsets)
+{
+    if (offsets.empty())
+        throw std::invalid_argument("Line index needs at least the ciphertext size");
+
+    LineIndexHeader header{};
+    std::memcpy(header.magic, LINE_INDEX_MAGIC, sizeof(LINE_INDEX_MAGIC));
+    header.version = LINE_INDEX_VERSION;
+    header.line_count = offsets.size() - 1;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t)));
+    if (!file)
+        throw std::runtime_error("Cannot write line index: " + path);
+}
+
+/// @brief Reads a line index file and checks it against the ciphertext it describes.
+/// @param path Path of the index file.
+/// @param ciphertext_size Size of the ciphertext in bytes.
+/// @return Byte offset at which each line starts, followed by the ciphertext size.
+std::vector<std::uint64_t> load_line_index(const std::string &path, std::uint64_t ciphertext_size)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("Cannot open line index: " + path);
+    const std::uint64_t file_size = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0);
+
+    LineIndexHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, LINE_INDEX_MAGIC, sizeof(LINE_INDEX_MAGIC)) != 0 || header.version != LINE_INDEX_VERSION)
+        throw std::runtime_error("Not a line index: " + path);
+
+    // The header is untrusted; the file must hold exactly line_count + 1 offsets before any are allocated.
+    const std::uint64_t offset_count = (file_size - sizeof(header)) / sizeof(std::uint64_t);
+    if (header.line_count >= offset_count)
+        throw std::runtime_error("Line index is truncated: " + path);
+    if (header.line_count + 1 != offset_count || (file_size - sizeof(header)) % sizeof(std::uint64_t) != 0)
+        throw std::runtime_error("Line index is corrupted: " + path);
+
+    std::vector<std::uint64_t> offsets(offset_count);
+    if (!file.read(reinterpret_cast<char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t))))
+        throw std::runtime_error("Line index is truncated: " + path);
+
+    // Offsets must not go backwards, or a line would have negative length, and must end at the
+    // ciphertext's end, so every offset lies inside the ciphertext.
+    for (size_t i = 1; i < offsets.size(); i++)
+        if (offsets[i] < offsets[i - 1])
+            throw std::runtime_error("Line index is corrupted: " + path);
+    if (offsets.back() != ciphertext_size)
+        throw std::runtime_error("Line index does not match the ciphertext");
+
+    return offsets;
+}
+
+/// @brief Builds the header that starts a container.
+/// @param rsa_key The key the blocks are encrypted with.
+/// @return The header bytes.
+std::string ciphertext_header(const KeyContext &rsa_key)
+{
+    CiphertextHeader header{};
+    std::memcpy(header.magic, CIPHERTEXT_MAGIC, sizeof(CIPHERTEXT_MAGIC));
+    header.version = CIPHERTEXT_VERSION;
+    header.block_bytes = static_cast<std::uint32_t>(byte_length(rsa_key.modulus().limbs()));
+    header.fingerprint = key_fingerprint(rsa_key);
+
+    return std::string(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+/// @brief Validates a container against a key.
+/// @param data Container bytes; must stay valid while the reader is used.
+/// @param size Number of container bytes.
+/// @param rsa_key The key the container must have been written for.
+CiphertextReader::CiphertextReader(const std::uint8_t *data, std::size_t size, const KeyContext &rsa_key)
+    : blocks(data + sizeof(CiphertextHeader)), count(0), block_width(byte_length(rsa_key.modulus().limbs()))
+{
+    CiphertextHeader header{};
+    if (size < sizeof(header))
+        throw std::runtime_error("Ciphertext container is truncated");
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, CIPHERTEXT_MAGIC, sizeof(CIPHERTEXT_MAGIC)) != 0 || header.version != CIPHERTEXT_VERSION)
+        throw std::runtime_error("Not a ciphertext container");
+    if (header.fingerprint != key_fingerprint(rsa_key) || header.block_bytes != block_width)
+        throw std::runtime_error("Ciphertext container was written for a different key");
+    if ((size - sizeof(header)) % block_width != 0)
+        throw std::runtime_error("Ciphertext container does not hold a whole number of blocks");
+
+    count = (size - sizeof(header)) / block_width;
+}
+
+/// @brief Number of blocks in the container.
+/// @return The block count.
+std::size_t CiphertextReader::block_count() const
+{
+    return count;
+}
+
+/// @brief Width of every block.
+/// @return The block width in bytes.
+std::size_t CiphertextReader::block_bytes() const
+{
+    return block_width;
+}
+
+/// @brief Reads one block.
+/// @param index Block index, less than block_count().
+/// @return The block, least significant limb first.
+std::vector<Limb> CiphertextReader::block(std::size_t index) const
+{
+    if (index >= count)
+        throw std::out_of_range("Ciphertext block index out of range");
+
+    const std::uint8_t *first = blocks + index * block_width;
+    return bytes_to_limbs(std::vector<std::uint8_t>(first, first + block_width));
+}
@@ -0,0 +1,92 @@
+/// @file ciphertext_file.hpp
+/// @brief Declaration of the binary ciphertext container reader and writer.
+///
+/// A container starts with a fixed header naming the key (by fingerprint) and the block
+/// width, followed by RSA blocks stored as big-endian integers of exactly that width.
+/// Block i therefore starts at sizeof(CiphertextHeader) + i * block width, so a reader
+/// can seek to any block without parsing the ones before it.
+///
+/// A line index is a sidecar file recording where each line's ciphertext starts, so a few
+/// lines can be decrypted without touching the rest of a large file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "modexp_lanes.hpp"
+#include "keycontext.hpp"
+
+/// @brief Fixed header at the start of a binary ciphertext container.
+struct CiphertextHeader
+{
+    char magic[8];            ///< CIPHERTEXT_MAGIC.
+    std::uint32_t version;    ///< CIPHERTEXT_VERSION.
+    std::uint32_t block_bytes; ///< Width of every block; the modulus length in bytes.
+    std::uint64_t fingerprint; ///< key_fingerprint() of the key the blocks were encrypted with.
+};
+
+/// @brief Fixed header at the start of a line index file.
+struct LineIndexHeader
+{
+    char magic[8];            ///< LINE_INDEX_MAGIC.
+    std::uint32_t version;    ///< LINE_INDEX_VERSION.
+    std::uint32_t reserved;   ///< Zero.
+    std::uint64_t line_count; ///< Number of indexed lines; line_count + 1 offsets follow.
+};
+
+/// @brief Computes a 64-bit FNV-1a fingerprint of a key's public part.
+/// @param rsa_key The key.
+/// @return A fingerprint of the modulus and public exponent bytes.
+std::uint64_t key_fingerprint(const KeyContext &rsa_key);
+
+/// @brief Writes a line index file.
+/// @param path Path of the index file.
+/// @param offsets Byte offset in the ciphertext at which each line starts, followed by the ciphertext size.
+/// @throws std::runtime_error if the file cannot be written.
+void save_line_index(const std::string &path, const std::vector<std::uint64_t> &offsets);
+
+/// @brief Reads a line index file and checks it against the ciphertext it describes.
+/// @param path Path of the index file.
+/// @param ciphertext_size Size of the ciphertext in bytes.
+/// @return Byte offset at which each line starts, followed by the ciphertext size; never empty.
+/// @throws std::runtime_error if the file cannot be read, is not a line index, or its offsets
+///         go backwards or do not end at ciphertext_size.
+std::vector<std::uint64_t> load_line_index(const std::string &path, std::uint64_t ciphertext_size);
+
+/// @brief Builds the header that starts a container.
+/// @param rsa_key The key the blocks are encrypted with.
+/// @return The header bytes; the blocks follow them, each as wide as the modulus.
+std::string ciphertext_header(const KeyContext &rsa_key);
+
+/// @class CiphertextReader
+/// @brief Reads RSA blocks from a binary ciphertext container held in memory.
+class CiphertextReader
+{
+private:
+    const std::uint8_t *blocks; ///< First byte of block 0.
+    std::size_t count;          ///< Number of blocks.
+    std::size_t block_width;    ///< Width of every block in bytes.
+
+public:
+    /// @brief Validates a container against a key.
+    /// @param data Container bytes; must stay valid while the reader is used.
+    /// @param size Number of container bytes.
+    /// @param rsa_key The key the container must have been written for.
+    /// @throws std::runtime_error if the header is invalid, names another key or the size is not a whole number of blocks.
+    CiphertextReader(const std::uint8_t *data, std::size_t size, const KeyContext &rsa_key);
+
+    /// @brief Number of blocks in the container.
+    /// @return The block count.
+    std::size_t block_count() const;
+
+    /// @brief Width of every block.
+    /// @return The block width in bytes.
+    std::size_t block_bytes() const;
+
+    /// @brief Reads one block.
+    /// @param index Block index, less than block_count().
+    /// @return The block, least significant limb first.
+    std::vector<Limb> block(std::size_t index) const;
+};
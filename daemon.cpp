@@ -0,0 +1,219 @@
+/// @file daemon.cpp
+/// @brief Implementation of the long-running encryption service behind the `serve` command.
+
+#include "daemon.hpp"
+#include "io.hpp"
+#include "shm_ring.hpp"
+#include <stdexcept>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    /// @brief Bytes before every payload: the tag and the 32-bit length.
+    constexpr std::size_t MESSAGE_HEADER_BYTES = 5;
+
+    /// @brief Output buffer size of each connection.
+    constexpr std::size_t CONNECTION_BUFFER_BYTES = 64 << 10;
+
+    /// @brief Reads exactly the requested number of bytes from a socket.
+    /// @param fd The socket.
+    /// @param data Destination buffer.
+    /// @param length Number of bytes to read.
+    /// @return False if the peer closed the connection first.
+    /// @throws std::runtime_error if the read fails.
+    bool read_exact(int fd, char *data, std::size_t length)
+    {
+        while (length > 0)
+        {
+            const ssize_t received = ::read(fd, data, length);
+            if (received < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(std::string("Read failed: ") + std::strerror(errno));
+            }
+            if (received == 0)
+                return false;
+            data += received;
+            length -= static_cast<std::size_t>(received);
+        }
+        return true;
+    }
+
+    /// @brief Makes a completion that turns a request's outcome into a daemon response.
+    /// @param response Receives the future response.
+    /// @return The completion to submit with the request.
+    AsyncCipher::Completion fulfil(std::future<DaemonResponse> &response)
+    {
+        // Completions must be copyable, so the promise is shared with the one that fulfils it.
+        const auto promise = std::make_shared<std::promise<DaemonResponse>>();
+        response = promise->get_future();
+        return [promise](std::string result, std::exception_ptr error)
+        {
+            if (!error)
+            {
+                promise->set_value(DaemonResponse{DAEMON_OK, std::move(result)});
+                return;
+            }
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception &failure)
+            {
+                promise->set_value(DaemonResponse{DAEMON_ERROR, failure.what()});
+            }
+        };
+    }
+}
+
+/// @brief Prepares a daemon; nothing is bound until run().
+/// @param path Path of the Unix domain socket.
+/// @param key The key used for every request.
+Daemon::Daemon(std::string path, KeyHandle key) : socket_path(std::move(path)), cipher(std::move(key)) {}
+
+Daemon::~Daemon() = default;
+
+/// @brief Also serves requests through a new shared-memory ring once run() is called.
+/// @param name Name of the shared-memory object, e.g. "bignum".
+/// @param slot_count Number of requests that can be in flight at once.
+/// @param slot_bytes Largest request or response payload, in bytes.
+void Daemon::add_shared_ring(const std::string &name, std::uint32_t slot_count, std::uint32_t slot_bytes)
+{
+    rings.push_back(std::make_unique<SharedRing>(name, slot_count, slot_bytes));
+}
+
+/// @brief Binds the socket and serves clients; does not return once listening.
+void Daemon::run()
+{
+    // A client that disconnects early must not kill the daemon when its response is written.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0)
+        throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+
+    // Replace a socket left behind by an earlier daemon, but never any other kind of file.
+    struct stat st;
+    if (::lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        ::unlink(socket_path.c_str());
+
+    if (::bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(listener);
+        throw std::runtime_error("Cannot listen on " + socket_path + ": " + reason);
+    }
+
+    for (const std::unique_ptr<SharedRing> &ring : rings)
+        std::thread(&Daemon::serve_ring, this, std::ref(*ring)).detach();
+
+    while (true)
+    {
+        const int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE)
+                continue;
+            throw std::runtime_error(std::string("Accept failed: ") + std::strerror(errno));
+        }
+
+        std::thread(&Daemon::serve_connection, this, client).detach();
+    }
+}
+
+/// @brief Reads requests from a client and writes back responses until it disconnects.
+/// @param fd The connected socket, closed on return.
+void Daemon::serve_connection(int fd)
+{
+    try
+    {
+        BufferedWriter out(fd, CONNECTION_BUFFER_BYTES);
+        unsigned char header[MESSAGE_HEADER_BYTES];
+
+        while (read_exact(fd, reinterpret_cast<char *>(header), sizeof(header)))
+        {
+            const std::uint32_t length = (std::uint32_t(header[1]) << 24) | (std::uint32_t(header[2]) << 16) |
+                                         (std::uint32_t(header[3]) << 8) | std::uint32_t(header[4]);
+
+            // An oversized request cannot be skipped reliably, so answer it and hang up.
+            DaemonResponse response{DAEMON_ERROR, "Request is too large"};
+            const bool too_large = length > DAEMON_MAX_PAYLOAD;
+            if (!too_large)
+            {
+                std::string payload(length, '\0');
+                if (!read_exact(fd, payload.data(), length))
+                    break;
+                response = enqueue(static_cast<char>(header[0]), payload).get();
+            }
+
+            const std::uint32_t response_length = static_cast<std::uint32_t>(response.payload.size());
+            const char response_header[MESSAGE_HEADER_BYTES] = {response.tag,
+                                                                static_cast<char>(response_length >> 24),
+                                                                static_cast<char>(response_length >> 16),
+                                                                static_cast<char>(response_length >> 8),
+                                                                static_cast<char>(response_length)};
+            out.write(std::string_view(response_header, sizeof(response_header)));
+            out.write(response.payload);
+            out.flush();
+
+            if (too_large)
+                break;
+        }
+    }
+    catch (const std::exception &)
+    {
+        // The client went away or sent garbage; only this connection is affected.
+    }
+
+    ::close(fd);
+}
+
+/// @brief Queues a request for the cipher.
+/// @param op Request tag.
+/// @param payload Request payload; must stay valid until the response is ready.
+/// @return The future response.
+std::future<DaemonResponse> Daemon::enqueue(char op, std::string_view payload)
+{
+    std::future<DaemonResponse> response;
+    cipher.submit(op, payload, fulfil(response));
+    return response;
+}
+
+/// @brief Answers requests from a shared-memory ring forever.
+/// @param ring The ring, created by this process.
+void Daemon::serve_ring(SharedRing &ring)
+{
+    std::vector<AsyncCipher::Request> requests;
+    std::vector<std::future<DaemonResponse>> responses;
+    while (true)
+    {
+        // Everything ready at once is submitted together and joins one batch; payloads are
+        // read in place.
+        const std::vector<std::uint32_t> ready = ring.wait_for_requests();
+        for (const std::uint32_t index : ready)
+            requests.push_back(AsyncCipher::Request{ring.request_op(index), ring.request(index), fulfil(responses.emplace_back())});
+        cipher.submit(requests);
+
+        for (size_t i = 0; i < ready.size(); i++)
+            ring.respond(ready[i], responses[i].get());
+        requests.clear();
+        responses.clear();
+    }
+}
@@ -0,0 +1,99 @@
+/// @file daemon.hpp
+/// @brief Declaration of the long-running encryption service behind the `serve` command.
+///
+/// The daemon listens on a Unix domain socket and keeps its key context loaded between
+/// requests. Every message in either direction is one tag byte, a 32-bit big-endian payload
+/// length and the payload:
+/// - request tags: `e` (encrypt text), `d` (decrypt text ciphertext), `E` and `D` (hybrid);
+/// - response tags: DAEMON_OK followed by the result, or DAEMON_ERROR followed by a message.
+///
+/// A connection may send any number of requests and receives the responses in order. Text
+/// requests that arrive together, on any connections, are encrypted or decrypted as one batch
+/// so their blocks share lane-interleaved exponentiations.
+///
+/// Requests are handed to an AsyncCipher, which does the batching on its executor thread.
+///
+/// Co-located clients can instead use a SharedRing (see shm_ring.hpp), which carries the same
+/// requests and responses through shared memory and feeds the same batches.
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "async_cipher.hpp"
+#include "bignum.hpp"
+
+class SharedRing;
+
+/// @brief Response tag for a successful request.
+constexpr char DAEMON_OK = 0x00;
+
+/// @brief Response tag for a failed request; the payload is the error message.
+constexpr char DAEMON_ERROR = 0x01;
+
+/// @brief Largest request payload the daemon accepts, in bytes.
+constexpr std::uint32_t DAEMON_MAX_PAYLOAD = 64u << 20;
+
+/// @brief Default number of slots in a shared-memory ring.
+constexpr std::uint32_t DAEMON_RING_SLOTS = 64;
+
+/// @brief Default payload capacity of a shared-memory ring slot, in bytes.
+constexpr std::uint32_t DAEMON_RING_SLOT_BYTES = 1u << 20;
+
+/// @brief Result of one daemon request.
+struct DaemonResponse
+{
+    char tag;            ///< DAEMON_OK or DAEMON_ERROR.
+    std::string payload; ///< The result, or the error message.
+};
+
+/// @class Daemon
+/// @brief Serves encryption and decryption requests over a Unix domain socket.
+class Daemon
+{
+private:
+    std::string socket_path; ///< Path the socket is bound to.
+    AsyncCipher cipher;      ///< Batches and processes every request with the daemon's key.
+
+    std::vector<std::unique_ptr<SharedRing>> rings; ///< Shared-memory rings served besides the socket.
+
+    /// @brief Queues a request for the cipher.
+    /// @param op Request tag.
+    /// @param payload Request payload; must stay valid until the response is ready.
+    /// @return The future response.
+    std::future<DaemonResponse> enqueue(char op, std::string_view payload);
+
+    /// @brief Answers requests from a shared-memory ring forever.
+    /// @param ring The ring, created by this process.
+    void serve_ring(SharedRing &ring);
+
+    /// @brief Reads requests from a client and writes back responses until it disconnects.
+    /// @param fd The connected socket, closed on return.
+    void serve_connection(int fd);
+
+public:
+    /// @brief Prepares a daemon; nothing is bound until run().
+    /// @param path Path of the Unix domain socket.
+    /// @param key The key used for every request.
+    Daemon(std::string path, KeyHandle key);
+
+    ~Daemon();
+
+    Daemon(const Daemon &) = delete;
+    Daemon &operator=(const Daemon &) = delete;
+
+    /// @brief Also serves requests through a new shared-memory ring once run() is called.
+    /// @param name Name of the shared-memory object, e.g. "bignum".
+    /// @param slot_count Number of requests that can be in flight at once.
+    /// @param slot_bytes Largest request or response payload, in bytes.
+    /// @throws std::runtime_error if the shared memory cannot be created.
+    void add_shared_ring(const std::string &name, std::uint32_t slot_count, std::uint32_t slot_bytes);
+
+    /// @brief Binds the socket and serves clients; does not return once listening.
+    /// @throws std::runtime_error if the socket cannot be created or bound.
+    void run();
+};
@@ -0,0 +1,190 @@
+/// @file huge_pages.cpp
+/// @brief Implementation of the page-level allocator that can back scratch memory with huge pages.
+
+#include "huge_pages.hpp"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    /// @brief Mode used for new blocks.
+    std::atomic<HugePageMode> current_mode{HugePageMode::off};
+
+    /// @brief Bytes mapped so far with each PageBacking, indexed by its value.
+    std::atomic<std::size_t> mapped_bytes[3] = {};
+
+    /// @brief Rounds a size up to a multiple of a power of two.
+    /// @param bytes The size.
+    /// @param unit The power of two.
+    /// @return The rounded size.
+    std::size_t round_up(std::size_t bytes, std::size_t unit)
+    {
+        return (bytes + unit - 1) & ~(unit - 1);
+    }
+
+    /// @brief Maps anonymous read-write memory.
+    /// @param bytes Size of the mapping.
+    /// @param flags Extra mmap flags.
+    /// @return The mapping, or nullptr if the system refused.
+    std::byte *map_anonymous(std::size_t bytes, int flags)
+    {
+        void *memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+        return memory == MAP_FAILED ? nullptr : static_cast<std::byte *>(memory);
+    }
+
+    /// @brief Maps memory aligned to a huge page, trimming the slack of an oversized mapping.
+    /// @param bytes Size of the mapping; a multiple of HUGE_PAGE_BYTES.
+    /// @return The mapping, or nullptr if the system refused.
+    std::byte *map_huge_aligned(std::size_t bytes)
+    {
+        std::byte *raw = map_anonymous(bytes + HUGE_PAGE_BYTES, 0);
+        if (raw == nullptr)
+            return nullptr;
+
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+        std::byte *aligned = raw + (round_up(address, HUGE_PAGE_BYTES) - address);
+        if (aligned != raw)
+            ::munmap(raw, static_cast<std::size_t>(aligned - raw));
+        const std::size_t tail = static_cast<std::size_t>((raw + bytes + HUGE_PAGE_BYTES) - (aligned + bytes));
+        if (tail > 0)
+            ::munmap(aligned + bytes, tail);
+        return aligned;
+    }
+
+    /// @brief Reads the process's transparent huge page usage.
+    /// @return AnonHugePages from /proc/self/smaps_rollup in bytes, or 0 if unavailable.
+    std::size_t anon_huge_bytes()
+    {
+        std::ifstream rollup("/proc/self/smaps_rollup");
+        std::string field;
+        while (rollup >> field)
+        {
+            if (field == "AnonHugePages:")
+            {
+                std::size_t kilobytes = 0;
+                rollup >> kilobytes;
+                return kilobytes * 1024;
+            }
+            rollup.ignore(256, '\n');
+        }
+        return 0;
+    }
+}
+
+/// @brief Parses a huge page mode name.
+/// @param name "off", "madvise" or "hugetlb".
+/// @return The mode.
+/// @throws std::invalid_argument if the name is unknown.
+HugePageMode parse_huge_page_mode(const std::string &name)
+{
+    if (name == "off")
+        return HugePageMode::off;
+    if (name == "madvise")
+        return HugePageMode::madvise;
+    if (name == "hugetlb")
+        return HugePageMode::hugetlb;
+    throw std::invalid_argument("Unsupported huge page mode " + name);
+}
+
+/// @brief Sets which pages new PageBlocks ask for.
+/// @param mode The mode; HugePageMode::off by default.
+void set_huge_page_mode(HugePageMode mode)
+{
+    current_mode.store(mode);
+}
+
+/// @brief Which pages new PageBlocks ask for.
+/// @return The mode.
+HugePageMode huge_page_mode()
+{
+    return current_mode.load();
+}
+
+/// @brief Maps a block with the pages the current HugePageMode asks for.
+/// @param bytes Minimum size; rounded up to whole pages.
+/// @throws std::bad_alloc if no mapping could be made.
+PageBlock::PageBlock(std::size_t bytes)
+{
+    const HugePageMode mode = current_mode.load();
+
+    if (mode != HugePageMode::off)
+    {
+        const std::size_t huge_length = round_up(bytes, HUGE_PAGE_BYTES);
+
+        // MAP_HUGETLB fails unless the administrator reserved enough pages; then try the advice.
+        if (mode == HugePageMode::hugetlb && (base = map_anonymous(huge_length, MAP_HUGETLB)) != nullptr)
+            backing_kind = PageBacking::hugetlb;
+        else if ((base = map_huge_aligned(huge_length)) != nullptr &&
+                 ::madvise(base, huge_length, MADV_HUGEPAGE) == 0)
+            backing_kind = PageBacking::transparent;
+
+        if (base != nullptr)
+            length = huge_length;
+    }
+
+    if (base == nullptr)
+    {
+        length = round_up(bytes, static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+        base = map_anonymous(length, 0);
+        if (base == nullptr)
+            throw std::bad_alloc();
+    }
+
+    mapped_bytes[static_cast<int>(backing_kind)].fetch_add(length, std::memory_order_relaxed);
+}
+
+/// @brief Unmaps the block.
+PageBlock::~PageBlock()
+{
+    if (base != nullptr)
+        ::munmap(base, length);
+}
+
+/// @brief Takes over another block's mapping.
+/// @param other The block; left empty.
+PageBlock::PageBlock(PageBlock &&other) noexcept
+    : base(std::exchange(other.base, nullptr)), length(std::exchange(other.length, 0)), backing_kind(other.backing_kind)
+{
+}
+
+/// @brief Exchanges mappings with another block.
+/// @param other The block.
+/// @return This block.
+PageBlock &PageBlock::operator=(PageBlock &&other) noexcept
+{
+    std::swap(base, other.base);
+    std::swap(length, other.length);
+    std::swap(backing_kind, other.backing_kind);
+    return *this;
+}
+
+/// @brief Collects the totals of every PageBlock mapped so far.
+/// @return The report.
+HugePageReport huge_page_report()
+{
+    return HugePageReport{current_mode.load(),
+                          mapped_bytes[static_cast<int>(PageBacking::hugetlb)].load(std::memory_order_relaxed),
+                          mapped_bytes[static_cast<int>(PageBacking::transparent)].load(std::memory_order_relaxed),
+                          mapped_bytes[static_cast<int>(PageBacking::normal)].load(std::memory_order_relaxed),
+                          anon_huge_bytes()};
+}
+
+/// @brief Formats a report as one line of text.
+/// @param report The report.
+/// @return The description.
+std::string describe(const HugePageReport &report)
+{
+    const auto kib = [](std::size_t bytes)
+    { return std::to_string(bytes / 1024) + " KiB"; };
+    const char *mode = report.mode == HugePageMode::hugetlb ? "hugetlb" : report.mode == HugePageMode::madvise ? "madvise" : "off";
+
+    return std::string("Huge pages (") + mode + "): " + kib(report.hugetlb_bytes) + " reserved, " +
+           kib(report.advised_bytes) + " advised, " + kib(report.normal_bytes) + " normal; " +
+           kib(report.transparent_bytes) + " of the process in transparent huge pages";
+}
@@ -0,0 +1,115 @@
+/// @file huge_pages.hpp
+/// @brief Declaration of the page-level allocator that can back scratch memory with huge pages.
+///
+/// Exponentiation scratch (window tables, lane workspaces, Karatsuba temporaries) is spread
+/// over megabytes per worker, and with 4 KiB pages the TLB misses become measurable. A
+/// PageBlock maps memory directly and, depending on the process-wide HugePageMode, asks for
+/// 2 MiB pages: from the reserved hugetlbfs pool with MAP_HUGETLB, or as transparent huge
+/// pages with madvise(MADV_HUGEPAGE). Each request falls back to the next weaker one when
+/// the system refuses, so a block can always be obtained; huge_page_report() tells what the
+/// process actually got.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// @brief Size of one huge page.
+constexpr std::size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+/// @brief Which pages new PageBlocks ask for.
+enum class HugePageMode
+{
+    off,     ///< Normal pages only.
+    madvise, ///< Huge-page-aligned mappings advised for transparent huge pages.
+    hugetlb  ///< Reserved huge pages (MAP_HUGETLB), falling back to madvise.
+};
+
+/// @brief Parses a huge page mode name.
+/// @param name "off", "madvise" or "hugetlb".
+/// @return The mode.
+/// @throws std::invalid_argument if the name is unknown.
+HugePageMode parse_huge_page_mode(const std::string &name);
+
+/// @brief Sets which pages new PageBlocks ask for.
+///
+/// Memory that is already mapped keeps its pages, so this is best called at startup.
+/// @param mode The mode; HugePageMode::off by default.
+void set_huge_page_mode(HugePageMode mode);
+
+/// @brief Which pages new PageBlocks ask for.
+/// @return The mode.
+HugePageMode huge_page_mode();
+
+/// @brief How a PageBlock is backed.
+enum class PageBacking
+{
+    normal,      ///< Normal pages.
+    transparent, ///< Advised for transparent huge pages; the kernel may or may not use them.
+    hugetlb      ///< Reserved huge pages.
+};
+
+/// @class PageBlock
+/// @brief An anonymous memory mapping, unmapped when the block is destroyed.
+class PageBlock
+{
+private:
+    std::byte *base = nullptr;                      ///< Start of the usable memory.
+    std::size_t length = 0;                         ///< Usable size in bytes.
+    PageBacking backing_kind = PageBacking::normal; ///< Pages the block got.
+
+public:
+    /// @brief Maps a block with the pages the current HugePageMode asks for.
+    /// @param bytes Minimum size; rounded up to whole pages.
+    /// @throws std::bad_alloc if no mapping could be made.
+    explicit PageBlock(std::size_t bytes);
+
+    /// @brief Unmaps the block.
+    ~PageBlock();
+
+    /// @brief Takes over another block's mapping.
+    /// @param other The block; left empty.
+    PageBlock(PageBlock &&other) noexcept;
+
+    /// @brief Exchanges mappings with another block.
+    /// @param other The block.
+    /// @return This block.
+    PageBlock &operator=(PageBlock &&other) noexcept;
+
+    PageBlock(const PageBlock &) = delete;
+    PageBlock &operator=(const PageBlock &) = delete;
+
+    /// @brief Start of the memory.
+    /// @return The memory, aligned to at least a normal page.
+    std::byte *data() const { return base; }
+
+    /// @brief Usable size.
+    /// @return The size in bytes.
+    std::size_t size() const { return length; }
+
+    /// @brief Pages the block got.
+    /// @return The backing.
+    PageBacking backing() const { return backing_kind; }
+};
+
+/// @brief What the process has obtained from PageBlock so far.
+struct HugePageReport
+{
+    HugePageMode mode;             ///< Current mode.
+    std::size_t hugetlb_bytes;     ///< Bytes mapped from reserved huge pages.
+    std::size_t advised_bytes;     ///< Bytes advised for transparent huge pages.
+    std::size_t normal_bytes;      ///< Bytes mapped with normal pages, including refused requests.
+    std::size_t transparent_bytes; ///< Process memory the kernel backs with transparent huge pages right now.
+};
+
+/// @brief Collects the totals of every PageBlock mapped so far.
+///
+/// transparent_bytes comes from /proc/self/smaps_rollup and covers the whole process,
+/// since only the kernel knows which advised pages it actually made huge.
+/// @return The report.
+HugePageReport huge_page_report();
+
+/// @brief Formats a report as one line of text.
+/// @param report The report.
+/// @return The description.
+std::string describe(const HugePageReport &report);
@@ -0,0 +1,204 @@
+/// @file io.cpp
+/// @brief Implementation of the file input and output helpers used by the command-line tool.
+
+#include "io.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    /// @brief Alignment of the output buffer; one page.
+    constexpr std::size_t BUFFER_ALIGNMENT = 4096;
+}
+
+/// @brief Maps a file.
+/// @param path Path of the file.
+MappedFile::MappedFile(const std::string &path) : mapping(nullptr), length(0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open input file: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot read input file: " + path);
+    }
+
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0)
+    {
+        void *data = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot map input file: " + path);
+        }
+
+        // Input is consumed front to back, so let the kernel read ahead aggressively.
+        ::madvise(data, length, MADV_SEQUENTIAL);
+        mapping = static_cast<const char *>(data);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapping != nullptr)
+        ::munmap(const_cast<char *>(mapping), length);
+}
+
+/// @brief The file contents.
+/// @return A view of the mapped bytes, valid while the MappedFile lives.
+std::string_view MappedFile::view() const
+{
+    return mapping == nullptr ? std::string_view() : std::string_view(mapping, length);
+}
+
+/// @brief Splits text into lines without copying.
+/// @param text The text to split.
+/// @return Views into text, one per line.
+std::vector<std::string_view> split_lines(std::string_view text)
+{
+    std::vector<std::string_view> lines;
+    lines.reserve(static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1);
+
+    std::size_t start = 0;
+    while (start < text.size())
+    {
+        const std::size_t end = text.find('\n', start);
+        if (end == std::string_view::npos)
+        {
+            lines.push_back(text.substr(start));
+            break;
+        }
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+/// @brief Allocates the output buffer.
+/// @param buffer_bytes Requested size; rounded up to whole pages.
+/// @throws std::bad_alloc if the buffer cannot be allocated.
+void BufferedWriter::allocate_buffer(std::size_t buffer_bytes)
+{
+    capacity = std::max(BUFFER_ALIGNMENT, (buffer_bytes + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT);
+    buffer = static_cast<char *>(std::aligned_alloc(BUFFER_ALIGNMENT, capacity));
+    if (buffer == nullptr)
+        throw std::bad_alloc();
+}
+
+/// @brief Writes to an already open descriptor, which stays open afterwards.
+/// @param fd The descriptor, e.g. STDOUT_FILENO.
+/// @param buffer_bytes Buffer size in bytes; a full buffer is always flushed.
+/// @param flush_interval Longest time buffered bytes may wait; zero for no limit.
+BufferedWriter::BufferedWriter(int fd, std::size_t buffer_bytes, std::chrono::milliseconds flush_interval)
+    : descriptor(fd), owns_descriptor(false), buffer(nullptr), capacity(0), used(0),
+      interval(flush_interval), last_flush(std::chrono::steady_clock::now())
+{
+    allocate_buffer(buffer_bytes);
+}
+
+/// @brief Creates or truncates a file and writes to it.
+/// @param path Path of the file.
+/// @param buffer_bytes Buffer size in bytes; a full buffer is always flushed.
+/// @param flush_interval Longest time buffered bytes may wait; zero for no limit.
+/// @throws std::runtime_error if the file cannot be created.
+BufferedWriter::BufferedWriter(const std::string &path, std::size_t buffer_bytes, std::chrono::milliseconds flush_interval)
+    : descriptor(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)), owns_descriptor(true),
+      buffer(nullptr), capacity(0), used(0), interval(flush_interval), last_flush(std::chrono::steady_clock::now())
+{
+    // Nothing is owned yet if the open failed, and a constructor that throws runs no destructor.
+    if (descriptor < 0)
+        throw std::runtime_error("Cannot create output file: " + path);
+    try
+    {
+        allocate_buffer(buffer_bytes);
+    }
+    catch (...)
+    {
+        ::close(descriptor);
+        throw;
+    }
+}
+
+/// @brief Flushes remaining bytes and closes an owned descriptor.
+BufferedWriter::~BufferedWriter()
+{
+    // Errors cannot propagate from a destructor; callers that care flush explicitly first.
+    try
+    {
+        flush();
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    if (owns_descriptor)
+        ::close(descriptor);
+    std::free(buffer);
+}
+
+/// @brief Writes bytes straight to the descriptor, retrying short writes.
+/// @param data The bytes to write.
+void BufferedWriter::write_through(std::string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t written = ::write(descriptor, data.data(), data.size());
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+/// @brief Appends bytes to the output.
+/// @param data The bytes to write.
+void BufferedWriter::write(std::string_view data)
+{
+    if (used + data.size() > capacity)
+    {
+        flush();
+
+        // Anything at least as large as the buffer goes out directly instead of being copied.
+        if (data.size() >= capacity)
+        {
+            write_through(data);
+            return;
+        }
+    }
+
+    std::memcpy(buffer + used, data.data(), data.size());
+    used += data.size();
+    poll();
+}
+
+/// @brief Flushes if bytes have waited longer than the flush interval.
+void BufferedWriter::poll()
+{
+    if (used > 0 && interval != std::chrono::steady_clock::duration::zero() &&
+        std::chrono::steady_clock::now() - last_flush >= interval)
+        flush();
+}
+
+/// @brief Hands all buffered bytes to the kernel.
+void BufferedWriter::flush()
+{
+    const std::size_t pending = used;
+    used = 0;
+    last_flush = std::chrono::steady_clock::now();
+    write_through(std::string_view(buffer, pending));
+}
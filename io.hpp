@@ -0,0 +1,112 @@
+/// @file io.hpp
+/// @brief Declaration of the file input and output helpers used by the command-line tool.
+///
+/// Batch jobs read their input through a read-only memory mapping and split it into
+/// lines as string views, so no line is copied before it is encrypted. Output goes
+/// through a large page-aligned buffer that is handed to the kernel in few, big writes.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @class MappedFile
+/// @brief A whole file mapped read-only into memory.
+class MappedFile
+{
+private:
+    const char *mapping; ///< Start of the mapping, or nullptr for an empty file.
+    std::size_t length;  ///< Length of the file in bytes.
+
+public:
+    /// @brief Maps a file.
+    /// @param path Path of the file.
+    /// @throws std::runtime_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /// @brief The file contents.
+    /// @return A view of the mapped bytes, valid while the MappedFile lives.
+    std::string_view view() const;
+};
+
+/// @brief Splits text into lines without copying.
+///
+/// Lines end at '\n', which is not included; a final line without a newline is kept, and
+/// a trailing newline does not start an empty line (the same lines std::getline yields).
+/// @param text The text to split.
+/// @return Views into text, one per line.
+std::vector<std::string_view> split_lines(std::string_view text);
+
+/// @class BufferedWriter
+/// @brief Writes to a file descriptor through a large page-aligned buffer.
+///
+/// Bytes reach the kernel only when the buffer fills, when flush() is called, or, if a flush
+/// interval is set, on the first write() or poll() after the interval has passed since the
+/// last flush. A long-running producer thus sees bounded latency without paying a system
+/// call per record.
+class BufferedWriter
+{
+private:
+    int descriptor;        ///< Destination file descriptor.
+    bool owns_descriptor;  ///< Whether the descriptor is closed on destruction.
+    char *buffer;          ///< Page-aligned output buffer.
+    std::size_t capacity;  ///< Size of the buffer in bytes.
+    std::size_t used;      ///< Number of buffered bytes.
+    std::chrono::steady_clock::duration interval;    ///< Longest time bytes may wait; zero for no limit.
+    std::chrono::steady_clock::time_point last_flush; ///< When the buffer was last handed to the kernel.
+
+    /// @brief Allocates the output buffer.
+    /// @param buffer_bytes Requested size; rounded up to whole pages.
+    /// @throws std::bad_alloc if the buffer cannot be allocated.
+    void allocate_buffer(std::size_t buffer_bytes);
+
+    /// @brief Writes bytes straight to the descriptor, retrying short writes.
+    /// @param data The bytes to write.
+    void write_through(std::string_view data);
+
+public:
+    /// @brief Default buffer size in bytes.
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 20;
+
+    /// @brief Writes to an already open descriptor, which stays open afterwards.
+    /// @param fd The descriptor, e.g. STDOUT_FILENO.
+    /// @param buffer_bytes Buffer size in bytes; a full buffer is always flushed.
+    /// @param flush_interval Longest time buffered bytes may wait; zero for no limit.
+    explicit BufferedWriter(int fd, std::size_t buffer_bytes = DEFAULT_CAPACITY,
+                            std::chrono::milliseconds flush_interval = std::chrono::milliseconds::zero());
+
+    /// @brief Creates or truncates a file and writes to it.
+    /// @param path Path of the file.
+    /// @param buffer_bytes Buffer size in bytes; a full buffer is always flushed.
+    /// @param flush_interval Longest time buffered bytes may wait; zero for no limit.
+    /// @throws std::runtime_error if the file cannot be created.
+    explicit BufferedWriter(const std::string &path, std::size_t buffer_bytes = DEFAULT_CAPACITY,
+                            std::chrono::milliseconds flush_interval = std::chrono::milliseconds::zero());
+
+    /// @brief Flushes remaining bytes and closes an owned descriptor.
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    /// @brief Appends bytes to the output.
+    /// @param data The bytes to write.
+    void write(std::string_view data);
+
+    /// @brief Flushes if bytes have waited longer than the flush interval.
+    ///
+    /// Meant for event loops that may go quiet with output still buffered.
+    void poll();
+
+    /// @brief Hands all buffered bytes to the kernel.
+    /// @throws std::runtime_error if the write fails.
+    void flush();
+};
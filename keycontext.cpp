@@ -0,0 +1,437 @@
+/// @file keycontext.cpp
+/// @brief Implementation of the KeyContext class and its binary key file format.
+///
+/// A key file starts with a fixed header followed by a table of sections. Every section
+/// is an array of little-endian 32-bit words (limbs or recoding steps) starting at an
+/// 8-byte aligned offset, so a mapped file can be copied straight into the engine's
+/// structures without parsing.
+
+#include "keycontext.hpp"
+#include "numa.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    /// @brief Magic bytes at the start of every key file.
+    constexpr char KEY_FILE_MAGIC[8] = {'B', 'N', 'K', 'E', 'Y', 'F', 'I', 'L'};
+
+    /// @brief Current key file format version.
+    constexpr std::uint32_t KEY_FILE_VERSION = 1;
+
+    /// @brief Identifiers of the sections stored in a key file.
+    enum SectionId : std::uint32_t
+    {
+        SECTION_MODULUS = 1,
+        SECTION_MODULUS_BARRETT,
+        SECTION_PUBLIC_EXPONENT,
+        SECTION_PRIVATE_EXPONENT,
+        SECTION_PUBLIC_RECODING,
+        SECTION_PRIVATE_RECODING,
+        SECTION_PRIME_P,
+        SECTION_PRIME_P_BARRETT,
+        SECTION_PRIME_Q,
+        SECTION_PRIME_Q_BARRETT,
+        SECTION_EXPONENT_P_RECODING,
+        SECTION_EXPONENT_Q_RECODING,
+        SECTION_Q_INVERSE,
+    };
+
+    /// @brief Fixed header at the start of a key file.
+    struct KeyFileHeader
+    {
+        char magic[8];               ///< KEY_FILE_MAGIC.
+        std::uint32_t version;       ///< KEY_FILE_VERSION.
+        std::uint32_t limb_base;     ///< LIMB_BASE the limbs were written with.
+        std::uint32_t section_count; ///< Number of entries in the section table.
+        std::uint32_t reserved;      ///< Zero.
+    };
+
+    /// @brief One entry of the section table.
+    struct KeyFileSection
+    {
+        std::uint32_t id;     ///< SectionId of the payload.
+        std::uint32_t param;  ///< Window width for recoding sections, otherwise zero.
+        std::uint64_t offset; ///< Byte offset of the payload from the start of the file.
+        std::uint64_t count;  ///< Number of 32-bit words in the payload.
+    };
+
+    /// @brief A section payload waiting to be written.
+    struct PendingSection
+    {
+        std::uint32_t id;                 ///< SectionId of the payload.
+        std::uint32_t param;              ///< Section parameter.
+        std::vector<std::uint32_t> words; ///< Payload words.
+    };
+
+    /// @brief Flattens a recoding into payload words.
+    /// @param recoding The recoding to flatten.
+    /// @return Alternating squaring counts and digits.
+    std::vector<std::uint32_t> recoding_words(const ExponentRecoding &recoding)
+    {
+        std::vector<std::uint32_t> words;
+        words.reserve(recoding.steps().size() * 2);
+        for (const ExponentRecoding::Step &step : recoding.steps())
+        {
+            words.push_back(step.squarings);
+            words.push_back(step.digit);
+        }
+        return words;
+    }
+
+    /// @brief Read-only view of a mapped key file.
+    class MappedKeyFile
+    {
+    private:
+        const unsigned char *data; ///< Start of the mapping.
+        std::size_t size;          ///< Length of the mapping in bytes.
+        const KeyFileSection *sections; ///< Section table inside the mapping.
+        std::uint32_t section_count;    ///< Number of sections.
+
+    public:
+        explicit MappedKeyFile(const std::string &path) : data(nullptr), size(0), sections(nullptr), section_count(0)
+        {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open key file: " + path);
+
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(KeyFileHeader)))
+            {
+                ::close(fd);
+                throw std::runtime_error("Key file is truncated: " + path);
+            }
+
+            size = static_cast<std::size_t>(st.st_size);
+            void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED)
+                throw std::runtime_error("Cannot map key file: " + path);
+            data = static_cast<const unsigned char *>(mapping);
+
+            const KeyFileHeader *header = reinterpret_cast<const KeyFileHeader *>(data);
+            if (std::memcmp(header->magic, KEY_FILE_MAGIC, sizeof(KEY_FILE_MAGIC)) != 0 ||
+                header->version != KEY_FILE_VERSION || header->limb_base != LIMB_BASE ||
+                sizeof(KeyFileHeader) + header->section_count * sizeof(KeyFileSection) > size)
+            {
+                ::munmap(mapping, size);
+                throw std::runtime_error("Not a valid key file: " + path);
+            }
+
+            section_count = header->section_count;
+            sections = reinterpret_cast<const KeyFileSection *>(data + sizeof(KeyFileHeader));
+            for (std::uint32_t i = 0; i < section_count; i++)
+            {
+                if (sections[i].offset % alignof(std::uint64_t) != 0 || sections[i].offset > size ||
+                    sections[i].count > (size - sections[i].offset) / sizeof(std::uint32_t))
+                {
+                    ::munmap(mapping, size);
+                    throw std::runtime_error("Corrupt section table in key file: " + path);
+                }
+            }
+        }
+
+        ~MappedKeyFile()
+        {
+            ::munmap(const_cast<unsigned char *>(data), size);
+        }
+
+        MappedKeyFile(const MappedKeyFile &) = delete;
+        MappedKeyFile &operator=(const MappedKeyFile &) = delete;
+
+        /// @brief Finds a section by identifier.
+        /// @param id The SectionId to look up.
+        /// @return A pointer to the table entry, or nullptr when absent.
+        const KeyFileSection *find(std::uint32_t id) const
+        {
+            for (std::uint32_t i = 0; i < section_count; i++)
+                if (sections[i].id == id)
+                    return &sections[i];
+            return nullptr;
+        }
+
+        /// @brief Returns the words of a required section.
+        /// @param id The SectionId to look up.
+        /// @return A copy of the payload words.
+        std::vector<std::uint32_t> words(std::uint32_t id) const
+        {
+            const KeyFileSection *section = find(id);
+            if (section == nullptr)
+                throw std::runtime_error("Key file is missing a required section");
+
+            const std::uint32_t *first = reinterpret_cast<const std::uint32_t *>(data + section->offset);
+            return std::vector<std::uint32_t>(first, first + section->count);
+        }
+
+        /// @brief Returns a required recoding section.
+        /// @param id The SectionId to look up.
+        /// @return The rebuilt recoding.
+        ExponentRecoding recoding(std::uint32_t id) const
+        {
+            const std::vector<std::uint32_t> flat = words(id);
+            const std::uint32_t window = find(id)->param;
+            if (flat.size() % 2 != 0 || window == 0 || window > 8)
+                throw std::runtime_error("Key file has a malformed exponent recoding");
+
+            // Digits index the window table, so reject anything the engine could not look up.
+            std::vector<ExponentRecoding::Step> steps(flat.size() / 2);
+            for (std::size_t i = 0; i < steps.size(); i++)
+            {
+                steps[i] = {flat[2 * i], flat[2 * i + 1]};
+                const bool odd_in_window = steps[i].digit % 2 == 1 && steps[i].digit < (1u << window);
+                if (!(odd_in_window || (i > 0 && steps[i].digit == 0)))
+                    throw std::runtime_error("Key file has a malformed exponent recoding");
+            }
+            return ExponentRecoding(window, std::move(steps));
+        }
+    };
+
+    /// @brief Computes the CRT parameters for a key with known primes.
+    /// @param private_exponent The private exponent d.
+    /// @param prime_p The prime p.
+    /// @param prime_q The prime q.
+    /// @return The CRT parameters.
+    CrtParameters make_crt(const std::vector<Limb> &private_exponent, const std::vector<Limb> &prime_p,
+                           const std::vector<Limb> &prime_q)
+    {
+        const std::vector<Limb> one = {1};
+        std::vector<Limb> quotient, exponent_p, exponent_q;
+        divide_limbs(private_exponent, subtract_limbs(prime_p, one), quotient, exponent_p);
+        divide_limbs(private_exponent, subtract_limbs(prime_q, one), quotient, exponent_q);
+
+        return CrtParameters{LaneModulus(prime_p), LaneModulus(prime_q), ExponentRecoding(exponent_p),
+                             ExponentRecoding(exponent_q), inverse_limbs(prime_q, prime_p)};
+    }
+
+    /// @brief Replaces a file with contents only its owner can read.
+    ///
+    /// The contents go to a mode 0600 temporary file in the same directory, which is synced
+    /// and renamed over the target, so a crash leaves either the old file or the new one.
+    /// @param path Path of the file.
+    /// @param contents The contents.
+    /// @throws std::runtime_error if the file cannot be written.
+    void write_private_file(const std::string &path, const std::string &contents)
+    {
+        std::string temporary = path + ".XXXXXX";
+        const int descriptor = ::mkostemp(temporary.data(), O_CLOEXEC);
+        if (descriptor < 0)
+            throw std::runtime_error("Cannot write key file: " + path);
+
+        bool written = ::fchmod(descriptor, 0600) == 0;
+        for (std::size_t done = 0; written && done < contents.size();)
+        {
+            const ssize_t count = ::write(descriptor, contents.data() + done, contents.size() - done);
+            if (count < 0 && errno == EINTR)
+                continue;
+            written = count > 0;
+            done += written ? static_cast<std::size_t>(count) : 0;
+        }
+        written = ::fsync(descriptor) == 0 && written;
+        written = ::close(descriptor) == 0 && written;
+
+        if (!written || ::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            ::unlink(temporary.c_str());
+            throw std::runtime_error("Cannot write key file: " + path);
+        }
+    }
+}
+
+/// @brief Per-node copies of a context.
+struct KeyContext::NodeReplicas
+{
+    std::mutex mutex;                                            ///< Serialises making copies.
+    std::vector<std::atomic<const KeyContext *>> copies;         ///< Copy for each node, once made.
+    std::vector<std::unique_ptr<const KeyContext>> owned_copies; ///< Owns the copies; guarded by mutex.
+
+    /// @brief Creates an empty set.
+    /// @param node_count Number of nodes.
+    explicit NodeReplicas(size_t node_count) : copies(node_count) {}
+};
+
+/// @brief Makes an empty set of copies if the host has more than one NUMA node.
+/// @return The set, or null.
+std::shared_ptr<KeyContext::NodeReplicas> KeyContext::make_replicas()
+{
+    const size_t nodes = NumaTopology::system().node_count();
+    return nodes > 1 ? std::make_shared<NodeReplicas>(nodes) : nullptr;
+}
+
+/// @brief Assembles a context from already computed parts.
+KeyContext::KeyContext(LaneModulus modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent,
+                       ExponentRecoding public_recoding, ExponentRecoding private_recoding,
+                       std::optional<CrtParameters> crt)
+    : modulus_ctx(std::move(modulus)), public_exp(std::move(public_exponent)), private_exp(std::move(private_exponent)),
+      public_rec(std::move(public_recoding)), private_rec(std::move(private_recoding)), crt_params(std::move(crt)),
+      replicas(make_replicas())
+{
+}
+
+/// @brief Builds a context from the modulus and exponents, computing all constants.
+/// @param modulus The modulus n, least significant limb first.
+/// @param public_exponent The public exponent e, least significant limb first.
+/// @param private_exponent The private exponent d, least significant limb first.
+KeyContext::KeyContext(std::vector<Limb> modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent)
+    : modulus_ctx(std::move(modulus)), public_exp(std::move(public_exponent)), private_exp(std::move(private_exponent)),
+      public_rec(public_exp), private_rec(private_exp), replicas(make_replicas())
+{
+}
+
+/// @brief Builds a context with CRT parameters from the modulus, exponents and primes.
+/// @param modulus The modulus n, least significant limb first.
+/// @param public_exponent The public exponent e, least significant limb first.
+/// @param private_exponent The private exponent d, least significant limb first.
+/// @param prime_p The prime p, least significant limb first.
+/// @param prime_q The prime q, least significant limb first.
+KeyContext::KeyContext(std::vector<Limb> modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent,
+                       const std::vector<Limb> &prime_p, const std::vector<Limb> &prime_q)
+    : KeyContext(std::move(modulus), std::move(public_exponent), std::move(private_exponent))
+{
+    if (compare_limbs(multiply_limbs(prime_p, prime_q), modulus_ctx.limbs()) != 0)
+        throw std::invalid_argument("The primes do not multiply to the modulus");
+
+    crt_params = make_crt(private_exp, prime_p, prime_q);
+}
+
+/// @brief Loads a context from a binary key file.
+/// @param path Path of the key file.
+/// @return The loaded context.
+KeyContext KeyContext::load(const std::string &path)
+{
+    const MappedKeyFile file(path);
+
+    std::optional<CrtParameters> crt;
+    if (file.find(SECTION_PRIME_P) != nullptr)
+    {
+        crt = CrtParameters{LaneModulus(file.words(SECTION_PRIME_P), file.words(SECTION_PRIME_P_BARRETT)),
+                            LaneModulus(file.words(SECTION_PRIME_Q), file.words(SECTION_PRIME_Q_BARRETT)),
+                            file.recoding(SECTION_EXPONENT_P_RECODING), file.recoding(SECTION_EXPONENT_Q_RECODING),
+                            file.words(SECTION_Q_INVERSE)};
+    }
+
+    return KeyContext(LaneModulus(file.words(SECTION_MODULUS), file.words(SECTION_MODULUS_BARRETT)),
+                      file.words(SECTION_PUBLIC_EXPONENT), file.words(SECTION_PRIVATE_EXPONENT),
+                      file.recoding(SECTION_PUBLIC_RECODING), file.recoding(SECTION_PRIVATE_RECODING), std::move(crt));
+}
+
+/// @brief Writes the context to a binary key file.
+/// @param path Path of the key file.
+void KeyContext::save(const std::string &path) const
+{
+    std::vector<PendingSection> pending = {
+        {SECTION_MODULUS, 0, modulus_ctx.limbs()},
+        {SECTION_MODULUS_BARRETT, 0, modulus_ctx.barrett()},
+        {SECTION_PUBLIC_EXPONENT, 0, public_exp},
+        {SECTION_PRIVATE_EXPONENT, 0, private_exp},
+        {SECTION_PUBLIC_RECODING, public_rec.window_bits(), recoding_words(public_rec)},
+        {SECTION_PRIVATE_RECODING, private_rec.window_bits(), recoding_words(private_rec)},
+    };
+
+    if (crt_params)
+    {
+        pending.push_back({SECTION_PRIME_P, 0, crt_params->prime_p.limbs()});
+        pending.push_back({SECTION_PRIME_P_BARRETT, 0, crt_params->prime_p.barrett()});
+        pending.push_back({SECTION_PRIME_Q, 0, crt_params->prime_q.limbs()});
+        pending.push_back({SECTION_PRIME_Q_BARRETT, 0, crt_params->prime_q.barrett()});
+        pending.push_back({SECTION_EXPONENT_P_RECODING, crt_params->exponent_p.window_bits(), recoding_words(crt_params->exponent_p)});
+        pending.push_back({SECTION_EXPONENT_Q_RECODING, crt_params->exponent_q.window_bits(), recoding_words(crt_params->exponent_q)});
+        pending.push_back({SECTION_Q_INVERSE, 0, crt_params->q_inverse});
+    }
+
+    KeyFileHeader header{};
+    std::memcpy(header.magic, KEY_FILE_MAGIC, sizeof(KEY_FILE_MAGIC));
+    header.version = KEY_FILE_VERSION;
+    header.limb_base = LIMB_BASE;
+    header.section_count = static_cast<std::uint32_t>(pending.size());
+
+    std::vector<KeyFileSection> table;
+    std::uint64_t offset = sizeof(KeyFileHeader) + pending.size() * sizeof(KeyFileSection);
+    for (const PendingSection &section : pending)
+    {
+        offset = (offset + 7) & ~std::uint64_t{7};
+        table.push_back({section.id, section.param, offset, section.words.size()});
+        offset += section.words.size() * sizeof(std::uint32_t);
+    }
+
+    std::string image(offset, '\0');
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), table.data(), table.size() * sizeof(KeyFileSection));
+    for (std::size_t i = 0; i < pending.size(); i++)
+        std::memcpy(image.data() + table[i].offset, pending[i].words.data(), pending[i].words.size() * sizeof(std::uint32_t));
+
+    write_private_file(path, image);
+}
+
+/// @brief The modulus with its Barrett constant.
+/// @return A reference to the modulus context.
+const LaneModulus &KeyContext::modulus() const
+{
+    return modulus_ctx;
+}
+
+/// @brief The public exponent.
+/// @return A reference to the exponent limbs.
+const std::vector<Limb> &KeyContext::public_exponent() const
+{
+    return public_exp;
+}
+
+/// @brief The private exponent.
+/// @return A reference to the exponent limbs.
+const std::vector<Limb> &KeyContext::private_exponent() const
+{
+    return private_exp;
+}
+
+/// @brief The recoded public exponent.
+/// @return A reference to the recoding.
+const ExponentRecoding &KeyContext::public_recoding() const
+{
+    return public_rec;
+}
+
+/// @brief The recoded private exponent.
+/// @return A reference to the recoding.
+const ExponentRecoding &KeyContext::private_recoding() const
+{
+    return private_rec;
+}
+
+/// @brief The CRT parameters.
+/// @return A pointer to the parameters, or nullptr when the primes are unknown.
+const CrtParameters *KeyContext::crt() const
+{
+    return crt_params ? &*crt_params : nullptr;
+}
+
+/// @brief The copy of this context on the calling thread's NUMA node.
+/// @return The node-local context, valid as long as this one.
+const KeyContext &KeyContext::local() const
+{
+    if (!replicas)
+        return *this;
+
+    std::atomic<const KeyContext *> &slot = replicas->copies[NumaTopology::system().current_node()];
+    if (const KeyContext *copy = slot.load(std::memory_order_acquire))
+        return *copy;
+
+    std::lock_guard<std::mutex> lock(replicas->mutex);
+    if (const KeyContext *copy = slot.load(std::memory_order_relaxed))
+        return *copy;
+
+    // Copying on this thread allocates the copy's tables on this thread's node.
+    auto copy = std::make_unique<KeyContext>(*this);
+    copy->replicas.reset();
+    slot.store(copy.get(), std::memory_order_release);
+    replicas->owned_copies.push_back(std::move(copy));
+    return *replicas->owned_copies.back();
+}
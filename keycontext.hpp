@@ -0,0 +1,117 @@
+/// @file keycontext.hpp
+/// @brief Declaration of the KeyContext class holding an RSA key and its precomputation.
+///
+/// A KeyContext carries everything the exponentiation engine needs for one key: the
+/// modulus with its Barrett constant, the recoded public and private exponents and,
+/// when the primes are known, the CRT parameters. Contexts can be saved to and loaded
+/// from a binary key file whose sections are stored in the engine's limb format, so
+/// loading involves no decimal parsing and no division.
+///
+/// On multi-node hosts, local() hands each NUMA node its own copy of the context, so workers
+/// read the key tables from local memory.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "modexp_lanes.hpp"
+
+/// @brief CRT parameters of a private key with known primes.
+struct CrtParameters
+{
+    LaneModulus prime_p;             ///< First prime p with its Barrett constant.
+    LaneModulus prime_q;             ///< Second prime q with its Barrett constant.
+    ExponentRecoding exponent_p;     ///< Recoding of d mod (p - 1).
+    ExponentRecoding exponent_q;     ///< Recoding of d mod (q - 1).
+    std::vector<Limb> q_inverse;     ///< q^-1 mod p, least significant limb first.
+};
+
+/// @class KeyContext
+/// @brief An RSA key pair together with all of its precomputed constants.
+class KeyContext
+{
+private:
+    LaneModulus modulus_ctx;                 ///< Modulus n with its Barrett constant.
+    std::vector<Limb> public_exp;            ///< Public exponent e.
+    std::vector<Limb> private_exp;           ///< Private exponent d.
+    ExponentRecoding public_rec;             ///< Sliding-window recoding of e.
+    ExponentRecoding private_rec;            ///< Sliding-window recoding of d.
+    std::optional<CrtParameters> crt_params; ///< CRT parameters, when p and q are known.
+
+    /// @brief Per-node copies of a context; defined in keycontext.cpp.
+    struct NodeReplicas;
+
+    /// @brief Copies of this context made by local(); null on single-node hosts and in the copies.
+    std::shared_ptr<NodeReplicas> replicas;
+
+    /// @brief Makes an empty set of copies if the host has more than one NUMA node.
+    /// @return The set, or null.
+    static std::shared_ptr<NodeReplicas> make_replicas();
+
+    /// @brief Assembles a context from already computed parts.
+    KeyContext(LaneModulus modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent,
+               ExponentRecoding public_recoding, ExponentRecoding private_recoding,
+               std::optional<CrtParameters> crt);
+
+public:
+    /// @brief Builds a context from the modulus and exponents, computing all constants.
+    /// @param modulus The modulus n, least significant limb first.
+    /// @param public_exponent The public exponent e, least significant limb first.
+    /// @param private_exponent The private exponent d, least significant limb first.
+    KeyContext(std::vector<Limb> modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent);
+
+    /// @brief Builds a context with CRT parameters from the modulus, exponents and primes.
+    /// @param modulus The modulus n, least significant limb first.
+    /// @param public_exponent The public exponent e, least significant limb first.
+    /// @param private_exponent The private exponent d, least significant limb first.
+    /// @param prime_p The prime p, least significant limb first.
+    /// @param prime_q The prime q, least significant limb first.
+    KeyContext(std::vector<Limb> modulus, std::vector<Limb> public_exponent, std::vector<Limb> private_exponent,
+               const std::vector<Limb> &prime_p, const std::vector<Limb> &prime_q);
+
+    /// @brief Loads a context from a binary key file.
+    /// @param path Path of the key file.
+    /// @return The loaded context.
+    static KeyContext load(const std::string &path);
+
+    /// @brief Writes the context to a binary key file.
+    /// @param path Path of the key file.
+    void save(const std::string &path) const;
+
+    /// @brief The modulus with its Barrett constant.
+    /// @return A reference to the modulus context.
+    const LaneModulus &modulus() const;
+
+    /// @brief The public exponent.
+    /// @return A reference to the exponent limbs.
+    const std::vector<Limb> &public_exponent() const;
+
+    /// @brief The private exponent.
+    /// @return A reference to the exponent limbs.
+    const std::vector<Limb> &private_exponent() const;
+
+    /// @brief The recoded public exponent.
+    /// @return A reference to the recoding.
+    const ExponentRecoding &public_recoding() const;
+
+    /// @brief The recoded private exponent.
+    /// @return A reference to the recoding.
+    const ExponentRecoding &private_recoding() const;
+
+    /// @brief The CRT parameters.
+    /// @return A pointer to the parameters, or nullptr when the primes are unknown.
+    const CrtParameters *crt() const;
+
+    /// @brief The copy of this context on the calling thread's NUMA node.
+    ///
+    /// Each copy is made by the first thread that asks for it on its node, so the copy's tables
+    /// are allocated in that node's memory. On single-node hosts this is the context itself.
+    /// @return The node-local context, valid as long as this one.
+    const KeyContext &local() const;
+};
+
+/// @brief Shared, immutable handle to a key context; safe to use from many threads.
+using KeyHandle = std::shared_ptr<const KeyContext>;
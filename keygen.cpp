@@ -0,0 +1,314 @@
+/// @file keygen.cpp
+/// @brief Implementation of the KeyGenerator class.
+///
+/// Each random starting point is sieved over SIEVE_WINDOW odd offsets at once: the
+/// starting point is reduced modulo every small prime a single time, after which
+/// marking composites costs one step per multiple. Only survivors reach Miller-Rabin,
+/// whose first round uses base 2 on a single lane to reject most composites cheaply
+/// before the remaining rounds run four witnesses per batch.
+///
+/// Windows are independent, so each one is a task on the work-stealing pool and the first
+/// distinct primes found win; windows still in progress notice the shared flag between
+/// candidates (and between Miller-Rabin rounds) and stop.
+
+#include "keygen.hpp"
+#include "secure_random.hpp"
+#include "work_stealing.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    /// @brief Small primes up to this bound are used for sieving.
+    constexpr std::uint32_t SIEVE_PRIME_LIMIT = 1 << 16;
+
+    /// @brief Number of odd offsets sieved per random starting point.
+    constexpr std::size_t SIEVE_WINDOW = 4096;
+
+    /// @brief Returns the odd primes below SIEVE_PRIME_LIMIT.
+    /// @return A reference to the shared table.
+    const std::vector<std::uint32_t> &small_primes()
+    {
+        static const std::vector<std::uint32_t> primes = []()
+        {
+            std::vector<bool> composite(SIEVE_PRIME_LIMIT, false);
+            std::vector<std::uint32_t> table;
+            for (std::uint32_t i = 3; i < SIEVE_PRIME_LIMIT; i += 2)
+            {
+                if (composite[i])
+                    continue;
+                table.push_back(i);
+                for (std::uint64_t j = static_cast<std::uint64_t>(i) * i; j < SIEVE_PRIME_LIMIT; j += 2 * i)
+                    composite[j] = true;
+            }
+            return table;
+        }();
+        return primes;
+    }
+
+    /// @brief Computes a limb value modulo a small number.
+    /// @param value Limbs, least significant first.
+    /// @param divisor Non-zero divisor below 2^32.
+    /// @return The remainder.
+    std::uint32_t mod_small(const std::vector<Limb> &value, std::uint32_t divisor)
+    {
+        std::uint64_t rem = 0;
+        for (std::size_t i = value.size(); i-- > 0;)
+            rem = (rem * LIMB_BASE + value[i]) % divisor;
+        return static_cast<std::uint32_t>(rem);
+    }
+
+    /// @brief Converts a small number to limbs.
+    /// @param value The number.
+    /// @return Limbs, least significant first.
+    std::vector<Limb> small_to_limbs(std::uint64_t value)
+    {
+        std::vector<Limb> limbs;
+        for (; value > 0; value /= LIMB_BASE)
+            limbs.push_back(static_cast<Limb>(value % LIMB_BASE));
+        return limbs;
+    }
+}
+
+/// @brief Creates a generator for keys of the given size.
+/// @param bits Bit length of the modulus; even and at least 64.
+/// @param public_exponent Odd public exponent e, at least 3.
+/// @param threads Number of windows searched at once; zero uses one per hardware thread.
+KeyGenerator::KeyGenerator(unsigned bits, std::uint32_t public_exponent, unsigned threads)
+    : modulus_bits(bits), public_exp(public_exponent), public_exp_limbs(small_to_limbs(public_exponent)),
+      worker_count(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+    if (bits < 64 || bits % 2 != 0)
+        throw std::invalid_argument("Modulus size must be an even number of bits, at least 64");
+    if (public_exponent < 3 || public_exponent % 2 == 0)
+        throw std::invalid_argument("Public exponent must be odd and at least 3");
+}
+
+/// @brief Generates a new key pair.
+/// @return A key context with the modulus, both exponents and the CRT parameters.
+KeyContext KeyGenerator::generate() const
+{
+    // p and q are searched for together by the same pool of workers.
+    const std::vector<std::vector<Limb>> primes = random_primes(modulus_bits / 2, 2);
+    const std::vector<Limb> &p = primes[0];
+    const std::vector<Limb> &q = primes[1];
+
+    // d = e^-1 mod lambda(n), lambda(n) = lcm(p - 1, q - 1).
+    const std::vector<Limb> one = {1};
+    const std::vector<Limb> p_minus_1 = subtract_limbs(p, one);
+    const std::vector<Limb> q_minus_1 = subtract_limbs(q, one);
+    std::vector<Limb> reduced, remainder;
+    divide_limbs(p_minus_1, gcd_limbs(p_minus_1, q_minus_1), reduced, remainder);
+    const std::vector<Limb> lambda = multiply_limbs(reduced, q_minus_1);
+
+    std::vector<Limb> private_exponent = inverse_limbs(public_exp_limbs, lambda);
+    return KeyContext(multiply_limbs(p, q), public_exp_limbs, std::move(private_exponent), p, q);
+}
+
+/// @brief Finds a random prime p of exactly the given size with gcd(p - 1, e) = 1.
+/// @param bits Bit length of the prime.
+/// @return The prime as limbs, least significant first.
+std::vector<Limb> KeyGenerator::random_prime(unsigned bits) const
+{
+    return random_primes(bits, 1).front();
+}
+
+/// @brief Finds several distinct random primes concurrently, as random_prime does.
+/// @param bits Bit length of each prime.
+/// @param count Number of distinct primes to find.
+/// @return The primes as limbs, least significant first, in the order they were found.
+std::vector<std::vector<Limb>> KeyGenerator::random_primes(unsigned bits, std::size_t count) const
+{
+    std::vector<std::vector<Limb>> found;
+    std::mutex found_mutex;
+    std::atomic<bool> done(count == 0);
+
+    // Every task searches one window and queues the next, so the search keeps worker_count
+    // windows in flight and stops as soon as enough primes are found.
+    TaskGroup searches;
+    std::function<void()> search = [&]()
+    {
+        try
+        {
+            std::optional<std::vector<Limb>> prime = search_window(bits, done);
+            if (prime)
+            {
+                std::lock_guard<std::mutex> lock(found_mutex);
+                const bool duplicate = std::any_of(found.begin(), found.end(), [&](const std::vector<Limb> &other)
+                                                   { return compare_limbs(other, *prime) == 0; });
+                if (found.size() < count && !duplicate)
+                    found.push_back(std::move(*prime));
+                if (found.size() >= count)
+                    done.store(true, std::memory_order_relaxed);
+            }
+        }
+        catch (...)
+        {
+            done.store(true, std::memory_order_relaxed);
+            throw;
+        }
+
+        if (!done.load(std::memory_order_relaxed))
+            searches.run(search);
+    };
+
+    if (!done.load(std::memory_order_relaxed))
+    {
+        for (unsigned i = 0; i < worker_count; i++)
+            searches.run(search);
+    }
+    searches.wait();
+
+    return found;
+}
+
+/// @brief Sieves and tests one window of candidates after a random starting point.
+/// @param bits Bit length of the prime.
+/// @param cancelled Set by another search once enough primes are found.
+/// @return A prime, or nothing if the window held none or the search was cancelled.
+std::optional<std::vector<Limb>> KeyGenerator::search_window(unsigned bits, const std::atomic<bool> &cancelled) const
+{
+    const std::vector<std::uint32_t> &primes = small_primes();
+    const std::size_t byte_length = (bits + 7) / 8;
+    const unsigned rounds = miller_rabin_rounds(bits);
+
+    std::vector<std::uint8_t> limit_bytes(bits / 8 + 1, 0);
+    limit_bytes[0] = static_cast<std::uint8_t>(1u << (bits % 8));
+    const std::vector<Limb> limit = bytes_to_limbs(limit_bytes); // 2^bits
+
+    std::vector<std::uint8_t> bytes = random_bytes(byte_length);
+    bytes[0] &= static_cast<std::uint8_t>(0xFF >> (byte_length * 8 - bits));
+    for (const unsigned bit : {bits - 1, bits - 2})
+        bytes[byte_length - 1 - bit / 8] |= static_cast<std::uint8_t>(1u << (bit % 8));
+    bytes.back() |= 1;
+
+    const std::vector<Limb> start = bytes_to_limbs(bytes);
+    const std::uint32_t start_mod_e = mod_small(start, public_exp);
+
+    // composite[j] marks start + 2j as divisible by a small prime.
+    std::vector<bool> composite(SIEVE_WINDOW, false);
+    for (const std::uint32_t p : primes)
+    {
+        std::uint64_t delta = (p - mod_small(start, p)) % p;
+        if (delta % 2 != 0)
+            delta += p;
+        for (std::size_t j = delta / 2; j < SIEVE_WINDOW; j += p)
+            composite[j] = true;
+    }
+
+    for (std::size_t j = 0; j < SIEVE_WINDOW && !cancelled.load(std::memory_order_relaxed); j++)
+    {
+        if (composite[j])
+            continue;
+
+        const std::uint64_t delta = 2 * j;
+        const std::uint64_t candidate_minus_1_mod_e = (start_mod_e + delta + public_exp - 1) % public_exp;
+        if (std::gcd<std::uint64_t, std::uint64_t>(candidate_minus_1_mod_e, public_exp) != 1)
+            continue;
+
+        std::vector<Limb> candidate = add_limbs(start, small_to_limbs(delta));
+        if (compare_limbs(candidate, limit) >= 0)
+            break;
+
+        if (is_probable_prime(candidate, rounds, &cancelled))
+            return candidate;
+    }
+
+    return std::nullopt;
+}
+
+/// @brief Miller-Rabin probable-prime test with base 2 followed by random bases.
+/// @param candidate Odd value greater than 3, least significant limb first.
+/// @param rounds Number of Miller-Rabin rounds.
+/// @param cancelled Optional flag checked between rounds; a cancelled test reports false.
+/// @return True if the candidate passed every round.
+bool KeyGenerator::is_probable_prime(const std::vector<Limb> &candidate, unsigned rounds,
+                                     const std::atomic<bool> *cancelled)
+{
+    const std::vector<Limb> one = {1};
+    const std::vector<Limb> n_minus_1 = subtract_limbs(candidate, one);
+
+    // n - 1 = d * 2^s with d odd.
+    std::vector<Limb> d = n_minus_1, quotient, remainder;
+    unsigned s = 0;
+    while (!d.empty() && d[0] % 2 == 0)
+    {
+        divide_limbs(d, {2}, quotient, remainder);
+        d = std::move(quotient);
+        s++;
+    }
+
+    const LaneModulus modulus(candidate);
+    const ExponentRecoding power(d);
+    const ExponentRecoding square(std::vector<Limb>{2});
+    const std::size_t width = modulus.width();
+
+    // Runs one Miller-Rabin round for every lane; true if all lanes pass.
+    const auto witnesses_pass = [&](std::vector<std::vector<Limb>> lanes) -> bool
+    {
+        mod_exponent_lanes(lanes, power, modulus);
+
+        std::vector<std::vector<Limb>> active;
+        for (std::vector<Limb> &x : lanes)
+        {
+            if (compare_limbs(x, one) != 0 && compare_limbs(x, n_minus_1) != 0)
+                active.push_back(std::move(x));
+        }
+
+        for (unsigned r = 1; r < s && !active.empty(); r++)
+        {
+            mod_exponent_lanes(active, square, modulus);
+
+            std::vector<std::vector<Limb>> still_active;
+            for (std::vector<Limb> &x : active)
+            {
+                if (compare_limbs(x, one) == 0)
+                    return false;
+                if (compare_limbs(x, n_minus_1) != 0)
+                    still_active.push_back(std::move(x));
+            }
+            active = std::move(still_active);
+        }
+
+        return active.empty();
+    };
+
+    std::vector<Limb> base_two = {2};
+    base_two.resize(width, 0);
+    if (!witnesses_pass({base_two}))
+        return false;
+
+    // Remaining bases are uniform in [2, n - 2].
+    const std::vector<Limb> n_minus_3 = subtract_limbs(candidate, {3});
+    for (unsigned done = 1; done < rounds;)
+    {
+        if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+            return false;
+
+        std::vector<std::vector<Limb>> lanes;
+        for (; done < rounds && lanes.size() < MAX_LANES; done++)
+        {
+            divide_limbs(bytes_to_limbs(random_bytes(width * 2 + 8)), n_minus_3, quotient, remainder);
+            std::vector<Limb> base = add_limbs(remainder, {2});
+            base.resize(width, 0);
+            lanes.push_back(std::move(base));
+        }
+
+        if (!witnesses_pass(std::move(lanes)))
+            return false;
+    }
+
+    return true;
+}
+
+/// @brief Number of Miller-Rabin rounds for an error probability below 2^-80.
+/// @param bits Bit length of the candidate.
+/// @return The number of rounds.
+unsigned KeyGenerator::miller_rabin_rounds(unsigned bits)
+{
+    return bits >= 3747 ? 3 : bits >= 1345 ? 4 : bits >= 476 ? 5 : bits >= 400 ? 6 : bits >= 347 ? 7 : bits >= 308 ? 8 : bits >= 55 ? 27 : 34;
+}
@@ -0,0 +1,73 @@
+/// @file keygen.hpp
+/// @brief Declaration of the KeyGenerator class for RSA key generation.
+///
+/// Primes are found by incremental sieving: a random odd starting point is taken, a
+/// window of offsets is sieved against a table of small primes, and the survivors are
+/// tested with Miller-Rabin on the interleaved exponentiation engine. Several independent
+/// windows are searched at once on the work-stealing pool, stopping as soon as enough primes
+/// are found.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "modexp_lanes.hpp"
+#include "keycontext.hpp"
+
+/// @class KeyGenerator
+/// @brief Generates RSA key pairs with CRT parameters.
+class KeyGenerator
+{
+private:
+    unsigned modulus_bits;            ///< Bit length of the generated modulus.
+    std::uint32_t public_exp;         ///< Public exponent e.
+    std::vector<Limb> public_exp_limbs; ///< Public exponent e as limbs.
+    unsigned worker_count;            ///< Number of windows searched at once.
+
+    /// @brief Sieves and tests one window of candidates after a random starting point.
+    /// @param bits Bit length of the prime.
+    /// @param cancelled Set by another search once enough primes are found.
+    /// @return A prime, or nothing if the window held none or the search was cancelled.
+    std::optional<std::vector<Limb>> search_window(unsigned bits, const std::atomic<bool> &cancelled) const;
+
+public:
+    /// @brief Creates a generator for keys of the given size.
+    /// @param bits Bit length of the modulus; even and at least 64.
+    /// @param public_exponent Odd public exponent e, at least 3.
+    /// @param threads Number of windows searched at once; zero uses one per hardware thread.
+    explicit KeyGenerator(unsigned bits, std::uint32_t public_exponent = 65537, unsigned threads = 0);
+
+    /// @brief Generates a new key pair.
+    /// @return A key context with the modulus, both exponents and the CRT parameters.
+    KeyContext generate() const;
+
+    /// @brief Finds a random prime p of exactly the given size with gcd(p - 1, e) = 1.
+    ///
+    /// The two most significant bits are set so that the product of two such primes
+    /// has exactly twice as many bits.
+    /// @param bits Bit length of the prime.
+    /// @return The prime as limbs, least significant first.
+    std::vector<Limb> random_prime(unsigned bits) const;
+
+    /// @brief Finds several distinct random primes concurrently, as random_prime does.
+    /// @param bits Bit length of each prime.
+    /// @param count Number of distinct primes to find.
+    /// @return The primes as limbs, least significant first, in the order they were found.
+    std::vector<std::vector<Limb>> random_primes(unsigned bits, std::size_t count) const;
+
+    /// @brief Miller-Rabin probable-prime test with base 2 followed by random bases.
+    /// @param candidate Odd value greater than 3, least significant limb first.
+    /// @param rounds Number of Miller-Rabin rounds.
+    /// @param cancelled Optional flag checked between rounds; a cancelled test reports false.
+    /// @return True if the candidate passed every round.
+    static bool is_probable_prime(const std::vector<Limb> &candidate, unsigned rounds,
+                                  const std::atomic<bool> *cancelled = nullptr);
+
+    /// @brief Number of Miller-Rabin rounds for an error probability below 2^-80.
+    /// @param bits Bit length of the candidate.
+    /// @return The number of rounds.
+    static unsigned miller_rabin_rounds(unsigned bits);
+};
@@ -0,0 +1,148 @@
+/// @file keyring.cpp
+/// @brief Implementation of the Keyring class.
+///
+/// Lookups and insertions hold a single mutex only for the list and map updates; key
+/// files are loaded outside the lock so a slow load never blocks hits on other keys.
+
+#include "keyring.hpp"
+#include <stdexcept>
+#include <sys/stat.h>
+#include <utility>
+
+/// @brief Whether two identities describe the same file contents.
+/// @param other The other identity.
+/// @return True if every field matches.
+bool Keyring::FileIdentity::operator==(const FileIdentity &other) const
+{
+    return device == other.device && inode == other.inode && modified.tv_sec == other.modified.tv_sec &&
+           modified.tv_nsec == other.modified.tv_nsec && size == other.size;
+}
+
+/// @brief Creates an empty keyring.
+/// @param capacity Maximum number of cached contexts; at least one.
+Keyring::Keyring(std::size_t capacity) : max_entries(capacity)
+{
+    if (max_entries == 0)
+        throw std::invalid_argument("Keyring capacity must be at least one");
+}
+
+/// @brief The process-wide keyring that key files are loaded through.
+/// @return The keyring.
+Keyring &Keyring::shared()
+{
+    static Keyring keyring(SHARED_CAPACITY);
+    return keyring;
+}
+
+/// @brief Moves an entry to the front and returns its handle; the lock must be held.
+/// @param it Iterator into entries.
+/// @return The cached handle.
+KeyHandle Keyring::touch(std::list<Entry>::iterator it)
+{
+    entries.splice(entries.begin(), entries, it);
+    return it->handle;
+}
+
+/// @brief Returns the context for a key file, loading it on a miss.
+/// @param path Path of the key file, also used as the identifier.
+/// @return A handle to the cached context.
+KeyHandle Keyring::get(const std::string &path)
+{
+    struct stat status{};
+    if (stat(path.c_str(), &status) != 0)
+        return std::make_shared<const KeyContext>(KeyContext::load(path)); // Reports why the file cannot be read.
+
+    // Taken before loading: if the file is replaced in between, the entry looks stale and the
+    // next lookup loads it again, instead of the new contents being cached as the old file.
+    const FileIdentity file{status.st_dev, status.st_ino, status.st_mtim, status.st_size};
+    {
+        std::lock_guard<std::mutex> lock(keyring_mutex);
+        const auto it = index.find(path);
+        if (it != index.end() && it->second->file == file)
+            return touch(it->second);
+    }
+
+    return insert(path, file, KeyContext::load(path));
+}
+
+/// @brief Returns a cached context without loading anything.
+/// @param key_id The identifier to look up.
+/// @return A handle to the cached context, or nullptr on a miss.
+KeyHandle Keyring::find(const std::string &key_id)
+{
+    std::lock_guard<std::mutex> lock(keyring_mutex);
+
+    const auto it = index.find(key_id);
+    if (it == index.end())
+        return nullptr;
+    return touch(it->second);
+}
+
+/// @brief Caches a context under an identifier, replacing any previous entry.
+/// @param key_id The identifier to store the context under.
+/// @param context The context to cache.
+/// @return A handle to the cached context.
+KeyHandle Keyring::insert(const std::string &key_id, KeyContext context)
+{
+    return insert(key_id, FileIdentity{}, std::move(context));
+}
+
+/// @brief Caches a context, replacing any previous entry for the identifier.
+/// @param key_id The identifier to store the context under.
+/// @param file Identity of the key file it was loaded from.
+/// @param context The context to cache.
+/// @return A handle to the cached context.
+KeyHandle Keyring::insert(const std::string &key_id, const FileIdentity &file, KeyContext context)
+{
+    KeyHandle handle = std::make_shared<const KeyContext>(std::move(context));
+    std::lock_guard<std::mutex> lock(keyring_mutex);
+
+    const auto it = index.find(key_id);
+    if (it != index.end())
+    {
+        it->second->file = file;
+        it->second->handle = handle;
+        touch(it->second);
+        return handle;
+    }
+
+    entries.push_front(Entry{key_id, file, handle});
+    index.emplace(key_id, entries.begin());
+
+    while (entries.size() > max_entries)
+    {
+        index.erase(entries.back().key_id);
+        entries.pop_back();
+    }
+
+    return handle;
+}
+
+/// @brief Drops a context from the cache; outstanding handles stay valid.
+/// @param key_id The identifier to remove.
+void Keyring::erase(const std::string &key_id)
+{
+    std::lock_guard<std::mutex> lock(keyring_mutex);
+
+    const auto it = index.find(key_id);
+    if (it == index.end())
+        return;
+
+    entries.erase(it->second);
+    index.erase(it);
+}
+
+/// @brief Makes the next get() for a key file load it again, even if it looks unchanged.
+/// @param path Path of the key file.
+void Keyring::invalidate(const std::string &path)
+{
+    erase(path);
+}
+
+/// @brief Number of cached contexts.
+/// @return The current entry count.
+std::size_t Keyring::size() const
+{
+    std::lock_guard<std::mutex> lock(keyring_mutex);
+    return entries.size();
+}
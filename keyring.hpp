@@ -0,0 +1,113 @@
+/// @file keyring.hpp
+/// @brief Declaration of the Keyring class, a thread-safe LRU cache of key contexts.
+///
+/// Services that encrypt for many tenants keep one Keyring and look keys up by
+/// identifier. A context is built (or loaded from its key file) once; later lookups
+/// return the cached handle, so switching keys never repeats the precomputation.
+/// Key files named on the command line, by the daemon and through bn_ctx_new all go
+/// through Keyring::shared(), so a process holds one context per key file. A key file is
+/// recognised by its device, inode, modification time and size as well as its path, so a
+/// file replaced on disk (e.g. a new key renamed over the old one) is loaded again.
+
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include "keycontext.hpp"
+
+/// @class Keyring
+/// @brief A bounded, thread-safe cache of key contexts with least-recently-used eviction.
+class Keyring
+{
+private:
+    /// @brief What identifies the contents of a key file; all zero for contexts not loaded by get().
+    struct FileIdentity
+    {
+        dev_t device = 0;        ///< Device holding the file.
+        ino_t inode = 0;         ///< Inode of the file.
+        timespec modified = {};  ///< Last modification time.
+        off_t size = 0;          ///< File size in bytes.
+
+        /// @brief Whether two identities describe the same file contents.
+        /// @param other The other identity.
+        /// @return True if every field matches.
+        bool operator==(const FileIdentity &other) const;
+    };
+
+    /// @brief A cached context.
+    struct Entry
+    {
+        std::string key_id;   ///< Identifier, the path for key files.
+        FileIdentity file;    ///< Identity of the key file the context was loaded from.
+        KeyHandle handle;     ///< The cached context.
+    };
+
+    std::size_t max_entries;                                                   ///< Maximum number of cached contexts.
+    std::list<Entry> entries;                                                  ///< Cached contexts, most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;         ///< Lookup from identifier into entries.
+    mutable std::mutex keyring_mutex;                                          ///< Guards entries and index.
+
+    /// @brief Moves an entry to the front and returns its handle; the lock must be held.
+    /// @param it Iterator into entries.
+    /// @return The cached handle.
+    KeyHandle touch(std::list<Entry>::iterator it);
+
+    /// @brief Caches a context, replacing any previous entry for the identifier.
+    /// @param key_id The identifier to store the context under.
+    /// @param file Identity of the key file it was loaded from.
+    /// @param context The context to cache.
+    /// @return A handle to the cached context.
+    KeyHandle insert(const std::string &key_id, const FileIdentity &file, KeyContext context);
+
+public:
+    /// @brief Number of contexts the process-wide keyring keeps.
+    static constexpr std::size_t SHARED_CAPACITY = 16;
+
+    /// @brief Creates an empty keyring.
+    /// @param capacity Maximum number of cached contexts; at least one.
+    explicit Keyring(std::size_t capacity);
+
+    /// @brief The process-wide keyring that key files are loaded through.
+    /// @return The keyring, holding up to SHARED_CAPACITY contexts.
+    static Keyring &shared();
+
+    /// @brief Returns the context for a key file, loading it on a miss.
+    ///
+    /// A cached context is only returned while the file still has the device, inode,
+    /// modification time and size it had when it was loaded; otherwise it is loaded again.
+    /// @param path Path of the key file, also used as the identifier.
+    /// @return A handle to the cached context.
+    /// @throws std::runtime_error if the key file cannot be loaded.
+    KeyHandle get(const std::string &path);
+
+    /// @brief Returns a cached context without loading anything.
+    /// @param key_id The identifier to look up.
+    /// @return A handle to the cached context, or nullptr on a miss.
+    KeyHandle find(const std::string &key_id);
+
+    /// @brief Caches a context under an identifier, replacing any previous entry.
+    /// @param key_id The identifier to store the context under.
+    /// @param context The context to cache.
+    /// @return A handle to the cached context.
+    KeyHandle insert(const std::string &key_id, KeyContext context);
+
+    /// @brief Drops a context from the cache; outstanding handles stay valid.
+    /// @param key_id The identifier to remove.
+    void erase(const std::string &key_id);
+
+    /// @brief Makes the next get() for a key file load it again, even if it looks unchanged.
+    ///
+    /// For files rewritten in place within the modification time resolution; a file
+    /// replaced by a rename is noticed without this.
+    /// @param path Path of the key file.
+    void invalidate(const std::string &path);
+
+    /// @brief Number of cached contexts.
+    /// @return The current entry count.
+    std::size_t size() const;
+};
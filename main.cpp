@@ -5,92 +5,447 @@
 /// encrypting and decrypting text using the Bignum class and RSA.
 
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unistd.h>
 #include "bignum.hpp"
+#include "ciphertext_file.hpp"
+#include "daemon.hpp"
+#include "huge_pages.hpp"
+#include "io.hpp"
+#include "keygen.hpp"
+#include "work_stealing.hpp"
+
+/// @brief Reads a stream to its end.
+/// @param in The stream to read.
+/// @return Every remaining byte of the stream.
+static std::string read_all(std::istream &in)
+{
+    std::string data;
+    char chunk[1 << 16];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+        data.append(chunk, static_cast<size_t>(in.gcount()));
+    return data;
+}
+
+/// @brief Parses a line range such as "1000-1200" or "42".
+/// @param range The range text.
+/// @param first Receives the first line number, counting from 1.
+/// @param last Receives the last line number, inclusive.
+/// @return True if the range is well formed and not empty.
+static bool parse_line_range(const std::string &range, size_t &first, size_t &last)
+{
+    const size_t dash = range.find('-');
+    const std::string first_text = range.substr(0, dash);
+    const std::string last_text = dash == std::string::npos ? first_text : range.substr(dash + 1);
+    if (first_text.empty() || last_text.empty() ||
+        first_text.find_first_not_of("0123456789") != std::string::npos ||
+        last_text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    first = std::stoul(first_text);
+    last = std::stoul(last_text);
+    return first >= 1 && first <= last;
+}
+
+/// @brief Tells on standard error which pages the scratch memory got, if huge pages were requested.
+static void report_huge_pages()
+{
+    if (huge_page_mode() != HugePageMode::off)
+        std::cerr << describe(huge_page_report()) << "\n";
+}
+
+/// @brief Opens the destination of a command's output.
+/// @param path Path given with -o, or empty for standard output.
+/// @return A writer for the file or for standard output.
+static std::unique_ptr<BufferedWriter> open_output(const std::string &path)
+{
+    if (path.empty())
+        return std::make_unique<BufferedWriter>(STDOUT_FILENO);
+    return std::make_unique<BufferedWriter>(path);
+}
 
 /// @brief Main function providing encryption and decryption functionality.
 ///
-/// The application supports two commands:
+/// The application supports four commands:
 /// - `e`: Encrypts input text using RSA encryption.
 /// - `d`: Decrypts encrypted text using RSA decryption.
+/// - `k`: Writes a binary key file from decimal n, e, d (and optionally p, q) lines.
+/// - `g`: Generates a new key pair and writes it to a binary key file.
+/// - `E`: Encrypts arbitrary input bytes in hybrid mode (RSA session key, ChaCha20-Poly1305 data).
+/// - `D`: Decrypts a hybrid container written by `E`.
+/// - `serve`: Keeps the key loaded and serves `e`, `d`, `E` and `D` requests on a Unix domain socket.
+///
+/// Options:
+/// - `--key <path>`: Key file to use instead of the compiled-in key (the output file for `k` and `g`).
+/// - `--bits <n>`: Modulus size for `g` (default 2048).
+/// - `--format <text|binary>`: Ciphertext format written by `e` and read by `d` (default text).
+/// - `-i <path>`: Input file for `e`, `d`, `E` and `D`, memory-mapped instead of read from standard input.
+/// - `-o <path>`: Output file for `e`, `d`, `E` and `D` instead of standard output.
+/// - `--index <path>`: Line index written by `e` and read by `d`, recording where each line's ciphertext starts.
+/// - `--socket <path>`: Unix domain socket for `serve` to listen on.
+/// - `--shm <name>`: Shared-memory ring for `serve` to accept requests on as well.
+/// - `--lines <a-b>`: Lines `a` to `b` (or just line `a`) for `d` to decrypt; fast with `--index`.
+/// - `--affinity <none|compact|scatter>`: How worker threads are pinned to CPUs (default none).
+/// - `--huge-pages <off|madvise|hugetlb>`: Pages for scratch memory (default off); what was obtained is reported on standard error.
 ///
 /// @param argc Number of command-line arguments.
 /// @param argv Array of command-line arguments.
 /// @return Exit status of the application.
 int main(int argc, char *argv[])
 {
+    // Error messages are the only stream output; nothing else needs to stay in step with C stdio.
+    std::ios::sync_with_stdio(false);
+
     // Ensure a command is provided.
     if (argc < 2)
     {
-        std::cout << "Error: No command provided" << std::endl;
+        std::cout << "Error: No command provided\n";
         return 0;
     }
 
-    std::string command = argv[1]; ///< Command input: either "e" for encrypt or "d" for decrypt.
-    Bignum bignum; ///< Bignum instance for performing encryption and decryption.
+    std::string command = argv[1];  ///< Command input: "e", "d", "E", "D", "k", "g" or "serve".
+    std::string key_path;           ///< Path given with --key, if any.
+    std::string bits = "2048";      ///< Modulus size given with --bits.
+    std::string format = "text";    ///< Ciphertext format given with --format.
+    std::string input_path;         ///< Input file given with -i, if any.
+    std::string output_path;        ///< Output file given with -o, if any.
+    std::string index_path;         ///< Line index given with --index, if any.
+    std::string line_range;         ///< Lines given with --lines, if any.
+    std::string socket_path;        ///< Socket given with --socket, if any.
+    std::string shm_name;           ///< Shared-memory ring given with --shm, if any.
+    std::string affinity = "none";  ///< Worker placement policy given with --affinity.
+    std::string huge_pages = "off"; ///< Huge page mode given with --huge-pages.
 
-    if (command == "e")
+    for (int i = 2; i < argc; i++)
     {
-        /// @brief Handles encryption of input text.
-
-        std::string to_encrypt, line;
-        while (std::getline(std::cin, line))
+        const std::string option = argv[i];
+        if (option == "--key" && i + 1 < argc)
+            key_path = argv[++i];
+        else if (option.rfind("--key=", 0) == 0)
+            key_path = option.substr(6);
+        else if (option == "--bits" && i + 1 < argc)
+            bits = argv[++i];
+        else if (option.rfind("--bits=", 0) == 0)
+            bits = option.substr(7);
+        else if (option == "--format" && i + 1 < argc)
+            format = argv[++i];
+        else if (option.rfind("--format=", 0) == 0)
+            format = option.substr(9);
+        else if (option == "--index" && i + 1 < argc)
+            index_path = argv[++i];
+        else if (option.rfind("--index=", 0) == 0)
+            index_path = option.substr(8);
+        else if (option == "--lines" && i + 1 < argc)
+            line_range = argv[++i];
+        else if (option.rfind("--lines=", 0) == 0)
+            line_range = option.substr(8);
+        else if (option == "--socket" && i + 1 < argc)
+            socket_path = argv[++i];
+        else if (option.rfind("--socket=", 0) == 0)
+            socket_path = option.substr(9);
+        else if (option == "--shm" && i + 1 < argc)
+            shm_name = argv[++i];
+        else if (option.rfind("--shm=", 0) == 0)
+            shm_name = option.substr(6);
+        else if (option == "--affinity" && i + 1 < argc)
+            affinity = argv[++i];
+        else if (option.rfind("--affinity=", 0) == 0)
+            affinity = option.substr(11);
+        else if (option == "--huge-pages" && i + 1 < argc)
+            huge_pages = argv[++i];
+        else if (option.rfind("--huge-pages=", 0) == 0)
+            huge_pages = option.substr(13);
+        else if (option == "-i" && i + 1 < argc)
+            input_path = argv[++i];
+        else if (option == "-o" && i + 1 < argc)
+            output_path = argv[++i];
+        else
         {
-            to_encrypt += line + "\n";
+            std::cout << "Error: Unsupported option " << option << "\n";
+            return 0;
         }
+    }
+
+    if (format != "text" && format != "binary")
+    {
+        std::cout << "Error: Unsupported format " << format << "\n";
+        return 0;
+    }
+
+    try
+    {
+        // Must be set before the first parallel task starts the worker pool.
+        WorkStealingPool::set_shared_policy(parse_affinity_policy(affinity));
+        set_huge_page_mode(parse_huge_page_mode(huge_pages));
+    }
+    catch (const std::invalid_argument &error)
+    {
+        std::cout << "Error: " << error.what() << "\n";
+        return 0;
+    }
+
+    size_t first_line = 0, last_line = 0; ///< Lines selected with --lines, counting from 1; zero for all.
+    if (!line_range.empty() && !parse_line_range(line_range, first_line, last_line))
+    {
+        std::cout << "Error: Invalid line range " << line_range << "\n";
+        return 0;
+    }
+
+    Bignum bignum; ///< Bignum instance for performing encryption and decryption.
 
-        if (to_encrypt.empty())
+    try
+    {
+        if (command == "g")
         {
-            std::cout << "Error: No text to encrypt" << std::endl;
+            /// @brief Handles generation of a new key pair.
+
+            if (key_path.empty())
+            {
+                std::cout << "Error: No key file given\n";
+                return 0;
+            }
+
+            KeyGenerator(static_cast<unsigned>(std::stoul(bits))).generate().save(key_path);
+            report_huge_pages();
             return 0;
         }
 
-        // Perform encryption and output results.
-        auto encrypted_lines = bignum.large_encrypt(to_encrypt);
-        for (size_t i = 0; i < encrypted_lines.size(); i++)
+        if (command == "k")
         {
-            const auto &encrypted = encrypted_lines[i];
-            std::cout << encrypted.first << "\n"
-                      << encrypted.second << std::endl;
+            /// @brief Handles creation of a binary key file from decimal values.
+
+            if (key_path.empty())
+            {
+                std::cout << "Error: No key file given\n";
+                return 0;
+            }
+
+            std::vector<Bignum> values; ///< n, e, d and optionally p, q.
+            std::string line;
+            while (values.size() < 5 && std::getline(std::cin, line))
+            {
+                if (!line.empty())
+                    values.emplace_back(line);
+            }
+
+            if (values.size() != 3 && values.size() != 5)
+            {
+                std::cout << "Error: Expected n, e, d and optionally p, q\n";
+                return 0;
+            }
+
+            if (values.size() == 3)
+                KeyContext(values[0].to_limbs(), values[1].to_limbs(), values[2].to_limbs()).save(key_path);
+            else
+                KeyContext(values[0].to_limbs(), values[1].to_limbs(), values[2].to_limbs(),
+                           values[3].to_limbs(), values[4].to_limbs())
+                    .save(key_path);
+
+            return 0;
         }
-    }
-    else if (command == "d")
-    {
-        /// @brief Handles decryption of encrypted input text.
 
-        std::vector<std::pair<std::string, std::string>> encrypted_lines; ///< Vector to store encrypted pairs.
-        std::string first, second;
+        if (!key_path.empty())
+            Bignum::load_key(key_path);
 
-        while (std::getline(std::cin, first) && std::getline(std::cin, second))
+        if (command == "serve")
         {
-            encrypted_lines.emplace_back(first, second);
+            /// @brief Handles the long-running daemon mode.
+
+            if (socket_path.empty())
+            {
+                std::cout << "Error: No socket path given\n";
+                return 0;
+            }
+
+            Daemon daemon(socket_path, Bignum::key());
+            if (!shm_name.empty())
+                daemon.add_shared_ring(shm_name, DAEMON_RING_SLOTS, DAEMON_RING_SLOT_BYTES);
+            daemon.run();
+            return 0;
         }
 
-        if (encrypted_lines.empty())
+        if (command != "e" && command != "d" && command != "E" && command != "D")
         {
-            std::cout << "Error: No values to decrypt" << std::endl;
+            /// @brief Handles unsupported commands.
+
+            std::cout << "Error: Unsupported command\n";
             return 0;
         }
 
-        // Perform decryption and output results.
-        size_t i = 0;
-        for (const auto &encrypted : encrypted_lines)
+        // A file named with -i is mapped and read in place; standard input is read into memory.
+        std::unique_ptr<MappedFile> input_file;
+        std::string input_buffer;
+        std::string_view input;
+        if (!input_path.empty())
+        {
+            input_file = std::make_unique<MappedFile>(input_path);
+            input = input_file->view();
+        }
+        else
+        {
+            input_buffer = read_all(std::cin);
+            input = input_buffer;
+        }
+
+        if (command == "e")
         {
-            std::string decrypted = bignum.large_decrypt(encrypted.first, encrypted.second);
-            if (i < encrypted_lines.size() - 1)
-                std::cout << decrypted << "\n";
+            /// @brief Handles encryption of input text.
+
+            if (input.empty())
+            {
+                std::cout << "Error: No text to encrypt\n";
+                return 0;
+            }
+
+            std::vector<std::uint64_t> offsets; ///< Where each line's ciphertext starts, then the total size.
+
+            // Ciphertext is written as each window of blocks is encrypted, never held whole.
+            const KeyHandle rsa_key = Bignum::key();
+            std::unique_ptr<BufferedWriter> out = open_output(output_path);
+
+            if (format == "binary")
+            {
+                std::vector<size_t> line_blocks;
+                bignum.large_encrypt_binary(input, rsa_key, line_blocks, [&out](std::string_view piece)
+                                            { out->write(piece); });
+
+                const std::uint64_t block_width = byte_length(rsa_key->modulus().limbs());
+                offsets.push_back(sizeof(CiphertextHeader));
+                for (const size_t count : line_blocks)
+                    offsets.push_back(offsets.back() + count * block_width);
+            }
             else
-                std::cout << decrypted << std::endl;
-            i += 1;
+            {
+                offsets.push_back(0);
+                bignum.large_encrypt(input, rsa_key, [&out, &offsets](std::string_view encrypted_line)
+                                     {
+                    out->write(encrypted_line);
+                    out->write("\n");
+                    offsets.push_back(offsets.back() + encrypted_line.size() + 1); });
+            }
+            out->flush();
+
+            if (!index_path.empty())
+                save_line_index(index_path, offsets);
+        }
+        else if (command == "d")
+        {
+            /// @brief Handles decryption of encrypted input text.
+
+            // With an index, only the selected lines' ciphertext is read and decrypted.
+            std::vector<std::uint64_t> offsets;
+            if (!index_path.empty())
+            {
+                offsets = load_line_index(index_path, input.size());
+                if (last_line > offsets.size() - 1)
+                    throw std::out_of_range("Line range is past the end of the ciphertext");
+            }
+            const bool seek = first_line > 0 && !offsets.empty();
+
+            // Plaintext is written as each window of blocks is decrypted, never held whole.
+            const KeyHandle rsa_key = Bignum::key();
+            std::unique_ptr<BufferedWriter> out;
+            const auto write_line = [&out](std::string_view decrypted_line)
+            {
+                out->write(decrypted_line);
+                out->write("\n");
+            };
+
+            if (format == "binary")
+            {
+                if (input.empty())
+                {
+                    std::cout << "Error: No values to decrypt\n";
+                    return 0;
+                }
+
+                if (seek)
+                {
+                    out = open_output(output_path);
+                    bignum.large_decrypt_binary(input, offsets[first_line - 1], offsets[last_line],
+                                                static_cast<int>(first_line), rsa_key, write_line);
+                }
+                else if (first_line > 0)
+                {
+                    // Without an index the whole container is decrypted to find line boundaries;
+                    // only the selected lines are kept, and written once the range is known to exist.
+                    std::vector<std::string> selected_lines;
+                    size_t line_num = 0;
+                    bignum.large_decrypt_binary(input, sizeof(CiphertextHeader), input.size(), 1, rsa_key,
+                                                [&](std::string_view decrypted_line)
+                                                {
+                                                    if (++line_num >= first_line && line_num <= last_line)
+                                                        selected_lines.emplace_back(decrypted_line);
+                                                });
+                    if (last_line > line_num)
+                        throw std::out_of_range("Line range is past the end of the ciphertext");
+
+                    out = open_output(output_path);
+                    for (const std::string &decrypted_line : selected_lines)
+                        write_line(decrypted_line);
+                }
+                else
+                {
+                    out = open_output(output_path);
+                    bignum.large_decrypt_binary(input, sizeof(CiphertextHeader), input.size(), 1, rsa_key, write_line);
+                }
+            }
+            else
+            {
+                const std::string_view ciphertext = seek ? input.substr(offsets[first_line - 1], offsets[last_line] - offsets[first_line - 1])
+                                                         : input;
+
+                std::vector<std::string_view> encrypted_lines; ///< Views of the non-empty input lines.
+                for (const std::string_view line : split_lines(ciphertext))
+                {
+                    if (!line.empty())
+                        encrypted_lines.push_back(line);
+                }
+
+                if (encrypted_lines.empty())
+                {
+                    std::cout << "Error: No values to decrypt\n";
+                    return 0;
+                }
+
+                // Without an index the lines are found by scanning, but only the selected ones are decrypted.
+                if (first_line > 0 && !seek)
+                {
+                    if (last_line > encrypted_lines.size())
+                        throw std::out_of_range("Line range is past the end of the ciphertext");
+                    encrypted_lines = std::vector<std::string_view>(encrypted_lines.begin() + (first_line - 1), encrypted_lines.begin() + last_line);
+                }
+
+                out = open_output(output_path);
+                bignum.large_decrypt(encrypted_lines, rsa_key, first_line > 0 ? static_cast<int>(first_line) : 1, write_line);
+            }
+            out->flush();
+        }
+        else
+        {
+            /// @brief Handles hybrid encryption and decryption of binary input.
+
+            if (command == "D" && input.empty())
+            {
+                std::cout << "Error: No data to decrypt\n";
+                return 0;
+            }
+
+            const std::string output = command == "E" ? bignum.hybrid_encrypt(input) : bignum.hybrid_decrypt(input);
+            std::unique_ptr<BufferedWriter> out = open_output(output_path);
+            out->write(output);
+            out->flush();
         }
     }
-    else
+    catch (const std::exception &error)
     {
-        /// @brief Handles unsupported commands.
-
-        std::cout << "Error: Unsupported command" << std::endl;
+        std::cout << "Error: " << error.what() << "\n";
         return 0;
     }
 
+    report_huge_pages();
     return 0;
 }
@@ -0,0 +1,1287 @@
+/// @file modexp_lanes.cpp
+/// @brief Implementation of the interleaved multi-lane modular exponentiation engine.
+///
+/// Residues are stored lane-interleaved ([limb][lane]) so the innermost loop of every
+/// kernel runs across independent lanes. Multiplication uses column-wise product
+/// scanning with 64-bit accumulators, and reduction uses Barrett's method so that
+/// every lane follows the same instruction stream. For very wide moduli the columns of
+/// each product are shared out among the pool workers, which shortens a single
+/// exponentiation when the machine has cores to spare.
+
+#include "modexp_lanes.hpp"
+#include "scratch_arena.hpp"
+#include "work_stealing.hpp"
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+    /// @brief Removes most significant zero limbs.
+    /// @param value Limbs, least significant first.
+    template <typename Vector>
+    void trim_limbs(Vector &value)
+    {
+        while (!value.empty() && value.back() == 0)
+            value.pop_back();
+    }
+
+    /// @brief Residue width in limbs (about 6800 bits) from which one product's columns are
+    /// computed by several pool workers.
+    constexpr std::size_t PARALLEL_COLUMN_LIMBS = 512;
+
+    /// @brief Most workers that share the columns of one product.
+    constexpr std::size_t COLUMN_TEAM_SIZE = 8;
+
+    /// @brief Column ranges per team member, so stealing can even out the uneven column lengths.
+    constexpr std::size_t RANGES_PER_MEMBER = 2;
+
+    /// @brief Computes product columns [first, last) and propagates their carries.
+    ///
+    /// With a scratch buffer, and unless the pool already has a backlog, the column sums are
+    /// first computed in ranges by a team of pool workers; the carries are then propagated
+    /// in order, so the result does not depend on how the columns were split.
+    /// @tparam L Number of lanes.
+    /// @param first First column.
+    /// @param last One past the last column.
+    /// @param carry Carries into the first column; receives the carries out of the last one.
+    /// @param columns Scratch for (last - first) * L column sums, or nullptr to work serially.
+    /// @param column column(c, acc) adds the terms of column c to acc[0..L).
+    /// @param store store(c, l, limb) receives the limb of column c in lane l.
+    template <std::size_t L, typename Column, typename Store>
+    void product_columns(std::size_t first, std::size_t last, std::uint64_t (&carry)[L], std::uint64_t *columns,
+                         const Column &column, const Store &store)
+    {
+        WorkStealingPool &pool = WorkStealingPool::shared();
+        if (columns == nullptr || pool.backlogged())
+        {
+            for (std::size_t c = first; c < last; c++)
+            {
+                std::uint64_t acc[L];
+                for (std::size_t l = 0; l < L; l++)
+                    acc[l] = carry[l];
+                column(c, acc);
+                for (std::size_t l = 0; l < L; l++)
+                {
+                    store(c, l, static_cast<Limb>(acc[l] % LIMB_BASE));
+                    carry[l] = acc[l] / LIMB_BASE;
+                }
+            }
+            return;
+        }
+
+        const std::size_t ranges = std::min(pool.size(), COLUMN_TEAM_SIZE) * RANGES_PER_MEMBER;
+        const std::size_t span = (last - first + ranges - 1) / ranges;
+        TaskGroup team(pool);
+        for (std::size_t begin = first; begin < last; begin += span)
+        {
+            team.run([&, begin]()
+                     {
+                         for (std::size_t c = begin; c < std::min(begin + span, last); c++)
+                         {
+                             std::uint64_t *acc = columns + (c - first) * L;
+                             for (std::size_t l = 0; l < L; l++)
+                                 acc[l] = 0;
+                             column(c, acc);
+                         } });
+        }
+        team.wait();
+
+        for (std::size_t c = first; c < last; c++)
+        {
+            for (std::size_t l = 0; l < L; l++)
+            {
+                const std::uint64_t acc = columns[(c - first) * L + l] + carry[l];
+                store(c, l, static_cast<Limb>(acc % LIMB_BASE));
+                carry[l] = acc / LIMB_BASE;
+            }
+        }
+    }
+
+    /// @brief Computes the full product of two interleaved residues of width k.
+    /// @tparam L Number of lanes.
+    /// @param x First operand, k limbs per lane.
+    /// @param y Second operand, k limbs per lane.
+    /// @param product Receives 2k limbs per lane.
+    /// @param k Residue width in limbs.
+    /// @param columns Column scratch for product_columns, or nullptr.
+    template <std::size_t L>
+    void multiply_lanes(const Limb *x, const Limb *y, Limb *product, std::size_t k, std::uint64_t *columns)
+    {
+        std::uint64_t carry[L] = {};
+        product_columns<L>(
+            0, 2 * k - 1, carry, columns,
+            [&](std::size_t c, std::uint64_t *acc)
+            {
+                const std::size_t i_lo = (c < k) ? 0 : c - k + 1;
+                const std::size_t i_hi = std::min(c, k - 1);
+                for (std::size_t i = i_lo; i <= i_hi; i++)
+                {
+                    const Limb *xi = x + i * L;
+                    const Limb *yj = y + (c - i) * L;
+                    for (std::size_t l = 0; l < L; l++)
+                        acc[l] += static_cast<std::uint64_t>(xi[l]) * yj[l];
+                }
+            },
+            [&](std::size_t c, std::size_t l, Limb limb)
+            { product[c * L + l] = limb; });
+
+        for (std::size_t l = 0; l < L; l++)
+            product[(2 * k - 1) * L + l] = static_cast<Limb>(carry[l]);
+    }
+
+    /// @brief Computes the square of an interleaved residue of width k.
+    /// @tparam L Number of lanes.
+    /// @param x Operand, k limbs per lane.
+    /// @param product Receives 2k limbs per lane.
+    /// @param k Residue width in limbs.
+    /// @param columns Column scratch for product_columns, or nullptr.
+    template <std::size_t L>
+    void square_lanes(const Limb *x, Limb *product, std::size_t k, std::uint64_t *columns)
+    {
+        std::uint64_t carry[L] = {};
+        product_columns<L>(
+            0, 2 * k - 1, carry, columns,
+            [&](std::size_t c, std::uint64_t *acc)
+            {
+                std::uint64_t cross[L] = {};
+                const std::size_t i_lo = (c < k) ? 0 : c - k + 1;
+                for (std::size_t i = i_lo; i < c - i; i++)
+                {
+                    const Limb *xi = x + i * L;
+                    const Limb *xj = x + (c - i) * L;
+                    for (std::size_t l = 0; l < L; l++)
+                        cross[l] += static_cast<std::uint64_t>(xi[l]) * xj[l];
+                }
+
+                for (std::size_t l = 0; l < L; l++)
+                    acc[l] += 2 * cross[l];
+
+                if (c % 2 == 0)
+                {
+                    const Limb *xh = x + (c / 2) * L;
+                    for (std::size_t l = 0; l < L; l++)
+                        acc[l] += static_cast<std::uint64_t>(xh[l]) * xh[l];
+                }
+            },
+            [&](std::size_t c, std::size_t l, Limb limb)
+            { product[c * L + l] = limb; });
+
+        for (std::size_t l = 0; l < L; l++)
+            product[(2 * k - 1) * L + l] = static_cast<Limb>(carry[l]);
+    }
+
+    /// @brief Scratch buffers and constants shared by the kernels of one batch.
+    /// @tparam L Number of lanes.
+    template <std::size_t L>
+    struct LaneWorkspace
+    {
+        const LaneModulus &modulus;        ///< Modulus shared by all lanes.
+        std::size_t k;                     ///< Residue width in limbs.
+        ScratchVector<Limb> product;         ///< Double-width product, 2k limbs per lane.
+        ScratchVector<Limb> quotient;        ///< Barrett quotient estimate.
+        ScratchVector<Limb> low;             ///< Low k+1 limbs of quotient * modulus.
+        ScratchVector<std::uint64_t> columns; ///< Column sums when products are split; empty otherwise.
+
+        explicit LaneWorkspace(const LaneModulus &mod)
+            : modulus(mod), k(mod.width()), product(2 * k * L), quotient(mod.barrett().size() * L),
+              low((k + 1) * L)
+        {
+            if (k >= PARALLEL_COLUMN_LIMBS && WorkStealingPool::shared().size() > 1)
+                columns.resize(std::max(2 * k, mod.barrett().size() + 2) * L);
+        }
+
+        /// @brief Column scratch for product_columns.
+        /// @return The buffer, or nullptr if products are not split.
+        std::uint64_t *column_scratch()
+        {
+            return columns.empty() ? nullptr : columns.data();
+        }
+
+        /// @brief Barrett-reduces the double-width product into an interleaved residue.
+        /// @param result Receives k limbs per lane.
+        void reduce(Limb *result)
+        {
+            const std::vector<Limb> &mu = modulus.barrett();
+            const std::vector<Limb> &m = modulus.limbs();
+            const std::size_t mu_size = mu.size();
+            const Limb *q1 = product.data() + (k - 1) * L; // k + 1 limbs per lane
+
+            // Upper columns of q1 * mu; the skipped low columns only lower the estimate.
+            std::uint64_t carry[L] = {};
+            product_columns<L>(
+                k - 1, k + mu_size, carry, column_scratch(),
+                [&](std::size_t c, std::uint64_t *acc)
+                {
+                    const std::size_t i_lo = (c < mu_size) ? 0 : c - mu_size + 1;
+                    const std::size_t i_hi = std::min(c, k);
+                    for (std::size_t i = i_lo; i <= i_hi; i++)
+                    {
+                        const Limb *a = q1 + i * L;
+                        const Limb b = mu[c - i];
+                        for (std::size_t l = 0; l < L; l++)
+                            acc[l] += static_cast<std::uint64_t>(a[l]) * b;
+                    }
+                },
+                [&](std::size_t c, std::size_t l, Limb limb)
+                {
+                    if (c >= k + 1)
+                        quotient[(c - k - 1) * L + l] = limb;
+                });
+            for (std::size_t l = 0; l < L; l++)
+                quotient[(mu_size - 1) * L + l] = static_cast<Limb>(carry[l]);
+
+            // Low k + 1 limbs of quotient * modulus.
+            for (std::size_t l = 0; l < L; l++)
+                carry[l] = 0;
+            product_columns<L>(
+                0, k + 1, carry, column_scratch(),
+                [&](std::size_t c, std::uint64_t *acc)
+                {
+                    const std::size_t i_hi = std::min(c, mu_size - 1);
+                    for (std::size_t i = (c < k) ? 0 : c - k + 1; i <= i_hi; i++)
+                    {
+                        const Limb *a = quotient.data() + i * L;
+                        const Limb b = m[c - i];
+                        for (std::size_t l = 0; l < L; l++)
+                            acc[l] += static_cast<std::uint64_t>(a[l]) * b;
+                    }
+                },
+                [&](std::size_t c, std::size_t l, Limb limb)
+                { low[c * L + l] = limb; });
+
+            // r = (product - quotient * modulus) mod LIMB_BASE^(k+1), then at most a few
+            // conditional subtractions bring it below the modulus.
+            for (std::size_t l = 0; l < L; l++)
+            {
+                std::int64_t borrow = 0;
+                for (std::size_t i = 0; i <= k; i++)
+                {
+                    const std::int64_t diff = static_cast<std::int64_t>(product[i * L + l]) - low[i * L + l] - borrow;
+                    borrow = diff < 0;
+                    low[i * L + l] = static_cast<Limb>(diff + (borrow ? LIMB_BASE : 0));
+                }
+
+                while (true)
+                {
+                    bool at_least = low[k * L + l] != 0;
+                    if (!at_least)
+                    {
+                        at_least = true;
+                        for (std::size_t i = k; i-- > 0;)
+                        {
+                            if (low[i * L + l] != m[i])
+                            {
+                                at_least = low[i * L + l] > m[i];
+                                break;
+                            }
+                        }
+                    }
+                    if (!at_least)
+                        break;
+
+                    borrow = 0;
+                    for (std::size_t i = 0; i <= k; i++)
+                    {
+                        const std::int64_t sub = (i < k) ? m[i] : 0;
+                        const std::int64_t diff = static_cast<std::int64_t>(low[i * L + l]) - sub - borrow;
+                        borrow = diff < 0;
+                        low[i * L + l] = static_cast<Limb>(diff + (borrow ? LIMB_BASE : 0));
+                    }
+                }
+
+                for (std::size_t i = 0; i < k; i++)
+                    result[i * L + l] = low[i * L + l];
+            }
+        }
+
+        /// @brief result = x * y mod modulus for every lane.
+        void multiply(const Limb *x, const Limb *y, Limb *result)
+        {
+            multiply_lanes<L>(x, y, product.data(), k, column_scratch());
+            reduce(result);
+        }
+
+        /// @brief result = x * x mod modulus for every lane.
+        void square(const Limb *x, Limb *result)
+        {
+            square_lanes<L>(x, product.data(), k, column_scratch());
+            reduce(result);
+        }
+    };
+
+    /// @brief Runs the sliding-window exponentiation for a fixed lane count.
+    ///
+    /// All working buffers come from the thread's scratch arena and are released together.
+    /// @tparam L Number of lanes.
+    template <std::size_t L>
+    void run_lanes(std::vector<std::vector<Limb>> &lanes, const ExponentRecoding &exponent,
+                   const LaneModulus &modulus)
+    {
+        const ScratchArena::Scope scratch;
+        const std::size_t k = modulus.width();
+        const std::size_t stride = k * L;
+        LaneWorkspace<L> workspace(modulus);
+
+        ScratchVector<Limb> acc(stride, 0);
+        const std::vector<ExponentRecoding::Step> &steps = exponent.steps();
+
+        if (steps.empty())
+        {
+            const bool unit_modulus = (k == 1 && modulus.limbs()[0] == 1);
+            for (std::size_t l = 0; l < L; l++)
+                acc[l] = unit_modulus ? 0 : 1;
+        }
+        else
+        {
+            // Odd powers base^1, base^3, ..., base^(2^w - 1), one table entry per stride.
+            const std::size_t entries = std::size_t{1} << (exponent.window_bits() - 1);
+            ScratchVector<Limb> table(entries * stride);
+            for (std::size_t i = 0; i < k; i++)
+                for (std::size_t l = 0; l < L; l++)
+                    table[i * L + l] = lanes[l][i];
+
+            if (entries > 1)
+            {
+                ScratchVector<Limb> base_squared(stride);
+                workspace.square(table.data(), base_squared.data());
+                for (std::size_t e = 1; e < entries; e++)
+                    workspace.multiply(table.data() + (e - 1) * stride, base_squared.data(),
+                                       table.data() + e * stride);
+            }
+
+            ScratchVector<Limb> tmp(stride);
+            std::copy_n(table.data() + (steps[0].digit / 2) * stride, stride, acc.data());
+            for (std::size_t s = 1; s < steps.size(); s++)
+            {
+                for (std::uint32_t i = 0; i < steps[s].squarings; i++)
+                {
+                    workspace.square(acc.data(), tmp.data());
+                    acc.swap(tmp);
+                }
+                if (steps[s].digit != 0)
+                {
+                    workspace.multiply(acc.data(), table.data() + (steps[s].digit / 2) * stride, tmp.data());
+                    acc.swap(tmp);
+                }
+            }
+        }
+
+        for (std::size_t l = 0; l < L; l++)
+            for (std::size_t i = 0; i < k; i++)
+                lanes[l][i] = acc[i * L + l];
+    }
+}
+
+/// @brief Builds the modulus context and computes its Barrett constant.
+/// @param modulus Modulus limbs, least significant first.
+LaneModulus::LaneModulus(std::vector<Limb> modulus) : modulus_limbs(std::move(modulus))
+{
+    trim_limbs(modulus_limbs);
+    if (modulus_limbs.empty())
+        throw std::invalid_argument("Modulus must be non-zero");
+
+    std::vector<Limb> power(2 * modulus_limbs.size() + 1, 0);
+    power.back() = 1;
+
+    std::vector<Limb> remainder;
+    divide_limbs(power, modulus_limbs, barrett_limbs, remainder);
+}
+
+/// @brief Builds the modulus context from a precomputed Barrett constant.
+/// @param modulus Modulus limbs, least significant first.
+/// @param barrett Barrett constant limbs, least significant first.
+LaneModulus::LaneModulus(std::vector<Limb> modulus, std::vector<Limb> barrett)
+    : modulus_limbs(std::move(modulus)), barrett_limbs(std::move(barrett))
+{
+    trim_limbs(modulus_limbs);
+    trim_limbs(barrett_limbs);
+    if (modulus_limbs.empty() || barrett_limbs.empty())
+        throw std::invalid_argument("Modulus must be non-zero");
+}
+
+/// @brief Number of limbs in the modulus.
+/// @return The fixed lane width used for every residue.
+std::size_t LaneModulus::width() const
+{
+    return modulus_limbs.size();
+}
+
+/// @brief Modulus limbs, least significant first.
+/// @return A reference to the modulus limbs.
+const std::vector<Limb> &LaneModulus::limbs() const
+{
+    return modulus_limbs;
+}
+
+/// @brief Barrett constant limbs, least significant first.
+/// @return A reference to the Barrett constant limbs.
+const std::vector<Limb> &LaneModulus::barrett() const
+{
+    return barrett_limbs;
+}
+
+/// @brief Reduces an arbitrary-length value modulo this modulus.
+/// @param value Value limbs, least significant first.
+/// @return The residue, exactly width() limbs long.
+std::vector<Limb> LaneModulus::reduce(const std::vector<Limb> &value) const
+{
+    std::vector<Limb> quotient, remainder;
+    divide_limbs(value, modulus_limbs, quotient, remainder);
+    remainder.resize(modulus_limbs.size(), 0);
+    return remainder;
+}
+
+/// @brief Recodes an exponent given in limb form.
+/// @param exponent Exponent limbs, least significant first.
+ExponentRecoding::ExponentRecoding(const std::vector<Limb> &exponent) : window(1)
+{
+    // Peel 16 bits at a time off the decimal limbs to get the binary expansion.
+    std::vector<Limb> rest = exponent;
+    trim_limbs(rest);
+    std::vector<bool> bits;
+    while (!rest.empty())
+    {
+        std::uint32_t rem = 0;
+        for (std::size_t i = rest.size(); i-- > 0;)
+        {
+            const std::uint32_t curr = rem * LIMB_BASE + rest[i];
+            rest[i] = curr >> 16;
+            rem = curr & 0xFFFF;
+        }
+        trim_limbs(rest);
+        for (int b = 0; b < 16; b++)
+            bits.push_back((rem >> b) & 1);
+    }
+    while (!bits.empty() && !bits.back())
+        bits.pop_back();
+
+    const std::size_t bit_count = bits.size();
+    window = bit_count > 671 ? 6 : bit_count > 239 ? 5 : bit_count > 79 ? 4 : bit_count > 23 ? 3 : 1;
+
+    std::uint32_t pending = 0;
+    for (std::size_t i = bit_count; i-- > 0;)
+    {
+        if (!bits[i])
+        {
+            pending++;
+            continue;
+        }
+
+        std::size_t j = (i + 1 >= window) ? i + 1 - window : 0;
+        while (!bits[j])
+            j++;
+
+        std::uint32_t digit = 0;
+        for (std::size_t b = i + 1; b-- > j;)
+            digit = (digit << 1) | bits[b];
+
+        const std::uint32_t squarings = steps_list.empty() ? 0 : pending + static_cast<std::uint32_t>(i - j + 1);
+        steps_list.push_back({squarings, digit});
+        pending = 0;
+        i = j;
+    }
+    if (pending > 0)
+        steps_list.push_back({pending, 0});
+}
+
+/// @brief Rebuilds a recoding from previously computed steps.
+/// @param window_bits Window width in bits.
+/// @param steps Recoded steps, most significant first.
+ExponentRecoding::ExponentRecoding(unsigned window_bits, std::vector<Step> steps)
+    : window(window_bits), steps_list(std::move(steps))
+{
+}
+
+/// @brief Window width in bits.
+/// @return The number of bits covered by one table lookup.
+unsigned ExponentRecoding::window_bits() const
+{
+    return window;
+}
+
+/// @brief Recoded steps.
+/// @return A reference to the steps, most significant first.
+const std::vector<ExponentRecoding::Step> &ExponentRecoding::steps() const
+{
+    return steps_list;
+}
+
+/// @brief Raises every lane to the same exponent modulo the same modulus.
+/// @param lanes Between one and MAX_LANES residues, each exactly modulus.width() limbs;
+///              overwritten with the results.
+/// @param exponent The recoded exponent shared by all lanes.
+/// @param modulus The modulus shared by all lanes.
+void mod_exponent_lanes(std::vector<std::vector<Limb>> &lanes, const ExponentRecoding &exponent,
+                        const LaneModulus &modulus)
+{
+    switch (lanes.size())
+    {
+    case 1:
+        run_lanes<1>(lanes, exponent, modulus);
+        break;
+    case 2:
+        run_lanes<2>(lanes, exponent, modulus);
+        break;
+    case 3:
+        run_lanes<3>(lanes, exponent, modulus);
+        break;
+    case 4:
+        run_lanes<4>(lanes, exponent, modulus);
+        break;
+    default:
+        throw std::invalid_argument("Lane count must be between 1 and MAX_LANES");
+    }
+}
+
+/// @brief Computes the quotient and remainder of two limb values (Knuth, Algorithm D).
+/// @param dividend Dividend limbs, least significant first.
+/// @param divisor Divisor limbs, least significant first; must be non-zero.
+/// @param quotient Receives the quotient limbs, least significant first.
+/// @param remainder Receives the remainder limbs, least significant first.
+void divide_limbs(const std::vector<Limb> &dividend, const std::vector<Limb> &divisor,
+                  std::vector<Limb> &quotient, std::vector<Limb> &remainder)
+{
+    const ScratchArena::Scope scratch;
+    ScratchVector<Limb> u(dividend.begin(), dividend.end()), v(divisor.begin(), divisor.end());
+    trim_limbs(u);
+    trim_limbs(v);
+    if (v.empty())
+        throw std::invalid_argument("Division by zero");
+
+    const std::size_t n = v.size();
+    quotient.clear();
+    remainder.clear();
+
+    if (u.size() < n)
+    {
+        remainder.assign(u.begin(), u.end());
+        return;
+    }
+
+    if (n == 1)
+    {
+        quotient.assign(u.size(), 0);
+        std::uint64_t rem = 0;
+        for (std::size_t i = u.size(); i-- > 0;)
+        {
+            const std::uint64_t curr = rem * LIMB_BASE + u[i];
+            quotient[i] = static_cast<Limb>(curr / v[0]);
+            rem = curr % v[0];
+        }
+        trim_limbs(quotient);
+        if (rem != 0)
+            remainder.push_back(static_cast<Limb>(rem));
+        return;
+    }
+
+    // Normalise so the divisor's top limb is at least LIMB_BASE / 2.
+    const std::uint64_t scale = LIMB_BASE / (static_cast<std::uint64_t>(v.back()) + 1);
+    const std::size_t m = u.size() - n;
+    ScratchVector<Limb> un(u.size() + 1, 0), vn(n, 0);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < u.size(); i++)
+    {
+        const std::uint64_t curr = u[i] * scale + carry;
+        un[i] = static_cast<Limb>(curr % LIMB_BASE);
+        carry = curr / LIMB_BASE;
+    }
+    un[u.size()] = static_cast<Limb>(carry);
+    carry = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const std::uint64_t curr = v[i] * scale + carry;
+        vn[i] = static_cast<Limb>(curr % LIMB_BASE);
+        carry = curr / LIMB_BASE;
+    }
+
+    quotient.assign(m + 1, 0);
+    for (std::size_t j = m + 1; j-- > 0;)
+    {
+        const std::uint64_t num = static_cast<std::uint64_t>(un[j + n]) * LIMB_BASE + un[j + n - 1];
+        std::uint64_t qhat = num / vn[n - 1];
+        std::uint64_t rhat = num % vn[n - 1];
+        while (qhat >= LIMB_BASE || qhat * vn[n - 2] > rhat * LIMB_BASE + un[j + n - 2])
+        {
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >= LIMB_BASE)
+                break;
+        }
+
+        std::int64_t borrow = 0;
+        carry = 0;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const std::uint64_t p = qhat * vn[i] + carry;
+            carry = p / LIMB_BASE;
+            std::int64_t diff = static_cast<std::int64_t>(un[i + j]) - static_cast<std::int64_t>(p % LIMB_BASE) - borrow;
+            borrow = diff < 0;
+            un[i + j] = static_cast<Limb>(diff + (borrow ? LIMB_BASE : 0));
+        }
+        std::int64_t top = static_cast<std::int64_t>(un[j + n]) - static_cast<std::int64_t>(carry) - borrow;
+
+        if (top < 0)
+        {
+            // qhat was one too large; add the divisor back.
+            qhat--;
+            carry = 0;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const std::uint64_t sum = static_cast<std::uint64_t>(un[i + j]) + vn[i] + carry;
+                un[i + j] = static_cast<Limb>(sum % LIMB_BASE);
+                carry = sum / LIMB_BASE;
+            }
+            top += static_cast<std::int64_t>(carry);
+        }
+        un[j + n] = static_cast<Limb>(top);
+        quotient[j] = static_cast<Limb>(qhat);
+    }
+    trim_limbs(quotient);
+
+    remainder.assign(n, 0);
+    std::uint64_t rem = 0;
+    for (std::size_t i = n; i-- > 0;)
+    {
+        const std::uint64_t curr = rem * LIMB_BASE + un[i];
+        remainder[i] = static_cast<Limb>(curr / scale);
+        rem = curr % scale;
+    }
+    trim_limbs(remainder);
+}
+
+namespace
+{
+    /// @brief Operand size in limbs below which schoolbook multiplication is faster.
+    constexpr std::size_t KARATSUBA_THRESHOLD = 40;
+
+    /// @brief Schoolbook product of two limb values.
+    /// @param x First factor, least significant limb first.
+    /// @param x_size Number of limbs of x.
+    /// @param y Second factor, least significant limb first.
+    /// @param y_size Number of limbs of y.
+    /// @param product Receives the untrimmed product, x_size + y_size limbs.
+    void schoolbook_multiply(const Limb *x, std::size_t x_size, const Limb *y, std::size_t y_size, Limb *product)
+    {
+        std::fill_n(product, x_size + y_size, 0);
+        for (std::size_t i = 0; i < x_size; i++)
+        {
+            if (x[i] == 0)
+                continue;
+
+            std::uint64_t carry = 0;
+            for (std::size_t j = 0; j < y_size; j++)
+            {
+                const std::uint64_t curr = static_cast<std::uint64_t>(x[i]) * y[j] + product[i + j] + carry;
+                product[i + j] = static_cast<Limb>(curr % LIMB_BASE);
+                carry = curr / LIMB_BASE;
+            }
+            product[i + y_size] = static_cast<Limb>(carry);
+        }
+    }
+
+    /// @brief Adds a value into an accumulator that is wide enough to hold the sum.
+    /// @param accumulator Limbs, least significant first.
+    /// @param accumulator_size Number of limbs of the accumulator; limbs of value beyond it must be zero.
+    /// @param value Limbs, least significant first.
+    /// @param value_size Number of limbs of value.
+    void add_into(Limb *accumulator, std::size_t accumulator_size, const Limb *value, std::size_t value_size)
+    {
+        Limb carry = 0;
+        for (std::size_t i = 0; i < accumulator_size && (i < value_size || carry != 0); i++)
+        {
+            const Limb curr = accumulator[i] + (i < value_size ? value[i] : 0) + carry;
+            accumulator[i] = curr % LIMB_BASE;
+            carry = curr / LIMB_BASE;
+        }
+    }
+
+    /// @brief Subtracts a value from an accumulator that is not smaller.
+    /// @param accumulator Limbs, least significant first.
+    /// @param accumulator_size Number of limbs of the accumulator.
+    /// @param value Limbs, least significant first; at most accumulator_size of them.
+    /// @param value_size Number of limbs of value.
+    void subtract_from(Limb *accumulator, std::size_t accumulator_size, const Limb *value, std::size_t value_size)
+    {
+        std::int64_t borrow = 0;
+        for (std::size_t i = 0; i < accumulator_size && (i < value_size || borrow != 0); i++)
+        {
+            const std::int64_t diff = static_cast<std::int64_t>(accumulator[i]) - (i < value_size ? value[i] : 0) - borrow;
+            borrow = diff < 0;
+            accumulator[i] = static_cast<Limb>(diff + (borrow ? LIMB_BASE : 0));
+        }
+    }
+
+    /// @brief Karatsuba product of two limb values.
+    ///
+    /// The low and high half products are written straight into the result; only the
+    /// operand sums and the middle product need scratch, which comes from the thread's arena.
+    /// @param x First factor, least significant limb first.
+    /// @param x_size Number of limbs of x.
+    /// @param y Second factor, least significant limb first.
+    /// @param y_size Number of limbs of y.
+    /// @param product Receives the untrimmed product, x_size + y_size limbs.
+    void karatsuba_multiply(const Limb *x, std::size_t x_size, const Limb *y, std::size_t y_size, Limb *product)
+    {
+        if (x_size < y_size)
+        {
+            std::swap(x, y);
+            std::swap(x_size, y_size);
+        }
+        if (y_size < KARATSUBA_THRESHOLD)
+        {
+            schoolbook_multiply(x, x_size, y, y_size, product);
+            return;
+        }
+
+        const ScratchArena::Scope scratch;
+        const std::size_t half = (x_size + 1) / 2;
+        const std::size_t total = x_size + y_size;
+
+        if (y_size <= half)
+        {
+            // Too unbalanced to split both operands: multiply each half of the longer one.
+            karatsuba_multiply(x, half, y, y_size, product);
+            std::fill(product + half + y_size, product + total, 0);
+            ScratchVector<Limb> high(total - half);
+            karatsuba_multiply(x + half, x_size - half, y, y_size, high.data());
+            add_into(product + half, total - half, high.data(), high.size());
+            return;
+        }
+
+        karatsuba_multiply(x, half, y, half, product);
+        karatsuba_multiply(x + half, x_size - half, y + half, y_size - half, product + 2 * half);
+
+        ScratchVector<Limb> x_sum(half + 1), y_sum(half + 1);
+        std::copy_n(x, half, x_sum.begin());
+        std::copy_n(y, half, y_sum.begin());
+        add_into(x_sum.data(), half + 1, x + half, x_size - half);
+        add_into(y_sum.data(), half + 1, y + half, y_size - half);
+
+        // (x0 + x1)(y0 + y1) - x0 y0 - x1 y1, added in at the middle.
+        ScratchVector<Limb> middle(2 * half + 2);
+        karatsuba_multiply(x_sum.data(), half + 1, y_sum.data(), half + 1, middle.data());
+        subtract_from(middle.data(), middle.size(), product, 2 * half);
+        subtract_from(middle.data(), middle.size(), product + 2 * half, total - 2 * half);
+        add_into(product + half, total - half, middle.data(), middle.size());
+    }
+}
+
+/// @brief Computes the product of two limb values.
+///
+/// Operands wider than KARATSUBA_THRESHOLD limbs are split in half and multiplied with
+/// three half-size products instead of four.
+/// @param x First factor, least significant limb first.
+/// @param y Second factor, least significant limb first.
+/// @return The product, least significant limb first.
+std::vector<Limb> multiply_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y)
+{
+    if (x.empty() || y.empty())
+        return {};
+
+    std::vector<Limb> product(x.size() + y.size());
+    karatsuba_multiply(x.data(), x.size(), y.data(), y.size(), product.data());
+    trim_limbs(product);
+    return product;
+}
+
+/// @brief Computes the sum of two limb values.
+/// @param x First addend, least significant limb first.
+/// @param y Second addend, least significant limb first.
+/// @return The sum, least significant limb first.
+std::vector<Limb> add_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y)
+{
+    std::vector<Limb> sum(std::max(x.size(), y.size()) + 1, 0);
+    Limb carry = 0;
+    for (std::size_t i = 0; i + 1 < sum.size(); i++)
+    {
+        const Limb curr = (i < x.size() ? x[i] : 0) + (i < y.size() ? y[i] : 0) + carry;
+        sum[i] = curr % LIMB_BASE;
+        carry = curr / LIMB_BASE;
+    }
+    sum.back() = carry;
+
+    trim_limbs(sum);
+    return sum;
+}
+
+/// @brief Computes the difference of two limb values.
+/// @param x Minuend, least significant limb first.
+/// @param y Subtrahend, least significant limb first; must not exceed x.
+/// @return The difference, least significant limb first.
+std::vector<Limb> subtract_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y)
+{
+    if (compare_limbs(x, y) < 0)
+        throw std::underflow_error("Limb subtraction would be negative");
+
+    std::vector<Limb> difference(x.size(), 0);
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+        const std::int64_t diff = static_cast<std::int64_t>(x[i]) - (i < y.size() ? y[i] : 0) - borrow;
+        borrow = diff < 0;
+        difference[i] = static_cast<Limb>(diff + (borrow ? LIMB_BASE : 0));
+    }
+
+    trim_limbs(difference);
+    return difference;
+}
+
+/// @brief Compares two limb values.
+/// @param x First value, least significant limb first.
+/// @param y Second value, least significant limb first.
+/// @return Negative, zero or positive as x is less than, equal to or greater than y.
+int compare_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y)
+{
+    std::size_t x_size = x.size(), y_size = y.size();
+    while (x_size > 0 && x[x_size - 1] == 0)
+        x_size--;
+    while (y_size > 0 && y[y_size - 1] == 0)
+        y_size--;
+
+    if (x_size != y_size)
+        return x_size < y_size ? -1 : 1;
+
+    for (std::size_t i = x_size; i-- > 0;)
+        if (x[i] != y[i])
+            return x[i] < y[i] ? -1 : 1;
+
+    return 0;
+}
+
+namespace
+{
+    /// @brief Byte length below which radix conversion uses the quadratic loops.
+    constexpr std::size_t CONVERT_LEAF_BYTES = 64;
+
+    /// @brief Returns 256^(CONVERT_LEAF_BYTES * 2^level) with its Barrett constant.
+    ///
+    /// The powers are squared up on demand and cached per thread, so concurrent callers
+    /// never contend and each size class is computed once.
+    /// @param level Size class of the power.
+    /// @return A reference to the cached power.
+    const LaneModulus &radix_power(std::size_t level)
+    {
+        thread_local std::vector<LaneModulus> powers;
+        if (powers.empty())
+        {
+            std::vector<Limb> leaf = {1};
+            for (std::size_t i = 0; i < CONVERT_LEAF_BYTES; i++)
+                leaf = multiply_limbs(leaf, {256});
+            powers.emplace_back(std::move(leaf));
+        }
+        while (powers.size() <= level)
+            powers.emplace_back(multiply_limbs(powers.back().limbs(), powers.back().limbs()));
+        return powers[level];
+    }
+
+    /// @brief Divides by a cached power using its Barrett constant.
+    /// @param value Dividend, least significant limb first.
+    /// @param power Divisor with its Barrett constant.
+    /// @param quotient Receives the quotient.
+    /// @param remainder Receives the remainder.
+    void divide_by_power(const std::vector<Limb> &value, const LaneModulus &power, std::vector<Limb> &quotient,
+                         std::vector<Limb> &remainder)
+    {
+        const std::size_t k = power.width();
+        if (value.size() > 2 * k)
+        {
+            // Only an oversized top-level value gets here; Barrett needs value < LIMB_BASE^(2k).
+            divide_limbs(value, power.limbs(), quotient, remainder);
+            return;
+        }
+
+        quotient.clear();
+        if (value.size() >= k)
+        {
+            quotient = multiply_limbs(std::vector<Limb>(value.begin() + (k - 1), value.end()), power.barrett());
+            quotient.erase(quotient.begin(), quotient.begin() + std::min(quotient.size(), k + 1));
+        }
+
+        // The estimate is at most two below the true quotient.
+        remainder = subtract_limbs(value, multiply_limbs(quotient, power.limbs()));
+        while (compare_limbs(remainder, power.limbs()) >= 0)
+        {
+            remainder = subtract_limbs(remainder, power.limbs());
+            quotient = add_limbs(quotient, {1});
+        }
+    }
+
+    /// @brief Finds the largest size class strictly shorter than a byte length.
+    /// @param length Byte length greater than CONVERT_LEAF_BYTES.
+    /// @return The size class level.
+    std::size_t split_level(std::size_t length)
+    {
+        std::size_t level = 0;
+        while ((CONVERT_LEAF_BYTES << (level + 1)) < length)
+            level++;
+        return level;
+    }
+
+    /// @brief Converts big-endian bytes to limbs one byte at a time.
+    /// @param first First byte, most significant.
+    /// @param length Number of bytes.
+    /// @return The value as limbs, least significant first.
+    std::vector<Limb> bytes_to_limbs_leaf(const std::uint8_t *first, std::size_t length)
+    {
+        std::vector<Limb> limbs;
+        for (std::size_t i = 0; i < length; i++)
+        {
+            std::uint32_t carry = first[i];
+            for (Limb &limb : limbs)
+            {
+                const std::uint32_t curr = limb * 256 + carry;
+                limb = curr % LIMB_BASE;
+                carry = curr / LIMB_BASE;
+            }
+            while (carry > 0)
+            {
+                limbs.push_back(carry % LIMB_BASE);
+                carry /= LIMB_BASE;
+            }
+        }
+        return limbs;
+    }
+
+    /// @brief Converts big-endian bytes to limbs by splitting at a cached power of 256.
+    /// @param first First byte, most significant.
+    /// @param length Number of bytes.
+    /// @return The value as limbs, least significant first.
+    std::vector<Limb> bytes_to_limbs_split(const std::uint8_t *first, std::size_t length)
+    {
+        if (length <= CONVERT_LEAF_BYTES)
+            return bytes_to_limbs_leaf(first, length);
+
+        const std::size_t level = split_level(length);
+        const std::size_t low_length = CONVERT_LEAF_BYTES << level;
+        const std::size_t high_length = length - low_length;
+
+        return add_limbs(multiply_limbs(bytes_to_limbs_split(first, high_length), radix_power(level).limbs()),
+                         bytes_to_limbs_split(first + high_length, low_length));
+    }
+
+    /// @brief Writes limbs as big-endian bytes one byte at a time.
+    /// @param value The value, least significant limb first; consumed.
+    /// @param first First output byte, most significant.
+    /// @param length Number of output bytes.
+    void limbs_to_bytes_leaf(std::vector<Limb> value, std::uint8_t *first, std::size_t length)
+    {
+        trim_limbs(value);
+        for (std::size_t i = length; i-- > 0 && !value.empty();)
+        {
+            std::uint32_t rem = 0;
+            for (std::size_t j = value.size(); j-- > 0;)
+            {
+                const std::uint32_t curr = rem * LIMB_BASE + value[j];
+                value[j] = curr / 256;
+                rem = curr % 256;
+            }
+            trim_limbs(value);
+            first[i] = static_cast<std::uint8_t>(rem);
+        }
+
+        if (!value.empty())
+            throw std::overflow_error("Value does not fit in the requested byte length");
+    }
+
+    /// @brief Writes limbs as big-endian bytes by dividing by a cached power of 256.
+    /// @param value The value, least significant limb first.
+    /// @param first First output byte, most significant.
+    /// @param length Number of output bytes.
+    void limbs_to_bytes_split(const std::vector<Limb> &value, std::uint8_t *first, std::size_t length)
+    {
+        if (length <= CONVERT_LEAF_BYTES || value.empty())
+        {
+            limbs_to_bytes_leaf(value, first, length);
+            return;
+        }
+
+        const std::size_t level = split_level(length);
+        const std::size_t low_length = CONVERT_LEAF_BYTES << level;
+        const std::size_t high_length = length - low_length;
+
+        std::vector<Limb> quotient, remainder;
+        divide_by_power(value, radix_power(level), quotient, remainder);
+        limbs_to_bytes_split(quotient, first, high_length);
+        limbs_to_bytes_split(remainder, first + high_length, low_length);
+    }
+}
+
+/// @brief Converts a big-endian byte string to limbs.
+///
+/// Long inputs are split at cached powers of 256 and recombined with multiply_limbs, so
+/// the conversion costs a few multiplications rather than one pass per byte.
+/// @param bytes The bytes, most significant first.
+/// @return The value as limbs, least significant first.
+std::vector<Limb> bytes_to_limbs(const std::vector<std::uint8_t> &bytes)
+{
+    std::vector<Limb> limbs = bytes_to_limbs_split(bytes.data(), bytes.size());
+    trim_limbs(limbs);
+    return limbs;
+}
+
+/// @brief Converts limbs to a big-endian byte string of a fixed length.
+///
+/// Long outputs are produced by dividing by cached powers of 256 with Barrett's method
+/// and converting the quotient and remainder independently.
+/// @param limbs The value as limbs, least significant first.
+/// @param length Number of output bytes; the value must fit.
+/// @return The bytes, most significant first, left-padded with zeros.
+std::vector<std::uint8_t> limbs_to_bytes(const std::vector<Limb> &limbs, std::size_t length)
+{
+    std::vector<Limb> value = limbs;
+    trim_limbs(value);
+
+    std::vector<std::uint8_t> bytes(length, 0);
+    limbs_to_bytes_split(value, bytes.data(), length);
+    return bytes;
+}
+
+/// @brief Number of bytes needed to hold a limb value.
+/// @param limbs The value as limbs, least significant first.
+/// @return The minimal big-endian byte length; zero for zero.
+std::size_t byte_length(const std::vector<Limb> &limbs)
+{
+    // LIMB_BASE < 2^14, so every limb needs less than two bytes.
+    const std::vector<std::uint8_t> bytes = limbs_to_bytes(limbs, limbs.size() * 2);
+    const auto first = std::find_if(bytes.begin(), bytes.end(), [](std::uint8_t byte)
+                                    { return byte != 0; });
+    return static_cast<std::size_t>(bytes.end() - first);
+}
+
+namespace
+{
+    /// @brief Limbs that fit in one 64-bit word with room for Lehmer's cofactors.
+    constexpr std::size_t WORD_LIMBS = 4;
+
+    /// @brief A signed multi-limb value used for extended GCD cofactors.
+    struct SignedLimbs
+    {
+        std::vector<Limb> magnitude; ///< Absolute value, least significant first.
+        bool negative = false;       ///< Sign; always false for zero.
+    };
+
+    /// @brief Converts a non-negative word to limbs.
+    /// @param value The word.
+    /// @return Limbs, least significant first.
+    std::vector<Limb> word_to_limbs(std::uint64_t value)
+    {
+        std::vector<Limb> limbs;
+        for (; value > 0; value /= LIMB_BASE)
+            limbs.push_back(static_cast<Limb>(value % LIMB_BASE));
+        return limbs;
+    }
+
+    /// @brief Converts a value of at most WORD_LIMBS limbs to a word.
+    /// @param limbs Limbs, least significant first.
+    /// @param skip Number of low limbs to drop first.
+    /// @return The word.
+    std::uint64_t limbs_to_word(const std::vector<Limb> &limbs, std::size_t skip)
+    {
+        std::uint64_t value = 0;
+        for (std::size_t i = limbs.size(); i-- > skip;)
+            value = value * LIMB_BASE + limbs[i];
+        return value;
+    }
+
+    /// @brief Computes x * a + y * b for signed word multipliers.
+    /// @param a Multiplier of x.
+    /// @param x First value.
+    /// @param b Multiplier of y.
+    /// @param y Second value.
+    /// @return The signed combination.
+    SignedLimbs combine(std::int64_t a, const SignedLimbs &x, std::int64_t b, const SignedLimbs &y)
+    {
+        SignedLimbs first{multiply_limbs(x.magnitude, word_to_limbs(a < 0 ? -static_cast<std::uint64_t>(a) : a)), x.negative != (a < 0)};
+        SignedLimbs second{multiply_limbs(y.magnitude, word_to_limbs(b < 0 ? -static_cast<std::uint64_t>(b) : b)), y.negative != (b < 0)};
+
+        SignedLimbs sum;
+        if (first.negative == second.negative)
+        {
+            sum.magnitude = add_limbs(first.magnitude, second.magnitude);
+            sum.negative = first.negative;
+        }
+        else if (compare_limbs(first.magnitude, second.magnitude) >= 0)
+        {
+            sum.magnitude = subtract_limbs(first.magnitude, second.magnitude);
+            sum.negative = first.negative;
+        }
+        else
+        {
+            sum.magnitude = subtract_limbs(second.magnitude, first.magnitude);
+            sum.negative = second.negative;
+        }
+
+        sum.negative = sum.negative && !sum.magnitude.empty();
+        return sum;
+    }
+
+    /// @brief Reduces (x, y) with Lehmer steps until y fits in a word, tracking cofactors.
+    ///
+    /// On entry x >= y. On return x and y both fit in WORD_LIMBS limbs, gcd(x, y) is
+    /// unchanged and, when cofactors are given, x = s0 * X0 + ..., i.e. the cofactor pair
+    /// (s0, s1) has been transformed by the same matrices as (x, y).
+    /// @param x Larger value; updated in place.
+    /// @param y Smaller value; updated in place.
+    /// @param s0 Cofactor paired with x, or nullptr.
+    /// @param s1 Cofactor paired with y, or nullptr.
+    void lehmer_reduce(std::vector<Limb> &x, std::vector<Limb> &y, SignedLimbs *s0, SignedLimbs *s1)
+    {
+        while (x.size() > WORD_LIMBS)
+        {
+            if (y.empty())
+                return;
+
+            // Leading limbs of both operands at the same alignment.
+            const std::size_t shift = x.size() - WORD_LIMBS;
+            std::int64_t x_hat = static_cast<std::int64_t>(limbs_to_word(x, shift));
+            std::int64_t y_hat = y.size() > shift ? static_cast<std::int64_t>(limbs_to_word(y, shift)) : 0;
+
+            // Knuth, Algorithm L: simulate Euclid on the leading limbs while the quotients agree.
+            std::int64_t a = 1, b = 0, c = 0, d = 1;
+            while (y_hat + c > 0 && y_hat + d > 0 && x_hat + a >= 0 && x_hat + b >= 0)
+            {
+                const std::int64_t q = (x_hat + a) / (y_hat + c);
+                if (q != (x_hat + b) / (y_hat + d))
+                    break;
+
+                std::int64_t t = a - q * c;
+                a = c;
+                c = t;
+                t = b - q * d;
+                b = d;
+                d = t;
+                t = x_hat - q * y_hat;
+                x_hat = y_hat;
+                y_hat = t;
+            }
+
+            if (b == 0)
+            {
+                // The leading limbs could not agree on a quotient; take one full division step.
+                std::vector<Limb> quotient, remainder;
+                divide_limbs(x, y, quotient, remainder);
+                x = std::move(y);
+                y = std::move(remainder);
+
+                if (s0 != nullptr)
+                {
+                    SignedLimbs next = combine(1, *s0, 0, *s1);
+                    const SignedLimbs scaled{multiply_limbs(quotient, s1->magnitude), !s1->negative && !quotient.empty() && !s1->magnitude.empty()};
+                    next = combine(1, next, 1, scaled);
+                    *s0 = std::move(*s1);
+                    *s1 = std::move(next);
+                }
+                continue;
+            }
+
+            const SignedLimbs x_signed{x, false}, y_signed{y, false};
+            x = combine(a, x_signed, b, y_signed).magnitude;
+            y = combine(c, x_signed, d, y_signed).magnitude;
+
+            if (s0 != nullptr)
+            {
+                SignedLimbs next0 = combine(a, *s0, b, *s1);
+                SignedLimbs next1 = combine(c, *s0, d, *s1);
+                *s0 = std::move(next0);
+                *s1 = std::move(next1);
+            }
+        }
+
+        if (!y.empty() && compare_limbs(x, y) < 0)
+        {
+            std::swap(x, y);
+            if (s0 != nullptr)
+                std::swap(*s0, *s1);
+        }
+    }
+
+    /// @brief Binary GCD of two words (Stein's algorithm).
+    /// @param x First word.
+    /// @param y Second word.
+    /// @return gcd(x, y).
+    std::uint64_t binary_gcd(std::uint64_t x, std::uint64_t y)
+    {
+        if (x == 0)
+            return y;
+        if (y == 0)
+            return x;
+
+        const int shift = __builtin_ctzll(x | y);
+        x >>= __builtin_ctzll(x);
+        while (y != 0)
+        {
+            y >>= __builtin_ctzll(y);
+            if (x > y)
+                std::swap(x, y);
+            y -= x;
+        }
+        return x << shift;
+    }
+}
+
+/// @brief Computes the greatest common divisor of two limb values.
+/// @param x First value, least significant limb first.
+/// @param y Second value, least significant limb first.
+/// @return gcd(x, y), least significant limb first.
+std::vector<Limb> gcd_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y)
+{
+    std::vector<Limb> a = x, b = y;
+    trim_limbs(a);
+    trim_limbs(b);
+    if (compare_limbs(a, b) < 0)
+        std::swap(a, b);
+
+    lehmer_reduce(a, b, nullptr, nullptr);
+    if (b.empty())
+        return a;
+
+    // Both operands now fit in a word.
+    return word_to_limbs(binary_gcd(limbs_to_word(a, 0), limbs_to_word(b, 0)));
+}
+
+/// @brief Computes a modular inverse with Lehmer's extended GCD.
+/// @param value The value to invert, least significant limb first.
+/// @param modulus The modulus, least significant limb first; must be greater than one.
+/// @return value^-1 mod modulus, least significant limb first.
+std::vector<Limb> inverse_limbs(const std::vector<Limb> &value, const std::vector<Limb> &modulus)
+{
+    std::vector<Limb> quotient, a = modulus, b;
+    trim_limbs(a);
+    if (compare_limbs(a, {1}) <= 0)
+        throw std::invalid_argument("Modulus must be greater than one");
+    divide_limbs(value, a, quotient, b);
+
+    // Invariant: a = s0 * value (mod modulus) and b = s1 * value (mod modulus).
+    SignedLimbs s0, s1{{1}, false};
+    lehmer_reduce(a, b, &s0, &s1);
+    if (a.size() > WORD_LIMBS)
+        throw std::invalid_argument("Value is not invertible modulo the modulus");
+
+    // Word-size extended Euclid; its cofactor matrix entries are bounded by a.
+    std::int64_t x = static_cast<std::int64_t>(limbs_to_word(a, 0));
+    std::int64_t y = static_cast<std::int64_t>(limbs_to_word(b, 0));
+    std::int64_t m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+    while (y != 0)
+    {
+        const std::int64_t q = x / y;
+        std::int64_t t = x - q * y;
+        x = y;
+        y = t;
+        t = m00 - q * m10;
+        m00 = m10;
+        m10 = t;
+        t = m01 - q * m11;
+        m01 = m11;
+        m11 = t;
+    }
+
+    if (x != 1)
+        throw std::invalid_argument("Value is not invertible modulo the modulus");
+
+    const SignedLimbs inverse = combine(m00, s0, m01, s1);
+    std::vector<Limb> remainder;
+    divide_limbs(inverse.magnitude, modulus, quotient, remainder);
+    if (inverse.negative && !remainder.empty())
+        remainder = subtract_limbs(modulus, remainder);
+    return remainder;
+}
@@ -0,0 +1,170 @@
+/// @file modexp_lanes.hpp
+/// @brief Declaration of the interleaved multi-lane modular exponentiation engine.
+///
+/// This header declares the fixed-width limb types used by the batch exponentiation
+/// path of the Bignum class. Up to MAX_LANES independent exponentiations that share
+/// an exponent and a modulus are computed together, with their limb loops interleaved
+/// so that the carry chains of one lane overlap with the multiplies of the others.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief A single limb holding LIMB_DIGITS decimal digits.
+using Limb = std::uint32_t;
+
+/// @brief Radix of a limb; a power of ten so limbs map directly onto Bignum digits.
+constexpr Limb LIMB_BASE = 10000;
+
+/// @brief Number of decimal digits stored in one limb.
+constexpr std::size_t LIMB_DIGITS = 4;
+
+/// @brief Maximum number of exponentiations interleaved in one batch.
+constexpr std::size_t MAX_LANES = 4;
+
+/// @class LaneModulus
+/// @brief A modulus in little-endian limb form together with its Barrett constant.
+class LaneModulus
+{
+private:
+    std::vector<Limb> modulus_limbs; ///< Modulus limbs, least significant first, no leading zero limbs.
+    std::vector<Limb> barrett_limbs; ///< floor(LIMB_BASE^(2k) / modulus), least significant first.
+
+public:
+    /// @brief Builds the modulus context and computes its Barrett constant.
+    /// @param modulus Modulus limbs, least significant first.
+    explicit LaneModulus(std::vector<Limb> modulus);
+
+    /// @brief Builds the modulus context from a precomputed Barrett constant.
+    /// @param modulus Modulus limbs, least significant first.
+    /// @param barrett Barrett constant limbs, least significant first.
+    LaneModulus(std::vector<Limb> modulus, std::vector<Limb> barrett);
+
+    /// @brief Number of limbs in the modulus.
+    /// @return The fixed lane width used for every residue.
+    std::size_t width() const;
+
+    /// @brief Modulus limbs, least significant first.
+    /// @return A reference to the modulus limbs.
+    const std::vector<Limb> &limbs() const;
+
+    /// @brief Barrett constant limbs, least significant first.
+    /// @return A reference to the Barrett constant limbs.
+    const std::vector<Limb> &barrett() const;
+
+    /// @brief Reduces an arbitrary-length value modulo this modulus.
+    /// @param value Value limbs, least significant first.
+    /// @return The residue, exactly width() limbs long.
+    std::vector<Limb> reduce(const std::vector<Limb> &value) const;
+};
+
+/// @class ExponentRecoding
+/// @brief Left-to-right sliding-window recoding of an exponent.
+///
+/// Each step squares the accumulator a number of times and then multiplies by an odd
+/// power of the base (or by nothing when the digit is zero).
+class ExponentRecoding
+{
+public:
+    /// @brief A single step of the recoded exponent.
+    struct Step
+    {
+        std::uint32_t squarings; ///< Squarings performed before the multiply.
+        std::uint32_t digit;     ///< Odd window value to multiply by, or zero.
+    };
+
+private:
+    unsigned window; ///< Window width in bits.
+    std::vector<Step> steps_list; ///< Recoded steps, most significant first.
+
+public:
+    /// @brief Recodes an exponent given in limb form.
+    /// @param exponent Exponent limbs, least significant first.
+    explicit ExponentRecoding(const std::vector<Limb> &exponent);
+
+    /// @brief Rebuilds a recoding from previously computed steps.
+    /// @param window_bits Window width in bits.
+    /// @param steps Recoded steps, most significant first.
+    ExponentRecoding(unsigned window_bits, std::vector<Step> steps);
+
+    /// @brief Window width in bits.
+    /// @return The number of bits covered by one table lookup.
+    unsigned window_bits() const;
+
+    /// @brief Recoded steps.
+    /// @return A reference to the steps, most significant first.
+    const std::vector<Step> &steps() const;
+};
+
+/// @brief Raises every lane to the same exponent modulo the same modulus.
+/// @param lanes Between one and MAX_LANES residues, each exactly modulus.width() limbs;
+///              overwritten with the results.
+/// @param exponent The recoded exponent shared by all lanes.
+/// @param modulus The modulus shared by all lanes.
+void mod_exponent_lanes(std::vector<std::vector<Limb>> &lanes, const ExponentRecoding &exponent,
+                        const LaneModulus &modulus);
+
+/// @brief Computes the quotient and remainder of two limb values.
+/// @param dividend Dividend limbs, least significant first.
+/// @param divisor Divisor limbs, least significant first; must be non-zero.
+/// @param quotient Receives the quotient limbs, least significant first.
+/// @param remainder Receives the remainder limbs, least significant first.
+void divide_limbs(const std::vector<Limb> &dividend, const std::vector<Limb> &divisor,
+                  std::vector<Limb> &quotient, std::vector<Limb> &remainder);
+
+/// @brief Computes the product of two limb values.
+/// @param x First factor, least significant limb first.
+/// @param y Second factor, least significant limb first.
+/// @return The product, least significant limb first.
+std::vector<Limb> multiply_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y);
+
+/// @brief Computes the sum of two limb values.
+/// @param x First addend, least significant limb first.
+/// @param y Second addend, least significant limb first.
+/// @return The sum, least significant limb first.
+std::vector<Limb> add_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y);
+
+/// @brief Computes the difference of two limb values.
+/// @param x Minuend, least significant limb first.
+/// @param y Subtrahend, least significant limb first; must not exceed x.
+/// @return The difference, least significant limb first.
+std::vector<Limb> subtract_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y);
+
+/// @brief Compares two limb values.
+/// @param x First value, least significant limb first.
+/// @param y Second value, least significant limb first.
+/// @return Negative, zero or positive as x is less than, equal to or greater than y.
+int compare_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y);
+
+/// @brief Converts a big-endian byte string to limbs.
+/// @param bytes The bytes, most significant first.
+/// @return The value as limbs, least significant first.
+std::vector<Limb> bytes_to_limbs(const std::vector<std::uint8_t> &bytes);
+
+/// @brief Converts limbs to a big-endian byte string of a fixed length.
+/// @param limbs The value as limbs, least significant first.
+/// @param length Number of output bytes; the value must fit.
+/// @return The bytes, most significant first, left-padded with zeros.
+std::vector<std::uint8_t> limbs_to_bytes(const std::vector<Limb> &limbs, std::size_t length);
+
+/// @brief Number of bytes needed to hold a limb value.
+/// @param limbs The value as limbs, least significant first.
+/// @return The minimal big-endian byte length; zero for zero.
+std::size_t byte_length(const std::vector<Limb> &limbs);
+
+/// @brief Computes the greatest common divisor of two limb values.
+///
+/// Uses Lehmer's algorithm on the leading limbs while the operands are wider than a
+/// machine word, then finishes with a word-size binary GCD.
+/// @param x First value, least significant limb first.
+/// @param y Second value, least significant limb first.
+/// @return gcd(x, y), least significant limb first.
+std::vector<Limb> gcd_limbs(const std::vector<Limb> &x, const std::vector<Limb> &y);
+
+/// @brief Computes a modular inverse with Lehmer's extended GCD.
+/// @param value The value to invert, least significant limb first.
+/// @param modulus The modulus, least significant limb first; must be greater than one.
+/// @return value^-1 mod modulus, least significant limb first.
+std::vector<Limb> inverse_limbs(const std::vector<Limb> &value, const std::vector<Limb> &modulus);
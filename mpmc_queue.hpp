@@ -0,0 +1,122 @@
+/// @file mpmc_queue.hpp
+/// @brief A bounded lock-free multi-producer, multi-consumer queue.
+///
+/// The queue is Dmitry Vyukov's bounded MPMC ring. Every cell carries a sequence number
+/// that says whose turn it is: a producer may fill the cell at position pos once its
+/// sequence equals pos, and a consumer may empty it once the sequence equals pos + 1.
+/// Producers and consumers each claim positions with a single compare-and-swap on their own
+/// counter, so they never contend with one another, and no operation ever blocks.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/// @class MpmcQueue
+/// @brief Bounded lock-free FIFO queue safe for any number of producers and consumers.
+/// @tparam T Element type; must be default-constructible and move-assignable.
+template <typename T>
+class MpmcQueue
+{
+private:
+    /// @brief One slot of the ring, on its own cache line.
+    struct alignas(64) Cell
+    {
+        std::atomic<std::size_t> sequence; ///< Position the cell is ready for; see the file comment.
+        T value;                           ///< The element, while the cell is full.
+    };
+
+    std::unique_ptr<Cell[]> cells; ///< The ring.
+    std::size_t mask;              ///< Capacity minus one.
+
+    alignas(64) std::atomic<std::size_t> enqueue_pos{0}; ///< Next position to fill.
+    alignas(64) std::atomic<std::size_t> dequeue_pos{0}; ///< Next position to empty.
+
+    /// @brief Checks a requested capacity.
+    /// @param capacity The capacity.
+    /// @return The capacity.
+    /// @throws std::invalid_argument if it is not a power of two of at least 2.
+    static std::size_t checked_capacity(std::size_t capacity)
+    {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("Queue capacity must be a power of two");
+        return capacity;
+    }
+
+public:
+    /// @brief Creates an empty queue.
+    /// @param capacity Number of elements it can hold; a power of two, at least 2.
+    /// @throws std::invalid_argument if the capacity is not a power of two.
+    explicit MpmcQueue(std::size_t capacity) : cells(new Cell[checked_capacity(capacity)]), mask(capacity - 1)
+    {
+        for (std::size_t i = 0; i < capacity; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    /// @brief Appends an element unless the queue is full.
+    /// @param value The element; moved from only on success.
+    /// @return False if the queue was full.
+    bool try_push(T &value)
+    {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[pos & mask];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+            if (lag == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+                return false; // The cell still holds the element from one lap ago.
+            else
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Removes the oldest element unless the queue is empty.
+    /// @param value Receives the element.
+    /// @return False if the queue was empty.
+    bool try_pop(T &value)
+    {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[pos & mask];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if (lag == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+                return false; // Nothing has been written here yet.
+            else
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Maximum number of elements.
+    /// @return The capacity.
+    std::size_t capacity() const { return mask + 1; }
+};
@@ -0,0 +1,180 @@
+/// @file numa.cpp
+/// @brief Implementation of the CPU and NUMA topology helpers used to place worker threads.
+
+#include "numa.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+    /// @brief Parses a sysfs CPU list such as "0-15,32-47".
+    /// @param list The list.
+    /// @return The CPU numbers, ascending.
+    std::vector<unsigned> parse_cpu_list(const std::string &list)
+    {
+        std::vector<unsigned> cpus;
+        size_t pos = 0;
+        while (pos < list.size())
+        {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            const std::string range = list.substr(pos, end - pos);
+            pos = end + 1;
+
+            const size_t dash = range.find('-');
+            try
+            {
+                const unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                const unsigned last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+                for (unsigned cpu = first; cpu <= last; cpu++)
+                    cpus.push_back(cpu);
+            }
+            catch (const std::exception &)
+            {
+                // Blank or malformed entries are skipped.
+            }
+        }
+        std::sort(cpus.begin(), cpus.end());
+        return cpus;
+    }
+
+    /// @brief Reads the first line of a file.
+    /// @param path The file.
+    /// @return The line, or an empty string if the file cannot be read.
+    std::string read_line(const std::string &path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+}
+
+/// @brief Parses an affinity policy name.
+/// @param name "none", "compact" or "scatter".
+/// @return The policy.
+/// @throws std::invalid_argument if the name is unknown.
+AffinityPolicy parse_affinity_policy(const std::string &name)
+{
+    if (name == "none")
+        return AffinityPolicy::none;
+    if (name == "compact")
+        return AffinityPolicy::compact;
+    if (name == "scatter")
+        return AffinityPolicy::scatter;
+    throw std::invalid_argument("Unsupported affinity policy " + name);
+}
+
+/// @brief Reads the topology of the running host.
+NumaTopology::NumaTopology()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_mask = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    const auto usable = [&](unsigned cpu)
+    { return !have_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+
+    for (const unsigned node : parse_cpu_list(read_line("/sys/devices/system/node/online")))
+    {
+        std::vector<unsigned> cpus = parse_cpu_list(read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](unsigned cpu)
+                                  { return !usable(cpu); }),
+                   cpus.end());
+        if (!cpus.empty())
+            node_cpus.push_back(std::move(cpus));
+    }
+
+    // Without sysfs NUMA information, every allowed CPU is on one node.
+    if (node_cpus.empty())
+    {
+        std::vector<unsigned> cpus;
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (have_mask && CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        }
+        node_cpus.push_back(std::move(cpus));
+    }
+
+    for (size_t node = 0; node < node_cpus.size(); node++)
+    {
+        for (const unsigned cpu : node_cpus[node])
+        {
+            if (cpu >= cpu_nodes.size())
+                cpu_nodes.resize(cpu + 1, -1);
+            cpu_nodes[cpu] = static_cast<int>(node);
+        }
+    }
+}
+
+/// @brief The topology of the running host, read once.
+/// @return The topology.
+const NumaTopology &NumaTopology::system()
+{
+    static const NumaTopology topology;
+    return topology;
+}
+
+/// @brief Node of a CPU.
+/// @param cpu CPU number.
+/// @return The node index; 0 for CPUs the topology does not know.
+size_t NumaTopology::node_of(unsigned cpu) const
+{
+    return cpu < cpu_nodes.size() && cpu_nodes[cpu] >= 0 ? static_cast<size_t>(cpu_nodes[cpu]) : 0;
+}
+
+/// @brief Node the calling thread is running on right now.
+/// @return The node index.
+size_t NumaTopology::current_node() const
+{
+    if (node_cpus.size() == 1)
+        return 0;
+    const int cpu = ::sched_getcpu();
+    return cpu < 0 ? 0 : node_of(static_cast<unsigned>(cpu));
+}
+
+/// @brief Chooses a CPU for each worker.
+/// @param policy The placement policy.
+/// @param worker_count Number of workers.
+/// @return One CPU number per worker, or -1 for workers that are not to be pinned.
+std::vector<int> NumaTopology::placement(AffinityPolicy policy, size_t worker_count) const
+{
+    std::vector<int> cpus(worker_count, -1);
+    if (policy == AffinityPolicy::none || node_cpus.front().empty())
+        return cpus;
+
+    if (policy == AffinityPolicy::compact)
+    {
+        std::vector<unsigned> ordered;
+        for (const std::vector<unsigned> &node : node_cpus)
+            ordered.insert(ordered.end(), node.begin(), node.end());
+        for (size_t i = 0; i < worker_count; i++)
+            cpus[i] = static_cast<int>(ordered[i % ordered.size()]);
+        return cpus;
+    }
+
+    // Scatter: worker i goes to node i mod N, taking that node's CPUs in turn.
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        const std::vector<unsigned> &node = node_cpus[i % node_cpus.size()];
+        cpus[i] = static_cast<int>(node[(i / node_cpus.size()) % node.size()]);
+    }
+    return cpus;
+}
+
+/// @brief Pins the calling thread to one CPU.
+/// @param cpu CPU number.
+/// @return False if the system refused.
+bool pin_current_thread(unsigned cpu)
+{
+    if (cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
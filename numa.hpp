@@ -0,0 +1,72 @@
+/// @file numa.hpp
+/// @brief Declaration of the CPU and NUMA topology helpers used to place worker threads.
+///
+/// The topology is read from sysfs (/sys/devices/system/node) and restricted to the CPUs the
+/// process may run on. Hosts without NUMA information are treated as a single node holding
+/// every allowed CPU, so the helpers are always safe to call.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief How worker threads are pinned to CPUs.
+enum class AffinityPolicy
+{
+    none,    ///< Not pinned; the scheduler may move workers between CPUs and nodes.
+    compact, ///< Pinned to consecutive CPUs, filling one node before using the next.
+    scatter  ///< Pinned round-robin across nodes, so every node's memory bandwidth is used.
+};
+
+/// @brief Parses an affinity policy name.
+/// @param name "none", "compact" or "scatter".
+/// @return The policy.
+/// @throws std::invalid_argument if the name is unknown.
+AffinityPolicy parse_affinity_policy(const std::string &name);
+
+/// @class NumaTopology
+/// @brief The NUMA nodes of the host and the CPUs of each one that this process may use.
+class NumaTopology
+{
+private:
+    std::vector<std::vector<unsigned>> node_cpus; ///< Allowed CPUs of every node that has any.
+    std::vector<int> cpu_nodes;                   ///< Node index of every CPU number, or -1.
+
+    /// @brief Reads the topology of the running host.
+    NumaTopology();
+
+public:
+    /// @brief The topology of the running host, read once.
+    /// @return The topology.
+    static const NumaTopology &system();
+
+    /// @brief Number of nodes with at least one allowed CPU.
+    /// @return The node count, at least 1.
+    std::size_t node_count() const { return node_cpus.size(); }
+
+    /// @brief Allowed CPUs of a node.
+    /// @param node Node index, below node_count().
+    /// @return The CPU numbers.
+    const std::vector<unsigned> &cpus(std::size_t node) const { return node_cpus[node]; }
+
+    /// @brief Node of a CPU.
+    /// @param cpu CPU number.
+    /// @return The node index; 0 for CPUs the topology does not know.
+    std::size_t node_of(unsigned cpu) const;
+
+    /// @brief Node the calling thread is running on right now.
+    /// @return The node index.
+    std::size_t current_node() const;
+
+    /// @brief Chooses a CPU for each worker.
+    /// @param policy The placement policy.
+    /// @param worker_count Number of workers.
+    /// @return One CPU number per worker, or -1 for workers that are not to be pinned.
+    std::vector<int> placement(AffinityPolicy policy, std::size_t worker_count) const;
+};
+
+/// @brief Pins the calling thread to one CPU.
+/// @param cpu CPU number.
+/// @return False if the system refused.
+bool pin_current_thread(unsigned cpu);
@@ -0,0 +1,48 @@
+/// @file scratch_arena.cpp
+/// @brief Implementation of the per-thread bump arena that supplies arithmetic scratch space.
+
+#include "scratch_arena.hpp"
+#include <algorithm>
+
+/// @brief The calling thread's arena.
+/// @return The arena.
+ScratchArena &ScratchArena::local()
+{
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+/// @brief Moves to the next chunk that can hold an allocation, adding one if needed.
+///
+/// Chunks after the current one are free. The first of them is reused if it is big enough;
+/// otherwise a new chunk is inserted in front of it, so the chunks that open scopes point
+/// into keep their indices.
+/// @param bytes Size of the allocation.
+/// @param alignment Required alignment; a power of two.
+/// @return The allocated memory.
+void *ScratchArena::allocate_slow(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t next = chunks.empty() ? 0 : current + 1;
+    const std::size_t needed = bytes + alignment;
+    if (next >= chunks.size() || chunks[next].size() < needed)
+    {
+        // Doubling keeps the chunk count logarithmic in the largest working set.
+        const std::size_t smallest = huge_page_mode() == HugePageMode::off ? MIN_CHUNK_BYTES : HUGE_PAGE_BYTES;
+        const std::size_t size = std::max({smallest, needed, chunks.empty() ? 0 : 2 * chunks.back().size()});
+        chunks.insert(chunks.begin() + next, PageBlock(size));
+    }
+
+    current = next;
+    offset = 0;
+    return allocate(bytes, alignment);
+}
+
+/// @brief Total size of the chunks the arena holds.
+/// @return The size in bytes.
+std::size_t ScratchArena::capacity() const
+{
+    std::size_t total = 0;
+    for (const PageBlock &chunk : chunks)
+        total += chunk.size();
+    return total;
+}
@@ -0,0 +1,152 @@
+/// @file scratch_arena.hpp
+/// @brief Declaration of the per-thread bump arena that supplies arithmetic scratch space.
+///
+/// Every thread owns one ScratchArena. Allocation bumps an offset inside a chunk and freeing
+/// is a no-op; a ScratchArena::Scope remembers the offset when it opens and puts it back when
+/// it closes, releasing everything allocated in between at once. Scopes nest, so a kernel can
+/// open its own scope inside a caller's. Chunks are kept for the life of the thread, so once a
+/// thread has seen its largest operation it no longer calls malloc for scratch at all. Chunks
+/// are PageBlocks, so with huge pages enabled (see huge_pages.hpp) the scratch of a worker sits
+/// in a few 2 MiB pages.
+///
+/// Containers use the arena through ArenaAllocator, a standard allocator, most simply as a
+/// ScratchVector. Such a container must not outlive the scope it was filled in, must only
+/// grow on the thread that created it, and is never handed to code that keeps it.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "huge_pages.hpp"
+
+/// @class ScratchArena
+/// @brief A chunked bump allocator for short-lived buffers of one thread.
+class ScratchArena
+{
+private:
+    std::vector<PageBlock> chunks; ///< Chunks in use order; those after current are free.
+    std::size_t current = 0;       ///< Chunk being carved from.
+    std::size_t offset = 0;        ///< Bytes of the current chunk already handed out.
+
+    /// @brief Moves to the next chunk that can hold an allocation, adding one if needed.
+    /// @param bytes Size of the allocation.
+    /// @param alignment Required alignment; a power of two.
+    /// @return The allocated memory.
+    void *allocate_slow(std::size_t bytes, std::size_t alignment);
+
+public:
+    /// @brief Smallest chunk the arena allocates with normal pages; with huge pages it is one huge page.
+    static constexpr std::size_t MIN_CHUNK_BYTES = 64 * 1024;
+
+    /// @class Scope
+    /// @brief Releases everything allocated from an arena while it was open.
+    class Scope
+    {
+    private:
+        ScratchArena &arena; ///< The arena.
+        std::size_t chunk;   ///< Chunk index when the scope opened.
+        std::size_t offset;  ///< Chunk offset when the scope opened.
+
+    public:
+        /// @brief Opens a scope.
+        /// @param scope_arena The arena; the calling thread's by default.
+        explicit Scope(ScratchArena &scope_arena = ScratchArena::local())
+            : arena(scope_arena), chunk(scope_arena.current), offset(scope_arena.offset)
+        {
+        }
+
+        /// @brief Closes the scope, rewinding the arena in constant time.
+        ~Scope()
+        {
+            arena.current = chunk;
+            arena.offset = offset;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    /// @brief The calling thread's arena.
+    /// @return The arena.
+    static ScratchArena &local();
+
+    /// @brief Allocates memory that lives until the innermost open scope closes.
+    /// @param bytes Size in bytes.
+    /// @param alignment Required alignment; a power of two.
+    /// @return The memory.
+    void *allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (current < chunks.size())
+        {
+            const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunks[current].data());
+            const std::size_t start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+            if (start + bytes <= chunks[current].size())
+            {
+                offset = start + bytes;
+                return chunks[current].data() + start;
+            }
+        }
+        return allocate_slow(bytes, alignment);
+    }
+
+    /// @brief Total size of the chunks the arena holds.
+    /// @return The size in bytes.
+    std::size_t capacity() const;
+};
+
+/// @class ArenaAllocator
+/// @brief Standard allocator that takes memory from a ScratchArena and never frees it.
+/// @tparam T Element type.
+template <typename T>
+class ArenaAllocator
+{
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    ScratchArena *arena; ///< Arena the memory comes from.
+
+public:
+    using value_type = T;
+
+    /// @brief Allocates from the calling thread's arena.
+    ArenaAllocator() noexcept : arena(&ScratchArena::local()) {}
+
+    /// @brief Allocates from a given arena.
+    /// @param source The arena.
+    explicit ArenaAllocator(ScratchArena &source) noexcept : arena(&source) {}
+
+    /// @brief Rebinds an allocator to another element type, keeping its arena.
+    /// @param other The allocator.
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena(other.arena)
+    {
+    }
+
+    /// @brief Allocates room for n elements.
+    /// @param n Element count.
+    /// @return The memory.
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /// @brief Does nothing; the memory is released when the enclosing scope closes.
+    void deallocate(T *, std::size_t) noexcept {}
+
+    /// @brief Allocators are interchangeable if they share an arena.
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept
+    {
+        return arena == other.arena;
+    }
+};
+
+/// @brief A vector whose storage comes from the calling thread's scratch arena.
+template <typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T>>;
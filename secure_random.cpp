@@ -0,0 +1,37 @@
+/// @file secure_random.cpp
+/// @brief Implementation of the cryptographically secure random byte source.
+
+#include "secure_random.hpp"
+#include <stdexcept>
+#include <cerrno>
+#include <sys/random.h>
+
+/// @brief Fills a buffer with cryptographically secure random bytes.
+/// @param buffer Destination buffer.
+/// @param length Number of bytes to write.
+void fill_random(std::uint8_t *buffer, std::size_t length)
+{
+    while (length > 0)
+    {
+        const ssize_t got = ::getrandom(buffer, length, 0);
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("getrandom failed");
+        }
+
+        buffer += got;
+        length -= static_cast<std::size_t>(got);
+    }
+}
+
+/// @brief Returns cryptographically secure random bytes.
+/// @param length Number of bytes to return.
+/// @return A vector of random bytes.
+std::vector<std::uint8_t> random_bytes(std::size_t length)
+{
+    std::vector<std::uint8_t> bytes(length);
+    fill_random(bytes.data(), length);
+    return bytes;
+}
@@ -0,0 +1,21 @@
+/// @file secure_random.hpp
+/// @brief Declaration of the cryptographically secure random byte source.
+///
+/// Key generation, Miller-Rabin witnesses and session keys all draw from the kernel
+/// CSPRNG through this single entry point.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Fills a buffer with cryptographically secure random bytes.
+/// @param buffer Destination buffer.
+/// @param length Number of bytes to write.
+void fill_random(std::uint8_t *buffer, std::size_t length);
+
+/// @brief Returns cryptographically secure random bytes.
+/// @param length Number of bytes to return.
+/// @return A vector of random bytes.
+std::vector<std::uint8_t> random_bytes(std::size_t length);
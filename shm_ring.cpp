@@ -0,0 +1,334 @@
+/// @file shm_ring.cpp
+/// @brief Implementation of the shared-memory transport between the daemon and local clients.
+
+#include "shm_ring.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /// @brief Magic bytes at the start of every ring.
+    constexpr char RING_MAGIC[8] = {'B', 'N', 'S', 'H', 'R', 'I', 'N', 'G'};
+
+    /// @brief Current ring layout version.
+    constexpr std::uint32_t RING_VERSION = 1;
+
+    /// @brief Alignment of the header and of every slot; one cache line.
+    constexpr std::size_t RING_ALIGNMENT = 64;
+
+    /// @brief Slot states; see shm_ring.hpp.
+    constexpr std::uint32_t SLOT_FREE = 0;
+    constexpr std::uint32_t SLOT_CLAIMED = 1;
+    constexpr std::uint32_t SLOT_REQUEST = 2;
+    constexpr std::uint32_t SLOT_BUSY = 3;
+    constexpr std::uint32_t SLOT_RESPONSE = 4;
+
+    /// @brief Polls before a waiter falls back to sleeping on the futex, given more than one CPU.
+    constexpr int SPIN_LIMIT = 4000;
+
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free,
+                  "futex words must be plain lock-free 32-bit atomics");
+
+    /// @brief Adds the leading slash POSIX shared-memory names need.
+    /// @param name The name as given.
+    /// @return The object name.
+    std::string object_path(const std::string &name)
+    {
+        return !name.empty() && name[0] == '/' ? name : "/" + name;
+    }
+
+    /// @brief Rounds a size up to RING_ALIGNMENT.
+    /// @param size The size in bytes.
+    /// @return The rounded size.
+    std::size_t align_up(std::size_t size)
+    {
+        return (size + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+    }
+
+    /// @brief Hints the CPU that this is a spin-wait loop.
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    /// @brief Sleeps while a shared futex word still holds a value.
+    /// @param word The futex word.
+    /// @param expected The value to sleep on.
+    void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected)
+    {
+        // Not FUTEX_PRIVATE: the word is shared with other processes.
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+    }
+
+    /// @brief Wakes every waiter on a shared futex word.
+    /// @param word The futex word.
+    void futex_wake(std::atomic<std::uint32_t> &word)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    /// @brief Waits, spinning first, until a futex word no longer holds a value.
+    /// @param word The futex word.
+    /// @param value The value to wait out.
+    /// @return The new value.
+    std::uint32_t wait_while(std::atomic<std::uint32_t> &word, std::uint32_t value)
+    {
+        // On a single CPU the other side cannot make progress while we spin.
+        static const int spin_limit = std::thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0;
+
+        std::uint32_t current;
+        for (int spin = 0; (current = word.load(std::memory_order_acquire)) == value; spin++)
+        {
+            if (spin < spin_limit)
+                cpu_relax();
+            else
+                futex_wait(word, value);
+        }
+        return current;
+    }
+}
+
+/// @brief Layout of the start of the shared mapping.
+struct alignas(RING_ALIGNMENT) SharedRing::RingHeader
+{
+    char magic[8];                          ///< RING_MAGIC.
+    std::uint32_t version;                  ///< RING_VERSION.
+    std::uint32_t slot_count;               ///< Number of slots; only read when attaching.
+    std::uint32_t slot_bytes;               ///< Payload capacity of every slot; only read when attaching.
+    std::atomic<std::uint32_t> next_slot;   ///< Where the next client starts looking for a free slot.
+    std::atomic<std::uint32_t> doorbell;    ///< Bumped for every request; the daemon waits on it.
+    std::atomic<std::uint32_t> released;    ///< Bumped for every freed slot; clients wait on it when all are taken.
+};
+
+/// @brief Layout of a slot header; the payload follows it.
+struct alignas(RING_ALIGNMENT) SharedRing::Slot
+{
+    std::atomic<std::uint32_t> state; ///< SLOT_FREE and so on; also the client's futex word.
+    std::uint32_t length;             ///< Payload length of the request or response.
+    char tag;                         ///< Request tag, or response tag once answered.
+};
+
+/// @brief Creates a ring, replacing any object of the same name (daemon side).
+/// @param name Name of the shared-memory object; a leading '/' is added if missing.
+/// @param slot_count Number of slots, i.e. requests in flight at once.
+/// @param slot_bytes Largest request or response payload, in bytes.
+SharedRing::SharedRing(const std::string &name, std::uint32_t slot_count, std::uint32_t slot_bytes)
+    : object_name(object_path(name)), owner(true), mapping(nullptr), length(0), slots(slot_count), slot_size(slot_bytes)
+{
+    if (slot_count == 0 || slot_bytes == 0)
+        throw std::invalid_argument("Shared ring needs at least one slot of at least one byte");
+
+    length = sizeof(RingHeader) + std::size_t(slot_count) * (sizeof(Slot) + align_up(slot_bytes));
+
+    // Clients still attached to an old ring keep their mapping; new ones see this ring.
+    ::shm_unlink(object_name.c_str());
+    const int fd = ::shm_open(object_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create shared memory " + object_name + ": " + std::strerror(errno));
+
+    void *data = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(length)) == 0)
+        data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        ::shm_unlink(object_name.c_str());
+        throw std::runtime_error("Cannot map shared memory " + object_name);
+    }
+    mapping = static_cast<unsigned char *>(data);
+
+    // The object starts zero-filled, so every slot is already SLOT_FREE; the magic goes in last.
+    RingHeader &ring = header();
+    ring.version = RING_VERSION;
+    ring.slot_count = slot_count;
+    ring.slot_bytes = slot_bytes;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ring.magic, RING_MAGIC, sizeof(RING_MAGIC));
+}
+
+/// @brief Attaches to a ring created by a daemon (client side).
+/// @param name Name the daemon created the ring with.
+SharedRing::SharedRing(const std::string &name)
+    : object_name(object_path(name)), owner(false), mapping(nullptr), length(0), slots(0), slot_size(0)
+{
+    const int fd = ::shm_open(object_name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open shared memory " + object_name + ": " + std::strerror(errno));
+
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(RingHeader))
+    {
+        length = static_cast<std::size_t>(st.st_size);
+        data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Cannot map shared memory " + object_name);
+    mapping = static_cast<unsigned char *>(data);
+
+    // The geometry is read once and checked against the mapping by division, so no product can wrap.
+    const RingHeader &ring = header();
+    slots = ring.slot_count;
+    slot_size = ring.slot_bytes;
+    const std::size_t slots_length = length - sizeof(RingHeader);
+    if (std::memcmp(ring.magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 || ring.version != RING_VERSION || slots == 0 ||
+        slot_size == 0 || slots_length % slots != 0 || slots_length / slots != sizeof(Slot) + align_up(slot_size))
+    {
+        ::munmap(mapping, length);
+        throw std::runtime_error("Not a shared ring: " + object_name);
+    }
+}
+
+/// @brief Unmaps the ring, and removes it if this process created it.
+SharedRing::~SharedRing()
+{
+    ::munmap(mapping, length);
+    if (owner)
+        ::shm_unlink(object_name.c_str());
+}
+
+/// @brief The ring header at the start of the mapping.
+/// @return The header.
+SharedRing::RingHeader &SharedRing::header() const
+{
+    return *reinterpret_cast<RingHeader *>(mapping);
+}
+
+/// @brief Header of a slot.
+/// @param index Slot index, less than the slot count.
+/// @return The slot.
+SharedRing::Slot &SharedRing::slot(std::uint32_t index) const
+{
+    return *reinterpret_cast<Slot *>(mapping + sizeof(RingHeader) + std::size_t(index) * (sizeof(Slot) + align_up(slot_size)));
+}
+
+/// @brief Payload area of a slot.
+/// @param index Slot index, less than the slot count.
+/// @return The first payload byte.
+unsigned char *SharedRing::slot_data(std::uint32_t index) const
+{
+    return reinterpret_cast<unsigned char *>(&slot(index)) + sizeof(Slot);
+}
+
+/// @brief Sends a request and waits for its response (client side).
+/// @param op Request tag, as on the daemon socket.
+/// @param payload Request payload, at most the slot size.
+/// @return The response.
+DaemonResponse SharedRing::call(char op, std::string_view payload) const
+{
+    RingHeader &ring = header();
+    if (payload.size() > slot_size)
+        throw std::length_error("Request does not fit in a shared-memory slot");
+
+    // Claim a free slot, starting where the last client left off so clients spread out.
+    std::uint32_t index = 0;
+    for (bool claimed = false; !claimed;)
+    {
+        const std::uint32_t released = ring.released.load(std::memory_order_acquire);
+        const std::uint32_t start = ring.next_slot.fetch_add(1, std::memory_order_relaxed);
+        for (std::uint32_t i = 0; i < slots && !claimed; i++)
+        {
+            index = (start + i) % slots;
+            std::uint32_t expected = SLOT_FREE;
+            claimed = slot(index).state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acquire);
+        }
+        if (!claimed)
+            wait_while(ring.released, released);
+    }
+
+    Slot &request = slot(index);
+    request.tag = op;
+    request.length = static_cast<std::uint32_t>(payload.size());
+    std::memcpy(slot_data(index), payload.data(), payload.size());
+    request.state.store(SLOT_REQUEST, std::memory_order_release);
+
+    ring.doorbell.fetch_add(1, std::memory_order_release);
+    futex_wake(ring.doorbell);
+
+    for (std::uint32_t state = SLOT_REQUEST; state != SLOT_RESPONSE;)
+        state = wait_while(request.state, state);
+
+    const std::uint32_t size = std::min(request.length, slot_size);
+    DaemonResponse response{request.tag, std::string(reinterpret_cast<const char *>(slot_data(index)), size)};
+
+    request.state.store(SLOT_FREE, std::memory_order_release);
+    ring.released.fetch_add(1, std::memory_order_release);
+    futex_wake(ring.released);
+
+    return response;
+}
+
+/// @brief Waits until at least one request is ready and takes all ready requests (daemon side).
+/// @return Indices of the taken slots.
+std::vector<std::uint32_t> SharedRing::wait_for_requests() const
+{
+    RingHeader &ring = header();
+    std::vector<std::uint32_t> ready;
+    while (true)
+    {
+        const std::uint32_t doorbell = ring.doorbell.load(std::memory_order_acquire);
+
+        for (std::uint32_t i = 0; i < slots; i++)
+        {
+            std::uint32_t expected = SLOT_REQUEST;
+            if (slot(i).state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acquire))
+                ready.push_back(i);
+        }
+        if (!ready.empty())
+            return ready;
+
+        wait_while(ring.doorbell, doorbell);
+    }
+}
+
+/// @brief Tag of a taken request.
+/// @param index Slot index returned by wait_for_requests().
+/// @return The request tag.
+char SharedRing::request_op(std::uint32_t index) const
+{
+    return slot(index).tag;
+}
+
+/// @brief Payload of a taken request, in place in shared memory.
+/// @param index Slot index returned by wait_for_requests().
+/// @return A view that stays valid until respond() is called for the slot.
+std::string_view SharedRing::request(std::uint32_t index) const
+{
+    // A misbehaving client cannot make the daemon read past the slot.
+    const std::uint32_t size = std::min(slot(index).length, slot_size);
+    return std::string_view(reinterpret_cast<const char *>(slot_data(index)), size);
+}
+
+/// @brief Writes a response over a taken request and wakes its client.
+/// @param index Slot index returned by wait_for_requests().
+/// @param response The response.
+void SharedRing::respond(std::uint32_t index, const DaemonResponse &response) const
+{
+    static const std::string too_large = "Response does not fit in a shared-memory slot";
+    const bool fits = response.payload.size() <= slot_size;
+    const std::string &payload = fits ? response.payload : too_large;
+
+    Slot &answer = slot(index);
+    answer.tag = fits ? response.tag : DAEMON_ERROR;
+    answer.length = static_cast<std::uint32_t>(std::min<std::size_t>(payload.size(), slot_size));
+    std::memcpy(slot_data(index), payload.data(), answer.length);
+    answer.state.store(SLOT_RESPONSE, std::memory_order_release);
+    futex_wake(answer.state);
+}
@@ -0,0 +1,98 @@
+/// @file shm_ring.hpp
+/// @brief Declaration of the shared-memory transport between the daemon and local clients.
+///
+/// The daemon creates a POSIX shared-memory object holding a ring of fixed-size slots. A
+/// client claims a free slot, writes its request into it in place and rings a doorbell;
+/// the daemon reads the request where it lies, writes the response over it and wakes the
+/// client. Waiting is done on futexes in the shared mapping, after a short spin, so a request
+/// costs no system call while both sides are busy and no copies through the kernel at all.
+///
+/// Slot states move FREE -> CLAIMED -> REQUEST (client), REQUEST -> BUSY -> RESPONSE (daemon)
+/// and RESPONSE -> FREE (client). A client that dies while holding a slot leaks it until the
+/// daemon is restarted.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "daemon.hpp"
+
+/// @class SharedRing
+/// @brief A ring of request slots in shared memory, used from either side.
+class SharedRing
+{
+private:
+    struct RingHeader;
+    struct Slot;
+
+    std::string object_name; ///< Name of the shared-memory object.
+    bool owner;              ///< Whether this process created the object and unlinks it.
+    unsigned char *mapping;  ///< Start of the shared mapping.
+    std::size_t length;      ///< Length of the mapping in bytes.
+    std::uint32_t slots;     ///< Number of slots; copied once, since any client can write the shared header.
+    std::uint32_t slot_size; ///< Payload capacity of every slot; copied once likewise.
+
+    /// @brief The ring header at the start of the mapping.
+    /// @return The header.
+    RingHeader &header() const;
+
+    /// @brief Header of a slot.
+    /// @param index Slot index, less than the slot count.
+    /// @return The slot.
+    Slot &slot(std::uint32_t index) const;
+
+    /// @brief Payload area of a slot.
+    /// @param index Slot index, less than the slot count.
+    /// @return The first payload byte.
+    unsigned char *slot_data(std::uint32_t index) const;
+
+public:
+    /// @brief Creates a ring, replacing any object of the same name (daemon side).
+    /// @param name Name of the shared-memory object; a leading '/' is added if missing.
+    /// @param slot_count Number of slots, i.e. requests in flight at once.
+    /// @param slot_bytes Largest request or response payload, in bytes.
+    /// @throws std::runtime_error if the object cannot be created or mapped.
+    SharedRing(const std::string &name, std::uint32_t slot_count, std::uint32_t slot_bytes);
+
+    /// @brief Attaches to a ring created by a daemon (client side).
+    /// @param name Name the daemon created the ring with.
+    /// @throws std::runtime_error if the object does not exist or is not a ring.
+    explicit SharedRing(const std::string &name);
+
+    /// @brief Unmaps the ring, and removes it if this process created it.
+    ~SharedRing();
+
+    SharedRing(const SharedRing &) = delete;
+    SharedRing &operator=(const SharedRing &) = delete;
+
+    /// @brief Sends a request and waits for its response (client side).
+    /// @param op Request tag, as on the daemon socket.
+    /// @param payload Request payload, at most the slot size.
+    /// @return The response.
+    /// @throws std::length_error if the payload does not fit in a slot.
+    DaemonResponse call(char op, std::string_view payload) const;
+
+    /// @brief Waits until at least one request is ready and takes all ready requests (daemon side).
+    /// @return Indices of the taken slots; each must be answered with respond().
+    std::vector<std::uint32_t> wait_for_requests() const;
+
+    /// @brief Tag of a taken request.
+    /// @param index Slot index returned by wait_for_requests().
+    /// @return The request tag.
+    char request_op(std::uint32_t index) const;
+
+    /// @brief Payload of a taken request, in place in shared memory.
+    /// @param index Slot index returned by wait_for_requests().
+    /// @return A view that stays valid until respond() is called for the slot.
+    std::string_view request(std::uint32_t index) const;
+
+    /// @brief Writes a response over a taken request and wakes its client.
+    ///
+    /// A response larger than the slot is replaced with an error saying so.
+    /// @param index Slot index returned by wait_for_requests().
+    /// @param response The response.
+    void respond(std::uint32_t index, const DaemonResponse &response) const;
+};
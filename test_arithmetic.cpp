@@ -0,0 +1,219 @@
+/// @file test_arithmetic.cpp
+/// @brief Checks the big-integer arithmetic against values computed independently.
+
+#include "bignum.hpp"
+#include "modexp_lanes.hpp"
+#include "test_support.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::string MODEXP_BASE =
+        "1914059393430291382844824531825107147539511363362320389117089898075846853382065114890077477418224362146926752124694274292794368511164487899871792843760";
+    const std::string MODEXP_EXPONENT =
+        "1499460208927033647563441787642252935230028350931736747963068964110853618689689716951591033";
+    const std::string MODEXP_MODULUS =
+        "2529409290597879880389142908566119146305315156841562276567906848629103950816707791522528075595843720886340264843713965117914208574073304214560565087924357489";
+
+    /// @brief MODEXP_BASE + i raised to MODEXP_EXPONENT modulo MODEXP_MODULUS, for i = 0 to 4.
+    const std::vector<std::string> MODEXP_RESULTS = {
+        "91153934447070659434377133695031807996485163601994673298382913485167351503901577528911603561238911180585292623238323514216179813498319263406794340479713573",
+        "726075208780703564221800068013766157062726878649432201880552023929422573250997100832308051526020977434134890068508515497980045922547996429670180669945757033",
+        "1615961608436258353243622755629651516211734616940747319555179953765562695082832422243988752455074984809031194097926440202468989072647971811643242576467074249",
+        "364794585393035136927782036041835184748583347582601225896335388746787292548734687896982205632821795459043599712340760107963768346684344668723501443669795588",
+        "2461930961757474939824368655934802917680460689161681605635227763765349926044868935154505679615273974812600445291658152088426847032287672063160365209360272623",
+    };
+
+    const std::string PRODUCT_LEFT =
+        "15635855772440756296144394303948717498417541212118159159702930883983815822837072659539095710745098348752023491542214201590940471924997553972859519441523119083627956731370190369721565420708744258748079303472608188831913678417756215999667710434736920718175175236027395905513622675334713202194486082463922289056903260709200986024420207464950215895276318933204816635573548762170470872749764507716113178947336625144307275781225";
+    const std::string PRODUCT_RIGHT =
+        "6241067439614461385183491857119885557392707078777381477807775692969393933215263398284788263969500040071415538236472555185596372497373236300195868482285213464774410290553894793580034170368579202489453224656860137309327935298716585133515775564659212294332725745630644450095098584038006018433973864953272362521201086300736391848510480239364133039753851332853141633987769293544135520774483470926";
+    const std::string PRODUCT =
+        "97584430351887827272864264690271601669028703822058580304182017218369557641313491001936899770042948370637565359542028982404479412684502185123378114031701426756444141211424868151593017677133281174449130326574670938838672826087671574675867453189108369789243797623864625292690964134713812696790440539360547124370640149427773190623965078838491409221756208808470319145105967155311459845850878242900806795084368000460090273792901875777719552540182774975068536463725621566323573051012137737233213384684942155357417660139941878648103961883462673625880265166320763903411710951365784835894352000105485357141579734670794047232761917231302363281534693580798858086014514124371792394739899057493973530034997317299171597015550742451058106295231969783481859826910082983058546425532501997735179040529375876011336188918636224164350";
+
+    /// @brief Checks single and lane-interleaved modular exponentiation.
+    void test_mod_exponent()
+    {
+        const Bignum bignum;
+        const Bignum base(MODEXP_BASE), exponent(MODEXP_EXPONENT), modulus(MODEXP_MODULUS);
+
+        check(bignum.mod_exponent(Bignum("4"), Bignum("13"), Bignum("497")) == Bignum("445"), "4^13 mod 497");
+        check(bignum.mod_exponent(Bignum("7"), Bignum("0"), Bignum("13")) == Bignum("1"), "a zero exponent");
+        check(bignum.mod_exponent(base, exponent, modulus) == Bignum(MODEXP_RESULTS[0]), "mod_exponent of a 520-bit modulus");
+
+        // One more base than there are lanes, so the batch is split.
+        std::vector<Bignum> bases;
+        for (Limb i = 0; i < MODEXP_RESULTS.size(); i++)
+            bases.push_back(Bignum::from_limbs(add_limbs(base.to_limbs(), {i})));
+        const std::vector<Bignum> results = bignum.mod_exponent_batch(bases, exponent, modulus);
+        check(results.size() == MODEXP_RESULTS.size(), "mod_exponent_batch result count");
+        for (std::size_t i = 0; i < results.size() && i < MODEXP_RESULTS.size(); i++)
+            check(results[i] == Bignum(MODEXP_RESULTS[i]), "mod_exponent_batch lane " + std::to_string(i));
+
+        const LaneModulus lane_modulus(modulus.to_limbs());
+        std::vector<std::vector<Limb>> lanes;
+        for (std::size_t i = 0; i < MAX_LANES; i++)
+            lanes.push_back(lane_modulus.reduce(bases[i].to_limbs()));
+        mod_exponent_lanes(lanes, ExponentRecoding(exponent.to_limbs()), lane_modulus);
+        for (std::size_t i = 0; i < MAX_LANES; i++)
+            check(Bignum::from_limbs(lanes[i]) == Bignum(MODEXP_RESULTS[i]), "mod_exponent_lanes lane " + std::to_string(i));
+    }
+
+    /// @brief Checks gcd, modular inverse and the rejection of a negative difference.
+    void test_gcd_and_inverse()
+    {
+        const Bignum bignum;
+        check(bignum.gcd(Bignum("462"), Bignum("1071")) == Bignum("21"), "gcd(462, 1071)");
+        check(bignum.gcd(Bignum("0"), Bignum("17")) == Bignum("17"), "gcd(0, 17)");
+        check(bignum.gcd(Bignum("2141595132927351421584960477925454275575152026858334494380501898011527264621332996589872306009952595311848350"),
+                         Bignum("22823712913124163285436255684779784904078680420989520970771117683945638003340581884801844405560601498930")) ==
+                  Bignum("12345678901234567890"),
+              "gcd of large values");
+        check(Bignum::from_limbs(gcd_limbs(Bignum("1071").to_limbs(), Bignum("462").to_limbs())) == Bignum("21"), "gcd_limbs");
+
+        check(bignum.mod_inverse(Bignum("3"), Bignum("11")) == Bignum("4"), "inverse of 3 mod 11");
+        const Bignum modulus("10851871202442066816877878591794974718421324291759141365379748340436382272440227380533658231825827802039591013723993842388620202128103620592039967846766653");
+        const Bignum value("1484666521169029374626081946547195039403171476087294910715358");
+        const Bignum inverse = bignum.mod_inverse(value, modulus);
+        check(inverse == Bignum("9398390595930509621039483663075367370619986502001512281096553209198910535801510827910693208284016858768630272227536629963907105641182550060932380377938741"),
+              "inverse modulo a 512-bit modulus");
+        check((value * inverse) % modulus == Bignum("1"), "value times its inverse");
+        check_throws<std::invalid_argument>([&]() { bignum.mod_inverse(Bignum("6"), Bignum("9")); },
+                                            "a value sharing a factor with the modulus has no inverse");
+
+        check_throws<std::underflow_error>([]() { Bignum("5") - Bignum("7"); }, "a negative difference is rejected");
+        check(Bignum("10000") - Bignum("1") == Bignum("9999"), "a difference borrowing across a limb");
+    }
+
+    /// @brief Checks Karatsuba multiplication and long division on operands above the threshold.
+    void test_multiply_and_divide()
+    {
+        const Bignum left(PRODUCT_LEFT), right(PRODUCT_RIGHT), product(PRODUCT);
+        check(left * right == product, "product of 100-limb operands");
+        check(Bignum::from_limbs(multiply_limbs(right.to_limbs(), left.to_limbs())) == product, "multiply_limbs of unequal operands");
+        check(product / right == left, "quotient of the product");
+        check(product % right == Bignum("0"), "remainder of the product");
+
+        // (10^k - 1)^2 = 10^2k - 2 * 10^k + 1, i.e. k - 1 nines, an eight, k - 1 zeros and a one.
+        const std::size_t k = 4001;
+        const Bignum nines(std::string(k, '9'));
+        const std::string square = std::string(k - 1, '9') + "8" + std::string(k - 1, '0') + "1";
+        check((nines * nines).to_string() == square, "square of 4001 nines");
+
+        std::vector<Limb> quotient, remainder;
+        const std::vector<Limb> dividend = add_limbs(product.to_limbs(), {1234});
+        divide_limbs(dividend, right.to_limbs(), quotient, remainder);
+        check(Bignum::from_limbs(quotient) == left, "divide_limbs quotient");
+        check(Bignum::from_limbs(remainder) == Bignum("1234"), "divide_limbs remainder");
+        check(compare_limbs(subtract_limbs(dividend, remainder), product.to_limbs()) == 0, "subtract_limbs");
+    }
+
+    /// @brief Checks conversions between limbs and big-endian bytes.
+    void test_radix_conversion()
+    {
+        const std::vector<std::uint8_t> two_to_64 = {1, 0, 0, 0, 0, 0, 0, 0, 0};
+        const std::vector<Limb> limbs = bytes_to_limbs(two_to_64);
+        check(Bignum::from_limbs(limbs).to_string() == "18446744073709551616", "2^64 from bytes");
+        check(byte_length(limbs) == 9, "byte_length of 2^64");
+        check(limbs_to_bytes(limbs, 9) == two_to_64, "2^64 to bytes");
+        check(limbs_to_bytes(limbs, 11) == std::vector<std::uint8_t>({0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0}), "2^64 to padded bytes");
+
+        // Wide enough that both directions take the divide-and-conquer path.
+        const std::vector<std::uint8_t> product_bytes = limbs_to_bytes(Bignum(PRODUCT).to_limbs(), 400);
+        check(Bignum::from_limbs(bytes_to_limbs(product_bytes)) == Bignum(PRODUCT), "wide bytes round trip");
+        check(limbs_to_bytes(bytes_to_limbs(product_bytes), 400) == product_bytes, "wide limbs round trip");
+    }
+
+    /// @brief Checks decimal parsing on both sides of the 16-digit blocks.
+    void test_decimal_parsing()
+    {
+        const std::string digits = "9876543210123456789098765432101234567890";
+        for (std::size_t length = 1; length <= digits.size(); length++)
+            check(Bignum(digits.substr(0, length)).to_string() == digits.substr(0, length),
+                  "decimal round trip of " + std::to_string(length) + " digits");
+        check(Bignum(PRODUCT).to_string() == PRODUCT, "decimal round trip of a long number");
+        check(Bignum(PRODUCT_LEFT) * Bignum("1") == Bignum(PRODUCT_LEFT), "a parsed number keeps its value");
+
+        // Bytes either side of '0' and '9', including one that wraps around when '0' is subtracted.
+        const std::string invalid = "/: a\xff";
+        for (std::size_t position = 0; position < 34; position++)
+            for (char bad : invalid)
+            {
+                std::string number = digits.substr(0, 34);
+                number[position] = bad;
+                check_throws<std::invalid_argument>([&]() { Bignum{number}; },
+                                                    "a bad byte at position " + std::to_string(position) + " is rejected");
+            }
+    }
+
+    /// @brief Checks that text is packed into a block as big-endian bytes and unpacked again.
+    void test_byte_packing()
+    {
+        const Bignum bignum;
+        check(bignum.string_to_bignum("AB") == Bignum("16706"), "AB packs to 0x4142");
+        check(bignum.string_to_bignum(std::string("\xff\x00\x01", 3)) == Bignum("16711681"), "bytes above 0x7f pack unsigned");
+        check(bignum.bignum_to_string(Bignum("16706"), 2) == "AB", "0x4142 unpacks to AB");
+
+        const std::string text("\0\0leading zero bytes", 20);
+        check(bignum.bignum_to_string(bignum.string_to_bignum(text), text.size()) == text, "leading zero bytes are kept");
+        check(bignum.bignum_to_string(bignum.string_to_bignum(""), 0).empty(), "nothing packs to nothing");
+        check_throws<std::overflow_error>([&]() { bignum.bignum_to_string(Bignum("65536"), 2); },
+                                          "a value wider than the length is rejected");
+    }
+
+    /// @brief Raises a value to 65537 with plain multiplication and division.
+    /// @param base The base.
+    /// @param modulus The modulus.
+    /// @return base^65537 mod modulus.
+    Bignum power_65537(const Bignum &base, const Bignum &modulus)
+    {
+        const std::vector<Limb> base_limbs = base.to_limbs(), modulus_limbs = modulus.to_limbs();
+        std::vector<Limb> quotient, result;
+        divide_limbs(base_limbs, modulus_limbs, quotient, result);
+        for (int i = 0; i < 16; i++)
+            divide_limbs(multiply_limbs(result, result), modulus_limbs, quotient, result);
+        divide_limbs(multiply_limbs(result, base_limbs), modulus_limbs, quotient, result);
+        return Bignum::from_limbs(result);
+    }
+
+    /// @brief Checks exponentiation with a modulus wide enough to split products across workers.
+    ///
+    /// Products are only split when the shared pool has more than one worker, so on a
+    /// single-CPU host this checks the same path as the narrower moduli do.
+    void test_wide_modulus()
+    {
+        // 2400 digits is 600 limbs, above the 512 from which product columns are split.
+        std::string modulus_digits, base_digits;
+        for (int i = 0; i < 240; i++)
+        {
+            modulus_digits += "9182736450";
+            base_digits += std::to_string(1000000000 + i * 7919);
+        }
+        modulus_digits.back() = '1';
+        base_digits.resize(2390);
+
+        const Bignum bignum, modulus(modulus_digits), exponent("65537");
+        const Bignum first(base_digits), second = Bignum::from_limbs(add_limbs(first.to_limbs(), {3}));
+        const Bignum expected_first = power_65537(first, modulus), expected_second = power_65537(second, modulus);
+
+        check(bignum.mod_exponent(first, exponent, modulus) == expected_first, "mod_exponent of a 600-limb modulus");
+        const std::vector<Bignum> results = bignum.mod_exponent_batch({first, second}, exponent, modulus);
+        check(results.size() == 2 && results[0] == expected_first && results[1] == expected_second,
+              "mod_exponent_batch of a 600-limb modulus");
+    }
+}
+
+int main()
+{
+    test_mod_exponent();
+    test_gcd_and_inverse();
+    test_multiply_and_divide();
+    test_radix_conversion();
+    test_decimal_parsing();
+    test_byte_packing();
+    test_wide_modulus();
+    return test_status();
+}
@@ -0,0 +1,76 @@
+/// @file test_chacha20poly1305.cpp
+/// @brief Checks ChaCha20-Poly1305 against the AEAD test vector of RFC 8439, section 2.8.2.
+
+#include "chacha20poly1305.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /// @brief Number of failed checks.
+    int failures = 0;
+
+    /// @brief Records a failed check.
+    /// @param passed Outcome of the check.
+    /// @param what Description printed on failure.
+    void check(bool passed, const std::string &what)
+    {
+        if (!passed)
+        {
+            std::cout << "FAILED: " << what << "\n";
+            failures++;
+        }
+    }
+
+    /// @brief Decodes a hexadecimal string.
+    /// @param hex Pairs of hex digits.
+    /// @return The bytes.
+    std::vector<std::uint8_t> from_hex(const std::string &hex)
+    {
+        std::vector<std::uint8_t> bytes;
+        for (std::size_t i = 0; i + 1 < hex.length(); i += 2)
+            bytes.push_back(static_cast<std::uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+        return bytes;
+    }
+}
+
+int main()
+{
+    const std::string text = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the "
+                             "future, sunscreen would be it.";
+    const std::vector<std::uint8_t> plaintext(text.begin(), text.end());
+    const std::vector<std::uint8_t> aad = from_hex("50515253c0c1c2c3c4c5c6c7");
+    const std::vector<std::uint8_t> key = from_hex("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    const std::vector<std::uint8_t> nonce = from_hex("070000004041424344454647");
+    const std::vector<std::uint8_t> expected_ciphertext = from_hex(
+        "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+        "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+        "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+        "3ff4def08e4b7a9de576d26586cec64b6116");
+    const std::vector<std::uint8_t> expected_tag = from_hex("1ae10b594f09e26a7e902ecbd0600691");
+
+    std::vector<std::uint8_t> ciphertext(plaintext.size());
+    std::uint8_t tag[AEAD_TAG_BYTES];
+    aead_seal(key.data(), nonce.data(), aad.data(), aad.size(), plaintext.data(), plaintext.size(), ciphertext.data(), tag);
+    check(ciphertext == expected_ciphertext, "aead_seal ciphertext");
+    check(std::memcmp(tag, expected_tag.data(), AEAD_TAG_BYTES) == 0, "aead_seal tag");
+
+    std::vector<std::uint8_t> opened(ciphertext.size());
+    check(aead_open(key.data(), nonce.data(), aad.data(), aad.size(), expected_ciphertext.data(), expected_ciphertext.size(),
+                    expected_tag.data(), opened.data()),
+          "aead_open accepts the vector");
+    check(opened == plaintext, "aead_open plaintext");
+
+    std::vector<std::uint8_t> tampered = expected_ciphertext;
+    tampered[0] ^= 1;
+    check(!aead_open(key.data(), nonce.data(), aad.data(), aad.size(), tampered.data(), tampered.size(),
+                     expected_tag.data(), opened.data()),
+          "aead_open rejects a modified ciphertext");
+    check(!aead_open(key.data(), nonce.data(), aad.data(), aad.size() - 1, expected_ciphertext.data(),
+                     expected_ciphertext.size(), expected_tag.data(), opened.data()),
+          "aead_open rejects modified additional data");
+
+    return failures == 0 ? 0 : 1;
+}
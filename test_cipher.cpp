@@ -0,0 +1,302 @@
+/// @file test_cipher.cpp
+/// @brief Checks the text, binary and hybrid ciphers and the container and line index formats.
+///
+/// Uses the fixed key from test_support.hpp, so the text cipher can also be checked against
+/// a ciphertext computed independently.
+
+#include "bignum.hpp"
+#include "ciphertext_file.hpp"
+#include "keycontext.hpp"
+#include "keygen.hpp"
+#include "test_support.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /// @brief "hello" encrypted as line 1 with the fixed key.
+    const std::string HELLO_CIPHERTEXT =
+        "2359949971750911757434473678708821007437147749937620923020155904726755762691372791855243083684158606053772449850363085145825365662823832808684547436225180";
+
+    /// @brief Lines of the test text; the third is several blocks long.
+    /// @return The lines.
+    std::vector<std::string> sample_lines()
+    {
+        std::string long_line;
+        for (int i = 0; i < 40; i++)
+            long_line += "block " + std::to_string(i) + " of a line longer than the modulus; ";
+        return {"hello", "", long_line, "tab\tand \x01 control", "last"};
+    }
+
+    /// @brief Runs an operation that is expected to throw std::runtime_error.
+    /// @param operation The operation.
+    /// @return The exception's message, or an empty string if nothing was thrown.
+    template <typename F>
+    std::string error_message(F operation)
+    {
+        try
+        {
+            operation();
+        }
+        catch (const std::runtime_error &error)
+        {
+            return error.what();
+        }
+        return {};
+    }
+
+    /// @brief Joins lines with newlines.
+    /// @param lines The lines.
+    /// @return The text.
+    std::string join_lines(const std::vector<std::string> &lines)
+    {
+        std::string text;
+        for (std::size_t i = 0; i < lines.size(); i++)
+            text += (i == 0 ? "" : "\n") + lines[i];
+        return text;
+    }
+
+    /// @brief Counts the space-separated blocks of an encrypted line.
+    /// @param encrypted_line The line.
+    /// @return The block count.
+    std::size_t block_count(const std::string &encrypted_line)
+    {
+        std::size_t count = 1;
+        for (char c : encrypted_line)
+            count += c == ' ';
+        return count;
+    }
+
+    /// @brief Checks the text cipher against the known ciphertext, its block sizes and round trips.
+    void test_text()
+    {
+        const KeyHandle key = test_key();
+        const Bignum bignum;
+        check(bignum.large_encrypt("hello", key) == std::vector<std::string>{HELLO_CIPHERTEXT}, "known ciphertext of hello");
+        check(bignum.large_decrypt(HELLO_CIPHERTEXT, 1, key) == "hello", "known ciphertext decrypts with the CRT");
+        check(bignum.large_decrypt(HELLO_CIPHERTEXT, 1, test_key(false)) == "hello", "known ciphertext decrypts without the CRT");
+        check_throws<std::exception>([&]() { bignum.large_decrypt(HELLO_CIPHERTEXT, 2, key); },
+                                     "a line decrypted under the wrong number is rejected");
+
+        const std::vector<std::string> lines = sample_lines();
+        const std::vector<std::string> encrypted = bignum.large_encrypt(join_lines(lines), key);
+        check(encrypted.size() == lines.size(), "one encrypted line per line");
+
+        // A 64-byte modulus carries 62 bytes of framed line per block, after the flag byte.
+        for (std::size_t i = 0; i < encrypted.size() && i < lines.size(); i++)
+            check(block_count(encrypted[i]) == (lines[i].size() + 6 + 61) / 62, "blocks of line " + std::to_string(i + 1));
+
+        const std::vector<std::string_view> views(encrypted.begin(), encrypted.end());
+        check(bignum.large_decrypt(views, key) == lines, "text round trip");
+        check(bignum.large_decrypt(std::vector<std::string_view>(views.begin() + 2, views.end()), key, 3) ==
+                  std::vector<std::string>(lines.begin() + 2, lines.end()),
+              "decryption starting from line 3");
+
+        const auto limbs = [](const char *value) { return Bignum(value).to_limbs(); };
+        const KeyHandle tiny_key = std::make_shared<const KeyContext>(limbs("3233"), limbs("17"), limbs("2753"));
+        check_throws<std::invalid_argument>([&]() { bignum.large_encrypt("hello", tiny_key); },
+                                            "a modulus too small for a block is rejected");
+    }
+
+    /// @brief Checks the hybrid container.
+    void test_hybrid()
+    {
+        const KeyHandle key = test_key();
+        const KeyHandle other_key = std::make_shared<const KeyContext>(KeyGenerator(512).generate());
+        const Bignum bignum;
+        const std::string data("binary\0data\xff with a NUL", 24);
+        const std::string container = bignum.hybrid_encrypt(data, key);
+        check(bignum.hybrid_decrypt(container, key) == data, "hybrid round trip");
+        check(bignum.hybrid_decrypt(container, test_key(false)) == data, "hybrid round trip without the CRT");
+        check(bignum.hybrid_encrypt(data, key) != container, "hybrid encryption is randomised");
+        check(bignum.hybrid_decrypt(bignum.hybrid_encrypt("", key), key).empty(), "hybrid round trip of nothing");
+
+        std::string tampered = container;
+        tampered[tampered.size() - 20] ^= 1;
+        check_throws<std::runtime_error>([&]() { bignum.hybrid_decrypt(tampered, key); }, "a modified hybrid container is rejected");
+        check_throws<std::runtime_error>([&]() { bignum.hybrid_decrypt(container.substr(0, 20), key); },
+                                         "a truncated hybrid container is rejected");
+        check_throws<std::runtime_error>([&]() { bignum.hybrid_decrypt(container, other_key); },
+                                         "a hybrid container for another key is rejected");
+
+        // A session key block with bad padding must fail exactly like a corrupted payload.
+        const std::string tampered_error = error_message([&]() { bignum.hybrid_decrypt(tampered, key); });
+        const Bignum modulus = Bignum::from_limbs(key->modulus().limbs());
+        const Bignum exponent = Bignum::from_limbs(key->public_exponent());
+        const std::string key_prefix(std::string("\x00\x01", 2) + std::string(29, '\xff') + std::string(1, '\0'));
+        const std::string missing_separator(std::string("\x00\x02", 2) + std::string(30, '\x5a'));
+        for (const std::string &prefix : {key_prefix, missing_separator})
+        {
+            const Bignum block = bignum.string_to_bignum(prefix + std::string(32, '\x33'));
+            std::string forged = container;
+            forged.replace(8, 64, bignum.bignum_to_string(bignum.mod_exponent(block, exponent, modulus), 64));
+            check(error_message([&]() { bignum.hybrid_decrypt(forged, key); }) == tampered_error,
+                  "a malformed session key fails with the authentication error");
+        }
+    }
+
+    /// @brief Checks the binary container.
+    void test_binary()
+    {
+        const KeyHandle key = test_key();
+        const KeyHandle other_key = std::make_shared<const KeyContext>(KeyGenerator(512).generate());
+        const Bignum bignum;
+        const std::vector<std::string> lines = sample_lines();
+        const std::string container = bignum.large_encrypt_binary(join_lines(lines), key);
+        check(bignum.large_decrypt_binary(container, key) == lines, "binary round trip");
+        check(bignum.large_decrypt_binary(container, test_key(false)) == lines, "binary round trip without the CRT");
+        check(container.compare(0, sizeof(CiphertextHeader), ciphertext_header(*key)) == 0, "the container starts with its header");
+
+        const CiphertextReader reader(reinterpret_cast<const std::uint8_t *>(container.data()), container.size(), *key);
+        check(reader.block_bytes() == 64, "blocks are as wide as the modulus");
+        check(reader.block_count() * 64 + sizeof(CiphertextHeader) == container.size(), "the container holds whole blocks");
+
+        const std::vector<std::string> text_lines = bignum.large_encrypt(join_lines(lines), key);
+        check(reader.block_count() > 0 && Bignum::from_limbs(reader.block(0)).to_string() == text_lines[0],
+              "a block holds the same value as in the text format");
+
+        check(key_fingerprint(*key) == key_fingerprint(*test_key(false)), "the fingerprint covers only the public key");
+        check(key_fingerprint(*key) != key_fingerprint(*other_key), "keys have different fingerprints");
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_binary(container, other_key); },
+                                         "a container for another key is rejected");
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_binary(container.substr(0, container.size() - 1), key); },
+                                         "a container cut inside a block is rejected");
+        std::string bad_magic = container;
+        bad_magic[0] ^= 1;
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_binary(bad_magic, key); },
+                                         "a container with a bad magic is rejected");
+    }
+
+    /// @brief Checks that the streaming overloads hand over the same lines and bytes as the others.
+    void test_streaming()
+    {
+        const KeyHandle key = test_key();
+        const Bignum bignum;
+        const std::vector<std::string> lines = sample_lines();
+        const std::vector<std::string> encrypted = bignum.large_encrypt(join_lines(lines), key);
+
+        std::vector<std::string> streamed;
+        bignum.large_encrypt(join_lines(lines), key, [&streamed](std::string_view line) { streamed.emplace_back(line); });
+        check(streamed == encrypted, "streamed encryption matches");
+
+        std::vector<std::string> decrypted;
+        const std::vector<std::string_view> views(encrypted.begin(), encrypted.end());
+        bignum.large_decrypt(views, key, 1, [&decrypted](std::string_view line) { decrypted.emplace_back(line); });
+        check(decrypted == lines, "streamed decryption matches");
+
+        const std::string container = bignum.large_encrypt_binary(join_lines(lines), key);
+        std::vector<std::size_t> line_blocks;
+        std::string streamed_container;
+        bignum.large_encrypt_binary(join_lines(lines), key, line_blocks,
+                                    [&streamed_container](std::string_view bytes) { streamed_container.append(bytes); });
+        check(streamed_container.size() == container.size(), "streamed container size");
+        check(bignum.large_decrypt_binary(streamed_container, key) == lines, "streamed container round trip");
+
+        std::size_t total_blocks = 0;
+        for (std::size_t i = 0; i < line_blocks.size() && i < encrypted.size(); i++)
+        {
+            check(line_blocks[i] == block_count(encrypted[i]), "block count of line " + std::to_string(i + 1));
+            total_blocks += line_blocks[i];
+        }
+        check(line_blocks.size() == lines.size() && sizeof(CiphertextHeader) + total_blocks * 64 == container.size(),
+              "block counts add up to the container");
+
+        decrypted.clear();
+        bignum.large_decrypt_binary(container, sizeof(CiphertextHeader), container.size(), 1, key,
+                                    [&decrypted](std::string_view line) { decrypted.emplace_back(line); });
+        check(decrypted == lines, "streamed binary decryption matches");
+    }
+
+    /// @brief Checks the line index and decrypting a run of lines by offset.
+    void test_line_index()
+    {
+        const KeyHandle key = test_key();
+        const Bignum bignum;
+        const std::vector<std::string> lines = sample_lines();
+        std::vector<std::size_t> line_blocks;
+        std::string container;
+        bignum.large_encrypt_binary(join_lines(lines), key, line_blocks, [&container](std::string_view bytes) { container.append(bytes); });
+
+        std::vector<std::uint64_t> offsets = {sizeof(CiphertextHeader)};
+        for (std::size_t blocks : line_blocks)
+            offsets.push_back(offsets.back() + blocks * 64);
+
+        const std::string index_path = scratch_path("index");
+        save_line_index(index_path, offsets);
+        check(load_line_index(index_path, container.size()) == offsets, "line index round trip");
+        check_throws<std::runtime_error>([&]() { load_line_index(index_path, container.size() + 64); },
+                                         "an index for another ciphertext is rejected");
+
+        std::ifstream index_in(index_path, std::ios::binary);
+        const std::string index_bytes((std::istreambuf_iterator<char>(index_in)), std::istreambuf_iterator<char>());
+        index_in.close();
+        std::ofstream(index_path, std::ios::binary | std::ios::trunc).write(index_bytes.data(), index_bytes.size() - 3);
+        check_throws<std::runtime_error>([&]() { load_line_index(index_path, container.size()); }, "a truncated index is rejected");
+        std::ofstream(index_path, std::ios::binary | std::ios::trunc) << index_bytes << "extra";
+        check_throws<std::runtime_error>([&]() { load_line_index(index_path, container.size()); },
+                                         "an index with trailing bytes is rejected");
+
+        std::vector<std::uint64_t> backwards = offsets;
+        std::swap(backwards[1], backwards[2]);
+        save_line_index(index_path, backwards);
+        check_throws<std::runtime_error>([&]() { load_line_index(index_path, container.size()); },
+                                         "an index going backwards is rejected");
+        std::remove(index_path.c_str());
+        check_throws<std::runtime_error>([&]() { load_line_index(index_path, container.size()); }, "a missing index is rejected");
+
+        check(bignum.large_decrypt_binary(container, offsets[2], offsets[4], 3, key) ==
+                  std::vector<std::string>(lines.begin() + 2, lines.begin() + 4),
+              "decrypting lines 3 and 4 by offset");
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_binary(container, offsets[2] + 1, offsets[4], 3, key); },
+                                         "an offset off a block boundary is rejected");
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_binary(container, offsets[2], container.size() + 64, 3, key); },
+                                         "an offset past the container is rejected");
+    }
+
+    /// @brief Checks that batched texts give the same result as texts encrypted on their own.
+    void test_batches()
+    {
+        const KeyHandle key = test_key();
+        const Bignum bignum;
+        const std::vector<std::string> lines = sample_lines();
+        const std::string long_text = join_lines(lines);
+        const std::vector<std::string_view> texts = {"one\ntwo", long_text, "three"};
+
+        const std::vector<std::vector<std::string>> batch = bignum.large_encrypt_batch(texts, key);
+        check(batch.size() == texts.size(), "one result per text");
+        for (std::size_t i = 0; i < batch.size() && i < texts.size(); i++)
+            check(batch[i] == bignum.large_encrypt(texts[i], key), "batched text " + std::to_string(i) + " matches");
+
+        std::vector<std::vector<std::string_view>> ciphertexts;
+        for (const std::vector<std::string> &encrypted : batch)
+            ciphertexts.emplace_back(encrypted.begin(), encrypted.end());
+        const std::vector<std::vector<std::string>> decrypted = bignum.large_decrypt_batch(ciphertexts, key);
+        check(decrypted.size() == 3 && decrypted[0] == std::vector<std::string>{"one", "two"} && decrypted[1] == lines &&
+                  decrypted[2] == std::vector<std::string>{"three"},
+              "batched decryption");
+
+        ciphertexts[2] = {"12345 67890"};
+        check_throws<std::runtime_error>([&]() { bignum.large_decrypt_batch(ciphertexts, key); },
+                                         "a malformed ciphertext fails the batch");
+    }
+}
+
+int main()
+{
+    test_text();
+    test_hybrid();
+    test_binary();
+    test_streaming();
+    test_line_index();
+    test_batches();
+    return test_status();
+}
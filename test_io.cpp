@@ -0,0 +1,114 @@
+/// @file test_io.cpp
+/// @brief Checks the memory-mapped input and buffered output used for file-to-file jobs.
+
+#include "io.hpp"
+#include "test_support.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    /// @brief Reads a whole file.
+    /// @param path Path of the file.
+    /// @return The contents.
+    std::string read_file(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    /// @brief Checks mapping files and splitting them into lines.
+    void test_mapped_input()
+    {
+        const std::string path = scratch_path("input");
+        std::ofstream(path, std::ios::binary) << "first\nsecond\n\nfourth";
+        {
+            const MappedFile file(path);
+            check(file.view() == "first\nsecond\n\nfourth", "a mapped file holds the file's bytes");
+            check(split_lines(file.view()) == std::vector<std::string_view>{"first", "second", "", "fourth"}, "lines of a mapped file");
+        }
+        std::ofstream(path, std::ios::binary | std::ios::trunc);
+        {
+            const MappedFile file(path);
+            check(file.view().empty(), "an empty file maps to nothing");
+        }
+        std::remove(path.c_str());
+        check_throws<std::runtime_error>([&]() { MappedFile file(path); }, "a missing file is rejected");
+
+        check(split_lines("one\ntwo\n") == std::vector<std::string_view>{"one", "two"}, "a final newline ends the last line");
+        check(split_lines("").empty(), "no text has no lines");
+    }
+
+    /// @brief Checks writing a file through the buffer.
+    void test_buffered_output()
+    {
+        const std::string path = scratch_path("output");
+        std::string expected;
+        {
+            BufferedWriter writer(path, 4096);
+            for (int i = 0; i < 1000; i++)
+            {
+                const std::string record = "record " + std::to_string(i) + "\n";
+                writer.write(record);
+                expected += record;
+            }
+            const std::string large(10000, 'x');
+            writer.write(large);
+            expected += large;
+        }
+        check(read_file(path) == expected, "everything written reaches the file, in order");
+        std::remove(path.c_str());
+
+        check_throws<std::runtime_error>([]() { BufferedWriter writer(scratch_path("missing") + "/output"); },
+                                         "a file in a missing directory is rejected");
+    }
+
+    /// @brief Checks when buffered bytes are handed to the kernel.
+    void test_flush_thresholds()
+    {
+        const std::string path = scratch_path("flushed");
+        {
+            BufferedWriter writer(path, 4096, std::chrono::milliseconds(20));
+            writer.write("early");
+            writer.poll();
+            check(read_file(path).empty(), "bytes wait in the buffer before the interval");
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            writer.poll();
+            check(read_file(path) == "early", "poll flushes bytes older than the interval");
+
+            writer.write(std::string(5000, 'y'));
+            check(read_file(path).size() >= 4096, "a full buffer is flushed");
+            writer.write("late");
+            writer.flush();
+            check(read_file(path) == "early" + std::string(5000, 'y') + "late", "flush hands over everything");
+        }
+        std::remove(path.c_str());
+
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        {
+            BufferedWriter writer(fd);
+            writer.write("through a descriptor");
+        }
+        check(::write(fd, "!", 1) == 1, "a borrowed descriptor stays open");
+        ::close(fd);
+        check(read_file(path) == "through a descriptor!", "a borrowed descriptor is flushed on destruction");
+        std::remove(path.c_str());
+    }
+}
+
+int main()
+{
+    test_mapped_input();
+    test_buffered_output();
+    test_flush_thresholds();
+    return test_status();
+}
@@ -0,0 +1,143 @@
+/// @file test_keys.cpp
+/// @brief Checks key files, the keyring and key generation.
+
+#include "bignum.hpp"
+#include "keycontext.hpp"
+#include "keygen.hpp"
+#include "keyring.hpp"
+#include "modexp_lanes.hpp"
+#include "test_support.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace
+{
+    /// @brief Checks that a key survives a key file unchanged, and how key files are written.
+    void test_key_file()
+    {
+        const KeyHandle key = test_key();
+        const std::string path = scratch_path("key");
+        std::ofstream(path) << "stale contents";
+        key->save(path);
+
+        struct stat status{};
+        check(stat(path.c_str(), &status) == 0 && (status.st_mode & 0777) == 0600, "a key file is owner-only");
+
+        const KeyContext loaded = KeyContext::load(path);
+        std::remove(path.c_str());
+        check(loaded.modulus().limbs() == key->modulus().limbs(), "loaded modulus");
+        check(loaded.modulus().barrett() == key->modulus().barrett(), "loaded Barrett constant");
+        check(loaded.public_exponent() == key->public_exponent(), "loaded public exponent");
+        check(loaded.private_exponent() == key->private_exponent(), "loaded private exponent");
+        check(loaded.private_recoding().steps().size() == key->private_recoding().steps().size(), "loaded recoding");
+        check(loaded.crt() != nullptr, "loaded CRT parameters");
+
+        const Bignum bignum, message("123456789123456789");
+        const Bignum modulus = Bignum::from_limbs(loaded.modulus().limbs());
+        const Bignum encrypted = bignum.mod_exponent(message, Bignum::from_limbs(loaded.public_exponent()), modulus);
+        check(bignum.mod_exponent(encrypted, Bignum::from_limbs(loaded.private_exponent()), modulus) == message,
+              "loaded exponents invert each other");
+
+        check_throws<std::runtime_error>([]() { KeyContext::load(scratch_path("missing")); }, "a missing key file is rejected");
+        const std::string junk_path = scratch_path("junk");
+        std::ofstream(junk_path) << std::string(256, 'x');
+        check_throws<std::runtime_error>([&]() { KeyContext::load(junk_path); }, "a file that is not a key is rejected");
+        std::remove(junk_path.c_str());
+
+        const std::vector<Limb> modulus_limbs = key->modulus().limbs();
+        check_throws<std::invalid_argument>([&]()
+                                            { KeyContext(modulus_limbs, key->public_exponent(), key->private_exponent(),
+                                                         Bignum("101").to_limbs(), Bignum("103").to_limbs()); },
+                                            "primes that do not multiply to the modulus are rejected");
+    }
+
+    /// @brief Checks the keyring's lookups, least-recently-used eviction and key file loading.
+    void test_keyring()
+    {
+        check_throws<std::invalid_argument>([]() { Keyring(0); }, "a keyring without room is rejected");
+
+        Keyring keyring(2);
+        const KeyHandle first = keyring.insert("first", *test_key());
+        keyring.insert("second", *test_key(false));
+        check(keyring.find("first") == first, "a cached key is found");
+        check(keyring.find("missing") == nullptr, "a missing key is not found");
+
+        keyring.insert("third", *test_key());
+        check(keyring.size() == 2, "the keyring stays within its capacity");
+        check(keyring.find("second") == nullptr, "the least recently used key is evicted");
+        check(keyring.find("first") == first, "a recently used key is kept");
+
+        keyring.erase("first");
+        check(keyring.find("first") == nullptr && keyring.size() == 1, "an erased key is gone");
+        check(first->modulus().limbs() == test_key()->modulus().limbs(), "an outstanding handle stays valid");
+
+        const std::string path = scratch_path("keyring.key");
+        test_key()->save(path);
+        const KeyHandle loaded = keyring.get(path);
+        check(keyring.get(path) == loaded, "a key file is loaded once");
+        test_key(false)->save(path); // Written to a new file and renamed over the old one.
+        const KeyHandle replaced = keyring.get(path);
+        check(replaced != loaded && replaced->crt() == nullptr, "a replaced key file is loaded again");
+        check(loaded->crt() != nullptr, "a handle to the replaced key stays valid");
+        keyring.invalidate(path);
+        check(keyring.get(path) != replaced, "an invalidated key file is loaded again");
+        std::remove(path.c_str());
+        check_throws<std::runtime_error>([&]() { keyring.get(scratch_path("missing.key")); }, "a missing key file is rejected");
+    }
+
+    /// @brief Checks the primality test on known primes and composites, and a generated key.
+    void test_key_generation()
+    {
+        const auto limbs = [](const char *value) { return Bignum(value).to_limbs(); };
+        check(KeyGenerator::is_probable_prime(limbs("102769370962510028329849774600427738458358775773341495746569452524768723208831"), 20),
+              "a 256-bit prime passes");
+        check(KeyGenerator::is_probable_prime(limbs("170141183460469231731687303715884105727"), 20), "2^127 - 1 passes");
+        check(!KeyGenerator::is_probable_prime(limbs("561"), 20), "the Carmichael number 561 fails");
+        check(!KeyGenerator::is_probable_prime(limbs("3215031751"), 20), "a strong pseudoprime to bases 2, 3, 5 and 7 fails");
+        check(!KeyGenerator::is_probable_prime(test_key()->modulus().limbs(), 20), "a product of two primes fails");
+
+        const KeyGenerator generator(512, 65537, 1);
+        const std::vector<Limb> prime = generator.random_prime(256);
+        const std::vector<std::uint8_t> prime_bytes = limbs_to_bytes(prime, byte_length(prime));
+        check(prime_bytes.size() == 32 && prime_bytes[0] >= 0xc0, "a random prime has its top two bits set");
+        check(KeyGenerator::is_probable_prime(prime, 20), "a random prime is prime");
+
+        const KeyContext key = generator.generate();
+        const std::vector<Limb> &modulus_limbs = key.modulus().limbs();
+        const std::vector<std::uint8_t> modulus_bytes = limbs_to_bytes(modulus_limbs, byte_length(modulus_limbs));
+        check(modulus_bytes.size() == 64 && modulus_bytes[0] >= 0x80, "a generated modulus has 512 bits");
+        check(key.crt() != nullptr, "a generated key has CRT parameters");
+
+        const Bignum bignum, message("42424242424242424242"), modulus = Bignum::from_limbs(modulus_limbs);
+        const Bignum encrypted = bignum.mod_exponent(message, Bignum::from_limbs(key.public_exponent()), modulus);
+        check(bignum.mod_exponent(encrypted, Bignum::from_limbs(key.private_exponent()), modulus) == message,
+              "generated exponents invert each other");
+    }
+
+    /// @brief Checks that a concurrent search finds the requested number of distinct primes.
+    void test_parallel_prime_search()
+    {
+        const KeyGenerator generator(512, 65537, 4);
+        const std::vector<std::vector<Limb>> primes = generator.random_primes(192, 3);
+        check(primes.size() == 3, "one prime per request");
+        for (const std::vector<Limb> &prime : primes)
+            check(KeyGenerator::is_probable_prime(prime, 20) && byte_length(prime) == 24, "a concurrently found prime");
+        check(primes.size() == 3 && primes[0] != primes[1] && primes[0] != primes[2] && primes[1] != primes[2],
+              "concurrently found primes are distinct");
+        check(generator.generate().crt() != nullptr, "a key generated with four search windows");
+    }
+}
+
+int main()
+{
+    test_key_file();
+    test_keyring();
+    test_key_generation();
+    test_parallel_prime_search();
+    return test_status();
+}
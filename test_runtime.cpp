@@ -0,0 +1,473 @@
+/// @file test_runtime.cpp
+/// @brief Checks the runtime around the cipher: the shared-memory transport, the C interface,
+/// the asynchronous front end, the work-stealing pool, the MPMC queue and the scratch arena.
+
+#include "async_cipher.hpp"
+#include "bignum_c.h"
+#include "daemon.hpp"
+#include "huge_pages.hpp"
+#include "keycontext.hpp"
+#include "keyring.hpp"
+#include "mpmc_queue.hpp"
+#include "numa.hpp"
+#include "scratch_arena.hpp"
+#include "shm_ring.hpp"
+#include "test_support.hpp"
+#include "work_stealing.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <sched.h>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /// @brief Checks requests and responses through a ring served by another thread.
+    void test_shared_ring()
+    {
+        const std::string name = "bignum_test_" + std::to_string(getpid());
+        const SharedRing server(name, 4, 256);
+        check_throws<std::runtime_error>([&]() { SharedRing missing(name + "_missing"); }, "attaching to a missing ring fails");
+
+        constexpr int REQUESTS = 100;
+        std::thread serving([&server]()
+                            {
+                                int answered = 0;
+                                while (answered < REQUESTS + 1)
+                                    for (const std::uint32_t index : server.wait_for_requests())
+                                    {
+                                        const std::string request(server.request(index));
+                                        if (server.request_op(index) == 'x')
+                                            server.respond(index, {DAEMON_OK, std::string(1000, 'x')});
+                                        else
+                                            server.respond(index, {DAEMON_OK, server.request_op(index) + request});
+                                        answered++;
+                                    } });
+
+        const SharedRing client(name);
+        std::vector<std::thread> clients;
+        std::vector<int> mismatches(2, 0);
+        for (int c = 0; c < 2; c++)
+            clients.emplace_back([&client, &mismatches, c]()
+                                 {
+                                     for (int i = c; i < REQUESTS; i += 2)
+                                     {
+                                         const std::string payload = "request " + std::to_string(i);
+                                         const DaemonResponse response = client.call('e', payload);
+                                         mismatches[c] += response.tag != DAEMON_OK || response.payload != "e" + payload;
+                                     } });
+        for (std::thread &thread : clients)
+            thread.join();
+        check(mismatches[0] == 0 && mismatches[1] == 0, "every client gets its own response");
+
+        check_throws<std::length_error>([&]() { client.call('e', std::string(257, 'a')); }, "a payload larger than a slot is rejected");
+        const DaemonResponse oversized = client.call('x', "");
+        check(oversized.tag == DAEMON_ERROR, "a response larger than a slot becomes an error");
+        serving.join();
+    }
+
+    /// @brief Checks the C interface.
+    /// @param key_path Path of a key file.
+    void test_c_api(const std::string &key_path)
+    {
+        const std::uint8_t base[] = {4}, exponent[] = {13}, modulus[] = {0x01, 0xf1};
+        std::uint8_t out[2] = {};
+        check(bn_modexp(base, 1, exponent, 1, modulus, 2, out) == BN_OK && out[0] == 0x01 && out[1] == 0xbd, "bn_modexp 4^13 mod 497");
+        const std::uint8_t zero[] = {0};
+        check(bn_modexp(base, 1, exponent, 1, zero, 1, out) == BN_ERR_INVALID_ARGUMENT, "bn_modexp rejects a zero modulus");
+
+        check(bn_ctx_new("/nonexistent/key") == nullptr && std::strlen(bn_last_error()) > 0, "a missing key file fails with a message");
+
+        bn_ctx *ctx = bn_ctx_new(key_path.c_str());
+        check(ctx != nullptr && bn_modulus_bytes(ctx) == 64, "context for a key file");
+        if (ctx == nullptr)
+            return;
+
+        const std::string texts[] = {"first text", "two\nlines"};
+        bn_input inputs[2];
+        std::vector<std::uint8_t> buffers[2];
+        bn_output outputs[2];
+        for (int i = 0; i < 2; i++)
+        {
+            inputs[i] = {reinterpret_cast<const std::uint8_t *>(texts[i].data()), texts[i].size()};
+            outputs[i] = {nullptr, 0, 0};
+        }
+        check(bn_encrypt_batch(ctx, inputs, outputs, 2) == BN_ERR_BUFFER_TOO_SMALL && outputs[0].length > 0,
+              "a missing output buffer reports the length needed");
+        for (int i = 0; i < 2; i++)
+        {
+            check(outputs[i].length <= bn_encrypt_bound(ctx, inputs[i].data, inputs[i].length), "bn_encrypt_bound suffices");
+            buffers[i].resize(outputs[i].length);
+            outputs[i] = {buffers[i].data(), buffers[i].size(), 0};
+        }
+        check(bn_encrypt_batch(ctx, inputs, outputs, 2) == BN_OK, "bn_encrypt_batch");
+
+        bn_input ciphertexts[2];
+        std::vector<std::uint8_t> plain[2];
+        bn_output decrypted[2];
+        for (int i = 0; i < 2; i++)
+        {
+            ciphertexts[i] = {buffers[i].data(), outputs[i].length};
+            plain[i].resize(outputs[i].length);
+            decrypted[i] = {plain[i].data(), plain[i].size(), 0};
+        }
+        check(bn_decrypt_batch(ctx, ciphertexts, decrypted, 2) == BN_OK, "bn_decrypt_batch");
+        for (int i = 0; i < 2; i++)
+            check(std::string(reinterpret_cast<const char *>(plain[i].data()), decrypted[i].length) == texts[i] + "\n",
+                  "C interface round trip " + std::to_string(i));
+
+        buffers[0][0] = buffers[0][0] == '1' ? '2' : '1';
+        check(bn_decrypt_batch(ctx, ciphertexts, decrypted, 1) == BN_ERR_DECRYPT, "a modified ciphertext fails to decrypt");
+        bn_ctx_free(ctx);
+
+        // A 2-byte modulus cannot hold a flag byte and any payload.
+        const std::string tiny_path = scratch_path("tiny.key");
+        KeyContext(Bignum("3233").to_limbs(), Bignum("17").to_limbs(), Bignum("2753").to_limbs()).save(tiny_path);
+        bn_ctx *tiny = bn_ctx_new(tiny_path.c_str());
+        std::remove(tiny_path.c_str());
+        check(tiny != nullptr, "context for a 2-byte modulus");
+        if (tiny == nullptr)
+            return;
+        check(bn_encrypt_bound(tiny, inputs[0].data, inputs[0].length) == 0 && std::strlen(bn_last_error()) > 0,
+              "bn_encrypt_bound rejects a modulus too small for a block");
+        outputs[0] = {buffers[0].data(), buffers[0].size(), 0};
+        check(bn_encrypt_batch(tiny, inputs, outputs, 1) < 0, "bn_encrypt_batch rejects a modulus too small for a block");
+        bn_ctx_free(tiny);
+
+        // A new key renamed over a key file is picked up by the next context; older ones keep theirs.
+        const std::string rotated_path = scratch_path("rotated.key");
+        test_key()->save(rotated_path);
+        bn_ctx *before = bn_ctx_new(rotated_path.c_str());
+        KeyContext(Bignum("3233").to_limbs(), Bignum("17").to_limbs(), Bignum("2753").to_limbs()).save(rotated_path);
+        bn_ctx *after = bn_ctx_new(rotated_path.c_str());
+        check(before != nullptr && after != nullptr && bn_modulus_bytes(before) == 64 && bn_modulus_bytes(after) == 2,
+              "a replaced key file is read again");
+        check(bn_key_invalidate(rotated_path.c_str()) == BN_OK, "bn_key_invalidate");
+        check(bn_key_invalidate(nullptr) == BN_ERR_INVALID_ARGUMENT, "bn_key_invalidate rejects a null path");
+        std::remove(rotated_path.c_str());
+        bn_ctx_free(before);
+        bn_ctx_free(after);
+    }
+
+    /// @brief A coroutine that starts at once and reports its result through a promise.
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    /// @brief Encrypts and decrypts a text with the awaitable operations.
+    /// @param cipher The cipher.
+    /// @param text The text; must outlive the coroutine.
+    /// @param result Receives the decrypted text, or the error message.
+    DetachedTask round_trip(AsyncCipher &cipher, std::string_view text, std::promise<std::string> &result)
+    {
+        try
+        {
+            const std::string encrypted = co_await cipher.async_encrypt(text);
+            const std::string decrypted = co_await cipher.async_decrypt(encrypted);
+            const std::string container = co_await cipher.async_hybrid_encrypt(text);
+            const std::string opened = co_await cipher.async_hybrid_decrypt(container);
+            result.set_value(opened == text ? decrypted : "hybrid mismatch");
+        }
+        catch (const std::exception &error)
+        {
+            result.set_value(error.what());
+        }
+    }
+
+    /// @brief Checks the asynchronous front end, including a completion that throws.
+    /// @param key_path Path of a key file.
+    void test_async_cipher(const std::string &key_path)
+    {
+        AsyncCipher cipher(Keyring::shared().get(key_path));
+
+        std::promise<std::string> awaited;
+        round_trip(cipher, "awaited\ntext", awaited);
+        check(awaited.get_future().get() == "awaited\ntext\n", "awaited round trip");
+
+        std::promise<std::string> encrypted;
+        cipher.submit('e', "async", [&encrypted](std::string result, std::exception_ptr error)
+                      {
+                          encrypted.set_value(error ? "" : result);
+                          throw std::runtime_error("completion failed"); });
+        const std::string ciphertext = encrypted.get_future().get();
+        check(!ciphertext.empty(), "asynchronous encryption");
+
+        std::promise<std::string> decrypted;
+        cipher.submit('d', ciphertext, [&decrypted](std::string result, std::exception_ptr error)
+                      { decrypted.set_value(error ? "error" : result); });
+        check(decrypted.get_future().get() == "async\n", "the executor survives a throwing completion");
+
+        std::promise<bool> failed;
+        cipher.submit('d', "12345 67890", [&failed](std::string, std::exception_ptr error)
+                      { failed.set_value(error != nullptr); });
+        check(failed.get_future().get(), "a malformed ciphertext completes with an error");
+    }
+
+    /// @brief Checks that task groups run every task, including nested and very uneven ones.
+    void test_work_stealing()
+    {
+        WorkStealingPool pool(3);
+        check(pool.size() == 3, "the pool starts the requested workers");
+
+        std::atomic<int> count{0};
+        TaskGroup group(pool);
+        for (int i = 0; i < 100; i++)
+            group.run([&count, &pool, i]()
+                      {
+                          TaskGroup inner(pool);
+                          for (int j = 0; j < 10; j++)
+                              inner.run([&count, i, j]()
+                                        {
+                                            // A few tasks are far longer than the rest, as with uneven lines.
+                                            if (i % 25 == 0 && j == 0)
+                                                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                                            count++; });
+                          inner.wait(); });
+        group.wait();
+        check(count.load() == 1000, "every task runs");
+
+        TaskGroup recursive(pool);
+        std::atomic<int> spawned{0};
+        std::function<void(int)> spawn = [&](int depth)
+        {
+            spawned++;
+            if (depth < 8)
+            {
+                recursive.run([&spawn, depth]() { spawn(depth + 1); });
+                recursive.run([&spawn, depth]() { spawn(depth + 1); });
+            }
+        };
+        recursive.run([&spawn]() { spawn(0); });
+        recursive.wait();
+        check(spawned.load() == 511, "tasks queued by tasks of the same group run");
+
+        TaskGroup failing(pool);
+        for (int i = 0; i < 10; i++)
+            failing.run([i]()
+                        {
+                            if (i == 7)
+                                throw std::runtime_error("task failed"); });
+        check_throws<std::runtime_error>([&]() { failing.wait(); }, "wait rethrows a task's exception");
+    }
+
+    /// @brief Checks the queue alone and under concurrent producers and consumers.
+    void test_mpmc_queue()
+    {
+        check_throws<std::invalid_argument>([]() { MpmcQueue<int> queue(6); }, "a capacity that is not a power of two is rejected");
+
+        MpmcQueue<int> queue(4);
+        int value = 0;
+        check(!queue.try_pop(value), "an empty queue pops nothing");
+        for (int i = 1; i <= 4; i++)
+            check(queue.try_push(i), "push into room");
+        int extra = 5;
+        check(!queue.try_push(extra) && extra == 5, "a full queue refuses a push and keeps the value");
+        for (int i = 1; i <= 4; i++)
+            check(queue.try_pop(value) && value == i, "pop in order");
+
+        constexpr int PRODUCERS = 3;
+        constexpr int ITEMS = 20000;
+        MpmcQueue<int> shared(64);
+        std::atomic<long long> sum{0};
+        std::atomic<int> popped{0};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < PRODUCERS; p++)
+            threads.emplace_back([&shared, p]()
+                                 {
+                                     for (int i = 1; i <= ITEMS; i++)
+                                     {
+                                         int item = p * ITEMS + i;
+                                         while (!shared.try_push(item))
+                                             std::this_thread::yield();
+                                     } });
+        for (int c = 0; c < 2; c++)
+            threads.emplace_back([&shared, &sum, &popped]()
+                                 {
+                                     int item = 0;
+                                     while (popped.load() < PRODUCERS * ITEMS)
+                                     {
+                                         if (shared.try_pop(item))
+                                         {
+                                             sum += item;
+                                             popped++;
+                                         }
+                                         else
+                                             std::this_thread::yield();
+                                     } });
+        for (std::thread &thread : threads)
+            thread.join();
+        const long long total = static_cast<long long>(PRODUCERS * ITEMS) * (PRODUCERS * ITEMS + 1) / 2;
+        check(popped.load() == PRODUCERS * ITEMS && sum.load() == total, "every item is popped exactly once");
+    }
+
+    /// @brief Checks worker placement against the host's topology, whatever it is.
+    void test_affinity()
+    {
+        check(parse_affinity_policy("none") == AffinityPolicy::none && parse_affinity_policy("compact") == AffinityPolicy::compact &&
+                  parse_affinity_policy("scatter") == AffinityPolicy::scatter,
+              "affinity policy names");
+        check_throws<std::invalid_argument>([]() { parse_affinity_policy("spread"); }, "an unknown policy is rejected");
+
+        const NumaTopology &topology = NumaTopology::system();
+        check(topology.node_count() >= 1, "at least one node");
+        std::vector<unsigned> allowed;
+        for (std::size_t node = 0; node < topology.node_count(); node++)
+            for (const unsigned cpu : topology.cpus(node))
+            {
+                check(topology.node_of(cpu) == node, "a CPU belongs to the node listing it");
+                allowed.push_back(cpu);
+            }
+
+        constexpr std::size_t WORKERS = 6;
+        check(topology.placement(AffinityPolicy::none, WORKERS) == std::vector<int>(WORKERS, -1), "no policy pins nothing");
+        const std::vector<int> compact = topology.placement(AffinityPolicy::compact, WORKERS);
+        const std::vector<int> scatter = topology.placement(AffinityPolicy::scatter, WORKERS);
+        check(compact.size() == WORKERS && scatter.size() == WORKERS, "one CPU per worker");
+        for (std::size_t i = 0; i < WORKERS && !allowed.empty() && i < compact.size() && i < scatter.size(); i++)
+        {
+            check(compact[i] == static_cast<int>(allowed[i % allowed.size()]), "compact fills one node before the next");
+            check(scatter[i] >= 0 && topology.node_of(static_cast<unsigned>(scatter[i])) == i % topology.node_count(),
+                  "scatter places workers round-robin across nodes");
+        }
+
+        if (!allowed.empty())
+        {
+            bool pinned = false;
+            std::thread([&]()
+                        { pinned = pin_current_thread(allowed.back()) && sched_getcpu() == static_cast<int>(allowed.back()); })
+                .join();
+            check(pinned, "a thread can be pinned to an allowed CPU");
+        }
+
+        WorkStealingPool pool(2, AffinityPolicy::compact);
+        std::atomic<int> count{0};
+        TaskGroup group(pool);
+        for (int i = 0; i < 50; i++)
+            group.run([&count]() { count++; });
+        group.wait();
+        check(count.load() == 50, "a pinned pool runs every task");
+    }
+
+    /// @brief Checks that scopes rewind the arena, that it grows as needed and that it is reused.
+    void test_scratch_arena()
+    {
+        ScratchArena arena;
+        void *first = nullptr;
+        {
+            ScratchArena::Scope scope(arena);
+            first = arena.allocate(100, 64);
+            check(reinterpret_cast<std::uintptr_t>(first) % 64 == 0, "allocation is aligned");
+            check(arena.allocate(100, 8) != first, "allocations in a scope are distinct");
+        }
+        {
+            ScratchArena::Scope scope(arena);
+            check(arena.allocate(100, 64) == first, "a closed scope is rewound");
+            arena.allocate(4 * ScratchArena::MIN_CHUNK_BYTES, 8);
+            check(arena.capacity() >= 5 * ScratchArena::MIN_CHUNK_BYTES, "the arena grows for a large allocation");
+        }
+        {
+            ScratchArena::Scope scope(arena);
+            check(arena.allocate(100, 64) == first, "the first chunk is reused after growing");
+        }
+
+        {
+            ScratchArena::Scope scope;
+            ScratchVector<int> values;
+            for (int i = 0; i < 10000; i++)
+                values.push_back(i);
+            check(values.size() == 10000 && values[9999] == 9999, "a scratch vector grows");
+        }
+
+        // Exponentiation takes its temporaries from this thread's arena and gives them back.
+        const Bignum bignum, modulus = Bignum::from_limbs(test_key()->modulus().limbs());
+        bignum.mod_exponent(Bignum("12345"), Bignum("65537"), modulus);
+        const std::size_t capacity = ScratchArena::local().capacity();
+        for (int i = 0; i < 20; i++)
+            bignum.mod_exponent(Bignum(std::to_string(i + 2)), Bignum("65537"), modulus);
+        check(ScratchArena::local().capacity() == capacity, "repeated exponentiations reuse the arena");
+    }
+
+    /// @brief Total bytes a report says were mapped.
+    /// @param report The report.
+    /// @return The sum of every backing's bytes.
+    std::size_t mapped_bytes(const HugePageReport &report)
+    {
+        return report.hugetlb_bytes + report.advised_bytes + report.normal_bytes;
+    }
+
+    /// @brief Checks page blocks in every mode; what the system grants varies, so only its bookkeeping is checked.
+    void test_huge_pages()
+    {
+        check(parse_huge_page_mode("off") == HugePageMode::off && parse_huge_page_mode("madvise") == HugePageMode::madvise &&
+                  parse_huge_page_mode("hugetlb") == HugePageMode::hugetlb,
+              "huge page mode names");
+        check_throws<std::invalid_argument>([]() { parse_huge_page_mode("always"); }, "an unknown mode is rejected");
+
+        for (const HugePageMode mode : {HugePageMode::off, HugePageMode::madvise, HugePageMode::hugetlb})
+        {
+            set_huge_page_mode(mode);
+            check(huge_page_mode() == mode, "the mode is set");
+
+            const HugePageReport before = huge_page_report();
+            PageBlock block(HUGE_PAGE_BYTES + 1000);
+            const HugePageReport after = huge_page_report();
+            check(block.size() >= HUGE_PAGE_BYTES + 1000, "a block is at least as large as requested");
+            check(mapped_bytes(after) == mapped_bytes(before) + block.size(), "a block is counted once");
+            check(mode != HugePageMode::off || block.backing() == PageBacking::normal, "mode off maps normal pages");
+            if (block.backing() != PageBacking::normal)
+                check(reinterpret_cast<std::uintptr_t>(block.data()) % HUGE_PAGE_BYTES == 0 && block.size() % HUGE_PAGE_BYTES == 0,
+                      "a huge-page block is made of whole huge pages");
+
+            std::memset(block.data(), 0xab, block.size());
+            PageBlock moved(std::move(block));
+            check(block.data() == nullptr && block.size() == 0, "a moved-from block is empty");
+            check(moved.data()[moved.size() - 1] == std::byte{0xab}, "a moved block keeps its memory");
+        }
+        set_huge_page_mode(HugePageMode::off);
+
+        check(bn_set_huge_pages("always") == BN_ERR_INVALID_ARGUMENT, "bn_set_huge_pages rejects an unknown mode");
+        check(bn_set_huge_pages("madvise") == BN_OK && huge_page_mode() == HugePageMode::madvise, "bn_set_huge_pages sets the mode");
+        check(bn_set_huge_pages("off") == BN_OK, "bn_set_huge_pages turns huge pages off");
+        bn_page_report report{};
+        check(bn_huge_page_report(&report) == BN_OK &&
+                  report.hugetlb_bytes + report.advised_bytes + report.normal_bytes == mapped_bytes(huge_page_report()),
+              "bn_huge_page_report matches the library's totals");
+        check(bn_huge_page_report(nullptr) == BN_ERR_INVALID_ARGUMENT, "bn_huge_page_report rejects a null report");
+    }
+}
+
+int main()
+{
+    const std::string key_path = scratch_path("runtime.key");
+    test_key()->save(key_path);
+
+    test_shared_ring();
+    test_c_api(key_path);
+    test_async_cipher(key_path);
+    test_work_stealing();
+    test_mpmc_queue();
+    test_affinity();
+    test_scratch_arena();
+    test_huge_pages();
+    std::remove(key_path.c_str());
+    return test_status();
+}
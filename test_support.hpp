@@ -0,0 +1,95 @@
+/// @file test_support.hpp
+/// @brief Checking helpers shared by the test programs.
+///
+/// Each test program records its checks with check() and returns test_status() from main,
+/// so ctest reports it as failed if any check failed.
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "bignum.hpp"
+#include "keycontext.hpp"
+
+/// @brief Number of failed checks in this test program.
+inline int test_failures = 0;
+
+/// @brief Records a check, printing its description if it failed.
+/// @param passed Outcome of the check.
+/// @param what Description printed on failure.
+inline void check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED: " << what << "\n";
+        test_failures++;
+    }
+}
+
+/// @brief Checks that an operation throws an exception of the given type.
+/// @tparam E Expected exception type.
+/// @tparam F Callable type.
+/// @param operation The operation.
+/// @param what Description printed on failure.
+template <typename E, typename F>
+void check_throws(F operation, const std::string &what)
+{
+    try
+    {
+        operation();
+    }
+    catch (const E &)
+    {
+        return;
+    }
+    catch (...)
+    {
+    }
+    check(false, what);
+}
+
+/// @brief Exit status of the test program.
+/// @return Zero if every check passed, one otherwise.
+inline int test_status()
+{
+    return test_failures == 0 ? 0 : 1;
+}
+
+/// @brief Decodes a hexadecimal string.
+/// @param hex Pairs of hex digits.
+/// @return The bytes.
+inline std::vector<std::uint8_t> from_hex(const std::string &hex)
+{
+    std::vector<std::uint8_t> bytes;
+    for (std::size_t i = 0; i + 1 < hex.length(); i += 2)
+        bytes.push_back(static_cast<std::uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+    return bytes;
+}
+
+/// @brief Makes a path for a scratch file.
+/// @param name File name.
+/// @return A path in the temporary directory, unique to this process.
+inline std::string scratch_path(const std::string &name)
+{
+    return "/tmp/bignum_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+/// @brief Builds a fixed 512-bit key, so results can be compared with values computed elsewhere.
+/// @param with_crt Whether to include the primes, so decryption uses the CRT.
+/// @return The key.
+inline KeyHandle test_key(bool with_crt = true)
+{
+    const auto limbs = [](const char *value) { return Bignum(value).to_limbs(); };
+    const char *n = "10851871202442066816877878591794974718421324291759141365379748340436382272440227380533658231825827802039591013723993842388620202128103620592039967846766653";
+    const char *e = "65537";
+    const char *d = "841331729856541213307849018492000954335699661663307708279208711380704919759338032319377283179093485263842633876312705321989242902827348329831624771015453";
+    const char *p = "102769370962510028329849774600427738458358775773341495746569452524768723208831";
+    const char *q = "105594411066316619727878709301804967644169169389074345682001446113271822231363";
+    if (with_crt)
+        return std::make_shared<const KeyContext>(limbs(n), limbs(e), limbs(d), limbs(p), limbs(q));
+    return std::make_shared<const KeyContext>(limbs(n), limbs(e), limbs(d));
+}
@@ -0,0 +1,222 @@
+/// @file work_stealing.cpp
+/// @brief Implementation of the work-stealing thread pool used for all internal parallelism.
+
+#include "work_stealing.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    /// @brief Pool the calling thread works for, if it is a worker.
+    thread_local const WorkStealingPool *current_pool = nullptr;
+
+    /// @brief Deque owned by the calling thread, if it is a worker.
+    thread_local std::size_t current_queue = 0;
+
+    /// @brief Placement policy of the process-wide pool.
+    std::atomic<AffinityPolicy> shared_policy{AffinityPolicy::none};
+}
+
+/// @brief Starts the workers.
+/// @param thread_count Number of workers; zero uses one per hardware thread.
+/// @param policy How to pin the workers to CPUs.
+WorkStealingPool::WorkStealingPool(unsigned thread_count, AffinityPolicy policy)
+{
+    const unsigned count = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+    const NumaTopology &topology = NumaTopology::system();
+    worker_cpus = topology.placement(policy, count);
+
+    // Every worker tries its own deque, then those of workers on its node, then the rest;
+    // unpinned workers have no fixed node and just try the others in turn.
+    for (unsigned i = 0; i < count; i++)
+    {
+        std::vector<std::size_t> order;
+        for (unsigned j = 0; j < count; j++)
+            order.push_back((i + j) % count);
+        if (worker_cpus[i] >= 0)
+        {
+            const std::size_t node = topology.node_of(static_cast<unsigned>(worker_cpus[i]));
+            std::stable_partition(order.begin() + 1, order.end(), [&](std::size_t other)
+                                  { return worker_cpus[other] >= 0 && topology.node_of(static_cast<unsigned>(worker_cpus[other])) == node; });
+        }
+        steal_order.push_back(std::move(order));
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < count; i++)
+        threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+}
+
+/// @brief Finishes every queued task, then stops the workers.
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+/// @brief The process-wide pool, started on first use with one worker per hardware thread.
+/// @return The pool.
+WorkStealingPool &WorkStealingPool::shared()
+{
+    static WorkStealingPool pool(0, shared_policy.load());
+    return pool;
+}
+
+/// @brief Sets how the process-wide pool pins its workers.
+/// @param policy The placement policy; AffinityPolicy::none by default.
+void WorkStealingPool::set_shared_policy(AffinityPolicy policy)
+{
+    shared_policy.store(policy);
+}
+
+/// @brief Runs tasks until shutdown.
+/// @param index The worker's deque.
+void WorkStealingPool::worker_loop(std::size_t index)
+{
+    current_pool = this;
+    current_queue = index;
+    if (worker_cpus[index] >= 0)
+        pin_current_thread(static_cast<unsigned>(worker_cpus[index]));
+
+    while (true)
+    {
+        if (try_run_one())
+            continue;
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle.wait(lock, [this]()
+                  { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
+
+/// @brief Queues a task on the calling worker's deque, or on the next one for other threads.
+/// @param task The task.
+void WorkStealingPool::push(Task task)
+{
+    const std::size_t index = current_pool == this ? current_queue : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+        queued.fetch_add(1);
+    }
+
+    // Taking the lock orders the count before a sleeping worker's check, so no wakeup is lost.
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+    }
+    idle.notify_one();
+}
+
+/// @brief Runs one queued task, preferring the calling worker's newest one.
+/// @return False if every deque was empty.
+bool WorkStealingPool::try_run_one()
+{
+    const bool worker = current_pool == this;
+    const std::size_t home = worker ? current_queue : next_queue.load(std::memory_order_relaxed) % queues.size();
+
+    Task task;
+    for (std::size_t i = 0; i < queues.size() && !task; i++)
+    {
+        WorkerQueue &queue = *queues[worker ? steal_order[home][i] : (home + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (worker && i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued.fetch_sub(1);
+    }
+
+    if (!task)
+        return false;
+    task();
+    return true;
+}
+
+/// @brief Creates an empty group.
+/// @param task_pool Pool to run the tasks on.
+TaskGroup::TaskGroup(WorkStealingPool &task_pool) : pool(task_pool) {}
+
+/// @brief Waits for any tasks still running, discarding their exceptions.
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+/// @brief Queues a task.
+/// @param task The task; may itself call run() on this group.
+void TaskGroup::run(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unfinished++;
+    }
+
+    pool.push([this, task = std::move(task)]()
+              {
+                  std::exception_ptr error;
+                  try
+                  {
+                      task();
+                  }
+                  catch (...)
+                  {
+                      error = std::current_exception();
+                  }
+
+                  // Notifying under the lock keeps the group alive until this task is done with it.
+                  std::lock_guard<std::mutex> lock(mutex);
+                  if (error && !failure)
+                      failure = error;
+                  if (--unfinished == 0)
+                      finished.notify_all(); });
+}
+
+/// @brief Runs queued tasks until every task of this group has finished.
+/// @throws The first exception thrown by a task of this group.
+void TaskGroup::wait()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (unfinished == 0)
+                break;
+        }
+
+        // Helping may run other groups' tasks; the rest of this group's are then running
+        // elsewhere, and any tasks they split off are helped along by their own waiters.
+        if (pool.try_run_one())
+            continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]()
+                      { return unfinished == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure)
+        std::rethrow_exception(std::exchange(failure, nullptr));
+}
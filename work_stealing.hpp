@@ -0,0 +1,133 @@
+/// @file work_stealing.hpp
+/// @brief Declaration of the work-stealing thread pool used for all internal parallelism.
+///
+/// Each worker owns a deque. A worker pushes and pops its own tasks at the back, so it keeps
+/// working on what it just split off, and an idle worker steals from the front of another's
+/// deque, taking the oldest and usually largest piece of work. Threads outside the pool hand
+/// their tasks to the workers in turn.
+///
+/// Workers can be pinned to CPUs by an AffinityPolicy. Pinned workers steal from workers on
+/// their own NUMA node before crossing to another one, and since tasks allocate their working
+/// data themselves, that data is placed on the node of the worker that processes it.
+///
+/// Work is submitted through a TaskGroup, whose wait() runs queued tasks while it waits. Groups
+/// can therefore nest: a task may split its own work into another group without tying up the
+/// worker it runs on.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "numa.hpp"
+
+/// @class WorkStealingPool
+/// @brief A fixed set of worker threads that balance tasks by stealing from each other.
+class WorkStealingPool
+{
+private:
+    friend class TaskGroup;
+
+    /// @brief A queued unit of work.
+    using Task = std::function<void()>;
+
+    /// @brief One worker's deque, on its own cache line.
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;        ///< Guards tasks.
+        std::deque<Task> tasks;  ///< Owner's end is the back; thieves take from the front.
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; ///< One deque per worker.
+    std::vector<std::thread> threads;                 ///< The workers.
+    std::vector<int> worker_cpus;                     ///< CPU each worker is pinned to, or -1.
+    std::vector<std::vector<std::size_t>> steal_order; ///< Deques each worker tries, own first, then same node.
+
+    std::atomic<std::size_t> queued{0};       ///< Tasks in all deques together.
+    std::atomic<std::size_t> next_queue{0};   ///< Deque that the next outside submission goes to.
+    std::mutex idle_mutex;                    ///< Guards stopping; pairs with idle.
+    std::condition_variable idle;             ///< Signalled when a task is queued or on shutdown.
+    bool stopping = false;                    ///< Set by the destructor.
+
+    /// @brief Runs tasks until shutdown.
+    /// @param index The worker's deque.
+    void worker_loop(std::size_t index);
+
+    /// @brief Queues a task on the calling worker's deque, or on the next one for other threads.
+    /// @param task The task.
+    void push(Task task);
+
+    /// @brief Runs one queued task, preferring the calling worker's newest one.
+    /// @return False if every deque was empty.
+    bool try_run_one();
+
+public:
+    /// @brief Starts the workers.
+    /// @param thread_count Number of workers; zero uses one per hardware thread.
+    /// @param policy How to pin the workers to CPUs.
+    explicit WorkStealingPool(unsigned thread_count = 0, AffinityPolicy policy = AffinityPolicy::none);
+
+    /// @brief Finishes every queued task, then stops the workers.
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /// @brief The process-wide pool, started on first use with one worker per hardware thread.
+    /// @return The pool.
+    static WorkStealingPool &shared();
+
+    /// @brief Sets how the process-wide pool pins its workers.
+    ///
+    /// Only takes effect if called before the first use of shared().
+    /// @param policy The placement policy; AffinityPolicy::none by default.
+    static void set_shared_policy(AffinityPolicy policy);
+
+    /// @brief Number of workers.
+    /// @return The worker count.
+    std::size_t size() const { return threads.size(); }
+
+    /// @brief Whether tasks are waiting for a worker.
+    ///
+    /// Callers use this to skip splitting work that the pool has no spare workers for.
+    /// @return True if any deque holds a task.
+    bool backlogged() const { return queued.load(std::memory_order_relaxed) > 0; }
+};
+
+/// @class TaskGroup
+/// @brief A set of tasks run on a WorkStealingPool and waited for together.
+class TaskGroup
+{
+private:
+    WorkStealingPool &pool;         ///< Pool the tasks run on.
+    std::size_t unfinished = 0;     ///< Tasks started but not finished; guarded by mutex.
+    std::exception_ptr failure;     ///< First exception thrown by a task; guarded by mutex.
+    std::mutex mutex;               ///< Guards unfinished and failure.
+    std::condition_variable finished; ///< Signalled when the last task finishes.
+
+public:
+    /// @brief Creates an empty group.
+    /// @param task_pool Pool to run the tasks on.
+    explicit TaskGroup(WorkStealingPool &task_pool = WorkStealingPool::shared());
+
+    /// @brief Waits for any tasks still running, discarding their exceptions.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    /// @brief Queues a task.
+    /// @param task The task; may itself call run() on this group.
+    void run(std::function<void()> task);
+
+    /// @brief Runs queued tasks until every task of this group has finished.
+    /// @throws The first exception thrown by a task of this group.
+    void wait();
+};